@@ -0,0 +1,112 @@
+#ifndef __BATCH__
+#define __BATCH__
+
+#include "marslanding/dynamics.h"
+#include "marslanding/fleet.h"
+#include "marslanding/guidance.h"
+#include "marslanding/integrator.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Piecewise constant joystick command, each row holds until the next one
+struct thrust_profile_t
+{
+    size_t length;
+    double *time;
+    double *joy_x, *joy_z, *joy_n;
+};
+
+// Monte Carlo campaign of descents dispersed around the initial state
+struct batch_config_t
+{
+    struct vehicle_t vehicle;
+    size_t runs;
+    int threads; // 0 for one per processor
+    unsigned long long seed;
+    double initial_state[TRAJECTORY_DIM]; // mean of the dispersed initial states
+    double sigma[TRAJECTORY_DIM]; // standard deviations around initial_state
+    double max_time; // in s, runs still flying are stopped
+    const struct thrust_profile_t *profile; // NULL for idle command
+    bool vectorized; // step runs in blocks with the fleet kernel, explicit Euler only
+    const struct integrator_t *integrator; // NULL for explicit Euler
+    bool locate_events; // stop exactly at touchdown and fuel depletion
+    bool autopilot; // guidance replaces the profile, re-planned every GUIDANCE_PERIOD
+};
+
+// Outcome of a single descent
+struct run_result_t
+{
+    double landing_error; // in m, horizontal distance to objective
+    double touchdown_velocity; // in m/s
+    double fuel_remaining; // in kg
+    double time; // in s
+    double plan_time; // longest autopilot plan, in s, 0 without autopilot
+    double plan_p99; // 99th percentile of the autopilot plans, in s, 0 without autopilot
+    bool landed;
+};
+
+// Running mean, variance and bounds of a metric
+struct statistics_t
+{
+    size_t count;
+    double mean, m2, min, max;
+};
+
+// Aggregated results of a campaign, over landed runs
+struct batch_summary_t
+{
+    size_t runs, landed;
+    struct statistics_t landing_error;
+    struct statistics_t touchdown_velocity;
+    struct statistics_t fuel_remaining;
+    struct statistics_t time;
+    struct statistics_t plan_time; // autopilot runs only
+    struct statistics_t plan_p99; // autopilot runs only
+};
+
+// Load a CSV profile with time,joy_x,joy_z,joy_n rows
+struct thrust_profile_t* load_thrust_profile(const char *path);
+
+// Free memory for a profile
+struct thrust_profile_t* free_thrust_profile(struct thrust_profile_t *profile);
+
+// Joystick command at a time, row is a search hint updated for increasing times
+void profile_command(const struct thrust_profile_t *profile, double time, size_t *row,
+    double *joy_x, double *joy_z, double *joy_n);
+
+// Initial state of a run around a mean, reproducible from seed and run index
+void dispersed_state(unsigned long long seed, size_t run, const double *mean, const double *sigma,
+    double *state);
+
+// Called with the lander after each tick of an observed run, guidance is NULL without autopilot
+typedef void (*run_observer_t)(void *context, struct lander_t *lander, const struct guidance_t *guidance);
+
+// Fly a descent of a campaign from a state until touchdown or max_time
+void simulate_run(const struct batch_config_t *config, const double *initial_state,
+    struct run_result_t *result);
+
+// Fly a descent with a history, observer is called after every tick
+bool observe_run(const struct batch_config_t *config, const double *initial_state,
+    struct run_result_t *result, run_observer_t observer, void *context);
+
+// Fly a block of descents together with the vectorized fleet kernel, one result per run
+void simulate_fleet(struct fleet_t *fleet, const struct thrust_profile_t *profile,
+    double max_time, struct run_result_t *results);
+
+// Run a campaign on all workers, results is optional and holds one entry per run
+bool run_batch(const struct batch_config_t *config, struct batch_summary_t *summary,
+    struct run_result_t *results);
+
+void add_sample(struct statistics_t *stats, double x);
+
+void merge_statistics(struct statistics_t *stats, const struct statistics_t *other);
+
+double standard_deviation(const struct statistics_t *stats);
+
+void print_batch_summary(FILE *file, const struct batch_summary_t *summary);
+
+void print_run_results(FILE *file, const struct run_result_t *results, size_t runs);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef __DECIMATION__
+#define __DECIMATION__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Screen resolution summary of a growing 2D path, updated in O(1) amortized per point.
+// Sleeve fitting (Zhao & Saalfeld 1997): a point is only kept when the path leaves the
+// cone of directions from the last kept point that holds every dropped point within tolerance,
+// or stops moving away from it, so that a path doubling back keeps its turning point.
+struct decimation_t
+{
+    double scale_x, scale_z; // in px per m
+    double tolerance; // in px
+
+    size_t capacity, length;
+    double *x, *z; // kept points, in m
+
+    // Last point added, end of the polyline while not kept
+    bool has_tail;
+    double tail_x, tail_z;
+
+    // Directions from the last kept point allowed by the dropped points, relative to reference
+    bool has_cone;
+    double reference, lower, upper; // in rad
+    double farthest; // in px from the last kept point, of the points in the cone
+};
+
+// Allocate an empty summary for a pixel size and tolerance
+struct decimation_t* create_decimation(double scale_x, double scale_z, double tolerance);
+
+// Free memory for a summary
+struct decimation_t* free_decimation(struct decimation_t *decimation);
+
+// Remove all points, keep storage
+void clear_decimation(struct decimation_t *decimation);
+
+// Add the next point of the path
+bool add_point(struct decimation_t *decimation, double x, double z);
+
+// Number of points of the simplified polyline, kept points plus the tail
+size_t decimation_length(const struct decimation_t *decimation);
+
+// Copy the i-th point of the simplified polyline
+bool get_point(const struct decimation_t *decimation, size_t i, double *x, double *z);
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef __DESCENT__
+#define __DESCENT__
+
+#include "marslanding/dynamics.h"
+
+#include <stddef.h>
+
+// Header only kernels flying ticks under a constant joystick command, for batch runs. Same operations
+// as compute_thrust(), system_dynamics() and the euler() or rk4() step every tick, so results are bit
+// for bit those of forward_step() with the same integrator and no event location. The vehicle, gravity
+// and state are loaded once per call, and for Euler the dry and grounded branches of system_dynamics()
+// become the exit tests of one loop per phase. The vehicle is a plain parameter, so scenario files
+// and the compiled-in defaults share the kernels.
+
+// Integration scheme of a descent kernel
+enum descent_scheme_t
+{
+    DESCENT_EULER,
+    DESCENT_RK4
+};
+
+// Kernel state, kept in registers
+struct descent_state_t
+{
+    double px, pz, vx, vz, m;
+};
+
+// Thrust of a joystick command, thrust_command() with the gravity as a parameter
+static inline void descent_thrust(const struct vehicle_t *vehicle, double gravity, double joy_x, double joy_z,
+    double joy_n, double mass, struct thrust_t *thrust)
+{
+    if (joy_x == 0.0 && joy_z == 0.0)
+    {
+        thrust->x = 0.0;
+        thrust->z = gravity*mass;
+        thrust->norm = thrust->z;
+    }
+    else
+    {
+        thrust->norm = vehicle->rho_1 + (vehicle->rho_2-vehicle->rho_1)*joy_n;
+        thrust->x = joy_x*thrust->norm;
+        thrust->z = joy_z*thrust->norm;
+    }
+}
+
+// Ticks of an idle command, thrust compensates gravity with the mass of each tick
+static inline void descent_hover(double dry_mass, double alpha, double gravity, double step,
+    double end_time, double *s, double *time)
+{
+    double px = s[PX], pz = s[PZ], vx = s[VX], vz = s[VZ], m = s[M];
+    double t = *time;
+
+    while (t < end_time && pz > 0.0 && m > dry_mass)
+    {
+        double thrust_z = gravity*m;
+
+        double ax = 0.0/m;
+        double az = -gravity + thrust_z/m;
+        double dm = -alpha*thrust_z;
+
+        px = vx*step + px;
+        pz = vz*step + pz;
+        vx = ax*step + vx;
+        vz = az*step + vz;
+        m = dm*step + m;
+
+        t += step;
+    }
+
+    s[PX] = px; s[PZ] = pz; s[VX] = vx; s[VZ] = vz; s[M] = m;
+    *time = t;
+}
+
+// Ticks of a constant thrust vector, the mass flow is the same every tick
+static inline void descent_burn(double dry_mass, double alpha, double gravity, const struct thrust_t *thrust,
+    double step, double end_time, double *s, double *time)
+{
+    double px = s[PX], pz = s[PZ], vx = s[VX], vz = s[VZ], m = s[M];
+    double t = *time;
+
+    const double thrust_x = thrust->x, thrust_z = thrust->z;
+    const double dm = -alpha*thrust->norm;
+
+    while (t < end_time && pz > 0.0 && m > dry_mass)
+    {
+        double ax = thrust_x/m;
+        double az = -gravity + thrust_z/m;
+
+        px = vx*step + px;
+        pz = vz*step + pz;
+        vx = ax*step + vx;
+        vz = az*step + vz;
+        m = dm*step + m;
+
+        t += step;
+    }
+
+    s[PX] = px; s[PZ] = pz; s[VX] = vx; s[VZ] = vz; s[M] = m;
+    *time = t;
+}
+
+// Ticks of a dry lander, ballistic
+static inline void descent_coast(double gravity, double step, double end_time, double *s, double *time)
+{
+    double px = s[PX], pz = s[PZ], vx = s[VX], vz = s[VZ], m = s[M];
+    double t = *time;
+
+    const double ax = 0.0, az = -gravity, dm = 0.0;
+
+    while (t < end_time && pz > 0.0)
+    {
+        px = vx*step + px;
+        pz = vz*step + pz;
+        vx = ax*step + vx;
+        vz = az*step + vz;
+        m = dm*step + m;
+
+        t += step;
+    }
+
+    s[PX] = px; s[PZ] = pz; s[VX] = vx; s[VZ] = vz; s[M] = m;
+    *time = t;
+}
+
+// Fly Euler ticks of a joystick command until the ground or end_time.
+// Returns false when the lander is on the ground.
+static inline bool descent_euler(const struct vehicle_t *vehicle, double joy_x, double joy_z, double joy_n,
+    double step, double end_time, double *state, double *time)
+{
+    const double gravity = MARS_GRAVITY;
+
+    if (joy_x == 0.0 && joy_z == 0.0)
+    {
+        descent_hover(vehicle->dry_mass,vehicle->alpha,gravity,step,end_time,state,time);
+    }
+    else
+    {
+        struct thrust_t thrust;
+        descent_thrust(vehicle,gravity,joy_x,joy_z,joy_n,state[M],&thrust);
+
+        descent_burn(vehicle->dry_mass,vehicle->alpha,gravity,&thrust,step,end_time,state,time);
+    }
+
+    // Fuel ran out in flight
+    if (state[M] <= vehicle->dry_mass) descent_coast(gravity,step,end_time,state,time);
+
+    return state[PZ] > 0.0;
+}
+
+// Derivatives of a state under a thrust, same branches as system_dynamics()
+static inline void descent_dynamics(double dry_mass, double alpha, double gravity, const struct thrust_t *thrust,
+    const struct descent_state_t *s, struct descent_state_t *k)
+{
+    k->px = s->vx;
+    k->pz = s->vz;
+
+    if (s->m > dry_mass && s->pz > 0.0)
+    {
+        k->vx = thrust->x/s->m;
+        k->vz = -gravity + thrust->z/s->m;
+        k->m = -alpha*thrust->norm;
+    }
+    else if (s->m <= dry_mass && s->pz > 0.0)
+    {
+        k->vx = 0.0;
+        k->vz = -gravity;
+        k->m = 0.0;
+    }
+    else
+    {
+        k->vx = 0.0;
+        k->vz = 0.0;
+        k->m = 0.0;
+    }
+}
+
+// Stage state s + h*k of a Runge-Kutta step
+static inline void descent_stage(const struct descent_state_t *s, double h, const struct descent_state_t *k,
+    struct descent_state_t *stage)
+{
+    stage->px = s->px + h*k->px;
+    stage->pz = s->pz + h*k->pz;
+    stage->vx = s->vx + h*k->vx;
+    stage->vz = s->vz + h*k->vz;
+    stage->m = s->m + h*k->m;
+}
+
+// One component of the fourth order combination, summed in the order of rk4()
+static inline double descent_combine(double s, double step, double k0, double k1, double k2, double k3)
+{
+    double sum = 0.0;
+    sum += (1.0/6.0)*k0;
+    sum += (1.0/3.0)*k1;
+    sum += (1.0/3.0)*k2;
+    sum += (1.0/6.0)*k3;
+
+    return s + step*sum;
+}
+
+// Classic fourth order Runge-Kutta step, same operations as rk4()
+static inline void descent_rk4_step(double dry_mass, double alpha, double gravity, const struct thrust_t *thrust,
+    double step, struct descent_state_t *s)
+{
+    struct descent_state_t k0, k1, k2, k3, stage;
+
+    descent_dynamics(dry_mass,alpha,gravity,thrust,s,&k0);
+
+    descent_stage(s,0.5*step,&k0,&stage);
+    descent_dynamics(dry_mass,alpha,gravity,thrust,&stage,&k1);
+
+    descent_stage(s,0.5*step,&k1,&stage);
+    descent_dynamics(dry_mass,alpha,gravity,thrust,&stage,&k2);
+
+    descent_stage(s,step,&k2,&stage);
+    descent_dynamics(dry_mass,alpha,gravity,thrust,&stage,&k3);
+
+    s->px = descent_combine(s->px,step,k0.px,k1.px,k2.px,k3.px);
+    s->pz = descent_combine(s->pz,step,k0.pz,k1.pz,k2.pz,k3.pz);
+    s->vx = descent_combine(s->vx,step,k0.vx,k1.vx,k2.vx,k3.vx);
+    s->vz = descent_combine(s->vz,step,k0.vz,k1.vz,k2.vz,k3.vz);
+    s->m = descent_combine(s->m,step,k0.m,k1.m,k2.m,k3.m);
+}
+
+// Fly RK4 ticks of a joystick command until the ground or end_time.
+// Returns false when the lander is on the ground.
+static inline bool descent_rk4(const struct vehicle_t *vehicle, double joy_x, double joy_z, double joy_n,
+    double step, double end_time, double *state, double *time)
+{
+    const double gravity = MARS_GRAVITY;
+
+    struct descent_state_t s = {state[PX], state[PZ], state[VX], state[VZ], state[M]};
+    double t = *time;
+
+    const bool idle = (joy_x == 0.0 && joy_z == 0.0);
+    const double dry_mass = vehicle->dry_mass, alpha = vehicle->alpha;
+
+    struct thrust_t thrust;
+    descent_thrust(vehicle,gravity,joy_x,joy_z,joy_n,s.m,&thrust);
+
+    // Stages may cross the dry mass or the ground, so the branches stay in the dynamics
+    while (t < end_time && s.pz > 0.0)
+    {
+        // Gravity compensation follows the mass of each tick
+        if (idle) descent_thrust(vehicle,gravity,joy_x,joy_z,joy_n,s.m,&thrust);
+
+        descent_rk4_step(dry_mass,alpha,gravity,&thrust,step,&s);
+
+        t += step;
+    }
+
+    state[PX] = s.px; state[PZ] = s.pz; state[VX] = s.vx; state[VZ] = s.vz; state[M] = s.m;
+    *time = t;
+
+    return s.pz > 0.0;
+}
+
+// Fly ticks of a joystick command with a scheme.
+// Returns false when the lander is on the ground.
+static inline bool descent_fly(const struct vehicle_t *vehicle, enum descent_scheme_t scheme, double joy_x,
+    double joy_z, double joy_n, double step, double end_time, double *state, double *time)
+{
+    if (scheme == DESCENT_RK4)
+        return descent_rk4(vehicle,joy_x,joy_z,joy_n,step,end_time,state,time);
+
+    return descent_euler(vehicle,joy_x,joy_z,joy_n,step,end_time,state,time);
+}
+
+#endif
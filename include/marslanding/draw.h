@@ -3,29 +3,70 @@
 
 #include <stdbool.h> 
 
-#include "marslanding/state_list.h"
+#include "marslanding/dynamics.h"
+#include "marslanding/footprint.h"
+#include "marslanding/guidance.h"
+#include "marslanding/scenario.h"
+#include "marslanding/suggester.h"
+#include "marslanding/trajectory.h"
 
 const  extern int WINDOW_MARGIN;
 
 const extern int SCENE_X, SCENE_Y, SCENE_WIDTH, SCENE_HEIGHT;
-const extern double SCENE_MAX_Z, SCENE_MIN_X, SCENE_MAX_X;
 
 extern int scene_x, scene_y, scene_width, scene_height;
 double extern scene_delta_x, scene_delta_z;
+double extern scene_min_x, scene_max_x, scene_min_z, scene_max_z;
+double extern scene_initial_state[];
 
 const extern int GROUND_R, GROUND_G, GROUND_B, GROUND_A;
 
 const extern int TRAJ_R, TRAJ_G, TRAJ_B, TRAJ_A;
 
+const extern int FOOTPRINT_R, FOOTPRINT_G, FOOTPRINT_B, FOOTPRINT_A;
+
+const extern int SUGGEST_R, SUGGEST_G, SUGGEST_B, SUGGEST_A;
+
 const extern double VELOCITY_DRAW_FACTOR;
 const extern double THRUST_DRAW_FACTOR;
 
 const extern int SQUARE_WIDTH;
 
-void init_scene();
+const extern double HISTORY_TOLERANCE;
+
+const extern int FONT_SCALE;
+enum { FONT_MAX_LENGTH = 32 }; // in characters per line, sizes buffers
+
+// What the frame shows, set by the game or a headless renderer before drawing
+struct view_t
+{
+    struct lander_t *lander;
+    double render_alpha; // position between the last two physics ticks, in [0,1]
+    bool predict;
+    bool autopilot;
+    const struct guidance_t *plan; // flown autopilot plan, NULL without one
+    bool profile; // frame profile overlay
+    const struct footprint_result_t *footprint; // reachable landing band, NULL when hidden
+    const struct suggestion_t *suggestion; // suggested command, NULL when hidden
+};
+
+extern struct view_t view;
+
+extern int screen_width, screen_height;
+
+// Layout of the scene of a scenario in a target of a certain size, in px, NULL for the default one
+void init_scene(int width, int height, const struct scenario_t *scenario);
+
+void quit_scene();
+
+void draw_static_scene();
 
 void draw_scene();
 
+void invalidate_static_layer(bool resized);
+
+void draw_static_layer();
+
 void draw_scene_frame();
 
 void draw_frame(int x, int y, int w, int h);
@@ -46,7 +87,7 @@ void draw_objective();
 
 void draw_trajectory();
 
-void draw_state_list(struct state_list_t * list);
+void draw_state_list(const struct trajectory_t * traj);
 
 void draw_predicted_trajectory();
 
@@ -66,6 +107,16 @@ void draw_mass();
 
 void draw_mass_frame();
 
+void draw_text(int x, int y, const char *text);
+
+void draw_autopilot_status();
+
+void draw_footprint();
+
+void draw_suggestion();
+
+void draw_profile_overlay();
+
 void draw_all();
 
 #endif
\ No newline at end of file
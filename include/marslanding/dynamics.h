@@ -1,12 +1,19 @@
 #ifndef __DYNAMICS__
 #define __DYNAMICS__
 
-#include "marslanding/state_list.h"
+#include "marslanding/trajectory.h"
 
+#include <stdbool.h>
 #include <string.h>
 
 const extern double FORWARD_TIME_STEP;
 
+const extern size_t TRAJECTORY_CAPACITY;
+const extern size_t PREDICTION_CAPACITY;
+const extern double PREDICTION_THRUST_TOLERANCE;
+const extern double PREDICTION_STATE_TOLERANCE[];
+
+// Default vehicle parameters
 const extern double DRY_MASS;
 const extern double WET_MASS;
 const extern double ISP;
@@ -24,48 +31,104 @@ const extern char* STATE_UNITS[];
 
 const extern double INITIAL_STATE[];
 
-extern struct state_list_t * state_list;
-
-extern double current_thrust_x;
-extern double current_thrust_z;
-extern double current_thrust_norm;
-
-extern double cos_phi;
-extern double alpha;
-extern double rho_1, rho_2;
-
-extern bool is_dry;
-extern bool is_grounded;
-
-// Non-const copy of initial state
-double* copy_initial_state();
-
-// Initialize linked list of states with initial conditions
-void* init_state_list();
-
-// Initialize dynamics parameters
-void init_dynamics();
+struct integrator_t;
+
+// Thrust vector and norm, in N
+struct thrust_t
+{
+    double x, z, norm;
+};
+
+// Vehicle parameters and derived constants
+struct vehicle_t
+{
+    double dry_mass, wet_mass; // in kg
+    double isp; // in s
+    int nb_thrusters;
+    double t_1, t_2, t_bar; // throttle bounds and thrust per thruster in N
+    double phi; // cant angle in deg
+
+    // Derived
+    double cos_phi;
+    double alpha;
+    double rho_1, rho_2;
+};
+
+// Predicted trajectory, reused between frames while thrust and state are steady
+struct prediction_t
+{
+    struct trajectory_t *samples;
+    struct thrust_t thrust; // thrust used for the samples
+    const struct integrator_t *integrator; // integrator used for the samples
+    bool truncated; // stopped by capacity before ground or dry
+    bool valid;
+};
+
+// Simulation context of a single lander, independent from any other
+struct lander_t
+{
+    struct vehicle_t vehicle;
+
+    double time;
+    double state[TRAJECTORY_DIM];
+    struct thrust_t thrust;
+
+    bool is_dry;
+    bool is_grounded;
+
+    const struct integrator_t *integrator; // explicit Euler when NULL
+    bool locate_events; // stop steps exactly at touchdown and fuel depletion
+    double adaptive_step; // last step size of an adaptive integrator, in s
+    double prediction_resolution; // in m between analytic prediction samples, 0 for the default
+
+    struct trajectory_t *history; // optional record of past states
+    struct prediction_t prediction;
+};
+
+// Default vehicle parameters
+void init_vehicle(struct vehicle_t *vehicle);
+
+// Compute derived constants from vehicle parameters
+void derive_vehicle(struct vehicle_t *vehicle);
+
+// Allocate a lander with the default vehicle at the initial state, history_capacity may be 0
+struct lander_t* create_lander(size_t history_capacity);
+
+// Free memory for a lander
+struct lander_t* free_lander(struct lander_t *lander);
+
+// Restart a lander from a state with idle thrust
+void reset_lander(struct lander_t *lander, const double *state);
 
 // Integrate dynamics for a small time step
-double* forward_step(double *state, double step);
+bool forward_step(struct lander_t *lander, double step);
 
-double * euler(double *state, double step);
+bool euler(const struct lander_t *lander, const double *state, double step, double *new_state);
 
-// Integrate dynamics with small steps and store them in the global linked list
-void forward();
+// Integrate dynamics for one fixed time step
+void forward_tick(struct lander_t *lander);
 
-// Intergate dynamics for any duration and stores step in a linked list
-struct state_list_t * forward_duration(struct state_list_t *state, double duration);
+// Intergate dynamics for any duration with small steps
+bool forward_duration(struct lander_t *lander, double duration);
 
 // Compute system dynamics
-double* system_dynamics(double *state);
+bool system_dynamics(const struct lander_t *lander, const double *state, double *dynamics);
+
+// Predict trajectory with current thrust until ground or dry, reusing the previous prediction when possible
+const struct trajectory_t * predict(struct lander_t *lander);
+
+// Force the next prediction to be recomputed
+void invalidate_prediction(struct lander_t *lander);
 
-struct state_list_t * predict(struct state_list_t *state);
+// Thrust commanded by a unit direction and a magnitude in [0,1], gravity compensation when idle
+void thrust_command(const struct vehicle_t *vehicle, double joy_x, double joy_z, double joy_n,
+    double mass, struct thrust_t *thrust);
 
-void compute_thrust();
+// Update lander thrust from the joystick command
+void compute_thrust(struct lander_t *lander, double joy_x, double joy_z, double joy_n);
 
-void print_current_state();
+void print_current_state(const struct lander_t *lander);
 
-void print_current_thrust();
+void print_current_thrust(const struct lander_t *lander);
 
-#endif
\ No newline at end of file
+#endif
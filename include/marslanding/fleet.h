@@ -0,0 +1,44 @@
+#ifndef __FLEET__
+#define __FLEET__
+
+#include "marslanding/dynamics.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Many landers of the same vehicle, stored as one contiguous column per variable
+struct fleet_t
+{
+    struct vehicle_t vehicle;
+
+    size_t size;
+    size_t capacity; // padded to the widest vector
+    double *state[TRAJECTORY_DIM]; // PX, PZ, VX, VZ, M columns
+    double *thrust_x, *thrust_z, *thrust_norm;
+};
+
+// Allocate a fleet of size landers at the initial state with idle thrust
+struct fleet_t* create_fleet(size_t size, const struct vehicle_t *vehicle);
+
+// Free memory for a fleet
+struct fleet_t* free_fleet(struct fleet_t *fleet);
+
+// Set the state and thrust of the i-th lander
+void set_fleet_lander(struct fleet_t *fleet, size_t i, const double *state, const struct thrust_t *thrust);
+
+// Copy the state of the i-th lander
+void get_fleet_state(const struct fleet_t *fleet, size_t i, double *state);
+
+// Euler step of all landers with the widest available vector instructions
+void fleet_euler(struct fleet_t *fleet, double step);
+
+// Euler step of all landers one at a time
+void fleet_euler_scalar(struct fleet_t *fleet, double step);
+
+// Name of the instruction set used by fleet_euler
+const char* fleet_instruction_set();
+
+// Largest relative deviation between fleet_euler and the scalar euler over some steps
+double check_fleet_euler(struct fleet_t *fleet, double step, size_t steps);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef __FOOTPRINT__
+#define __FOOTPRINT__
+
+#include "marslanding/dynamics.h"
+#include "marslanding/planner.h"
+#include "marslanding/thread_pool.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+const extern int FOOTPRINT_BASE_ANGLES;
+const extern int FOOTPRINT_LEVELS;
+const extern double FOOTPRINT_PERIOD;
+const extern double FOOTPRINT_BURN_FRACTIONS[];
+const extern int FOOTPRINT_BURNS;
+
+// Touchdown points reachable from a state with the programs of the fan computed so far
+struct footprint_result_t
+{
+    bool valid;
+    double time; // of the state, in s
+    double x_min, x_max; // in m
+    size_t programs; // flown so far
+    int level; // of refinement, FOOTPRINT_LEVELS when complete
+    double solve_time; // wall time of the last level, in s
+};
+
+// State handed to the footprint thread
+struct footprint_request_t
+{
+    struct lander_t lander; // vehicle, time and state only
+};
+
+// Landing footprint refined on a background thread, levels fanned across a thread pool.
+// A fan program burns in a fixed direction at one of the thrust bounds for a fraction of the
+// fuel, then holds the lower bound upwards. Each level doubles the number of directions.
+struct footprint_t
+{
+    pthread_t thread;
+    sem_t wake;
+    atomic_bool quit;
+
+    struct thread_pool_t *pool;
+
+    // Owned by the footprint thread, a request quantized to the same key with the same vehicle
+    // refines the cached fan
+    struct lander_t lander; // state of the fan being refined
+    long key[TRAJECTORY_DIM];
+    int level; // next level to fly
+    double *touchdown_x; // per program of the level being flown
+    struct footprint_result_t fan; // programs flown so far
+
+    struct triple_buffer_t requests;
+    struct footprint_request_t request[3];
+
+    struct triple_buffer_t results;
+    struct footprint_result_t result[3];
+    bool published;
+};
+
+// Start the footprint thread with a pool of threads workers, 0 to leave one processor to the game
+struct footprint_t* create_footprint(int threads);
+
+// Stop the footprint thread and free memory for a footprint
+struct footprint_t* free_footprint(struct footprint_t *footprint);
+
+// Compute the footprint from the lander state, nothing to do when it did not change
+void request_footprint(struct footprint_t *footprint, const struct lander_t *lander);
+
+// Most recent footprint, NULL before the first one
+const struct footprint_result_t* latest_footprint(struct footprint_t *footprint);
+
+// Touchdown x of one program from a state, NAN when it never lands
+double program_touchdown(const struct lander_t *lander, double angle, double norm, double burn_fraction);
+
+#endif
@@ -1,24 +1,89 @@
 #ifndef __GAME__
 #define __GAME__
 
+#include "marslanding/dynamics.h"
+#include "marslanding/footprint.h"
+#include "marslanding/planner.h"
+#include "marslanding/recorder.h"
+#include "marslanding/replay.h"
+#include "marslanding/scenario.h"
+#include "marslanding/suggester.h"
+#include "marslanding/telemetry.h"
+
 #include <SDL2/SDL.h>
 #include <stdbool.h> 
+#include <stdint.h>
 
 // Game state
 bool extern GAME_PAUSED;
-bool extern GAME_OVER;
 bool extern QUIT;
 
 bool extern PREDICT;
+bool extern AUTOPILOT; // guidance replaces the joystick command
+bool extern PROFILE; // frame profile overlay
+bool extern FOOTPRINT; // reachable landing band
+bool extern SUGGEST; // suggested command to the objective
+
+// Fixed timestep scheduling
+const extern double MAX_FRAME_TIME;
+const extern int MAX_TICKS_PER_FRAME;
+const extern int FRAME_RATE_CAP;
+
+// Physics ticks run by a frame and time dropped to stay real time, see advance_simulation
+struct catch_up_t
+{
+    int tick_budget; // in ticks per frame, MAX_TICKS_PER_FRAME by default
+    bool amortize; // keep the backlog over budget for later frames instead of dropping it
+
+    unsigned long capped_frames; // frames that ran out of budget
+    unsigned long clamped_stalls; // frames longer than MAX_FRAME_TIME
+    double dropped_time; // in s never simulated
+    double max_backlog; // in s
+};
+
+extern struct catch_up_t catch_up;
+
+// Position of the rendered frame between the last two physics ticks, in [0,1]
+double extern render_alpha;
 
 double extern joy_thrust_x;
 double extern joy_thrust_z;
 double extern joy_thrust_n;
 
+// Lander flown with the joystick
+extern struct lander_t *lander;
+
+// Autopilot planning thread, asked for a plan every GUIDANCE_PERIOD of simulated time
+extern struct planner_t *planner;
+
+// Landing footprint thread, asked every FOOTPRINT_PERIOD of simulated time while shown
+extern struct footprint_t *footprint;
+
+// Suggested command thread, asked every SUGGEST_PERIOD of simulated time while shown
+extern struct suggester_t *suggester;
+
+// Flight log, NULL unless started with -l FILE
+extern struct recorder_t *recorder;
+
+// Input log to replay the session, NULL unless started with -i FILE
+extern struct input_log_t *input_log;
+
+// Physics ticks since the start of the session, pauses excluded
+uint64_t extern sim_tick;
+
+// State samples written on a background thread, NULL unless started with -t FORMAT
+extern struct telemetry_t *telemetry;
+
+// Vehicle, initial state and scene, defaults unless started with -S FILE
+extern struct scenario_t scenario;
+
+// Scenario file reloaded when saved, no path without -S
+extern struct scenario_watch_t scenario_watch;
+
 // Generic SDL Event for PollEvent loop
 extern SDL_Event event;
 
-int init_game();
+int init_game(int argc, char** argv);
 
 void print_start_ascii();
 
@@ -26,6 +91,16 @@ void print_start_help();
 
 void loop_game();
 
+void advance_simulation();
+
+void print_catch_up_stats();
+
+void command_tick();
+
+void update_autopilot(double *joy_x, double *joy_z, double *joy_n);
+
+void cap_frame_rate(Uint64 frame_start);
+
 void handle_events();
 
 void handle_joy_axis();
@@ -36,8 +111,16 @@ void normalize(double *x, double *z);
 
 void handle_joy_buttons();
 
+void reset_game();
+
+void update_scenario();
+
 void render_screen();
 
+const struct footprint_result_t* update_footprint();
+
+const struct suggestion_t* update_suggestion();
+
 void render_pause();
 
 void quit_game();
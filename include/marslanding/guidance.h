@@ -0,0 +1,75 @@
+#ifndef __GUIDANCE__
+#define __GUIDANCE__
+
+#include "marslanding/dynamics.h"
+#include "marslanding/profiler.h"
+#include "marslanding/socp.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+const extern size_t GUIDANCE_STEPS;
+const extern double GUIDANCE_PERIOD;
+const extern double LANDING_ERROR_WEIGHT;
+const extern double GUIDANCE_FUEL_RESERVE;
+const extern double GLIDE_SLOPE;
+const extern double GUIDANCE_TIME_BUDGET;
+const extern int GUIDANCE_SOLVE_ITERATIONS;
+
+// Solve time and outcome of the plans
+struct guidance_stats_t
+{
+    size_t plans, failures;
+    size_t late; // plans cut by GUIDANCE_TIME_BUDGET
+    size_t solves; // one per final time tried
+    size_t iterations; // interior point iterations over all solves
+    double last_time, total_time, max_time; // per plan, in s
+    struct profile_histogram_t times; // per plan
+};
+
+// Fuel-optimal descent to the objective, lossless convexification of Acikmese & Ploen 2007.
+// With z = ln(m), u = T/m and sigma = |T|/m the dynamics are linear and the thrust bounds
+// rho_1 <= |T| <= rho_2 become convex around the maximum thrust mass profile.
+struct guidance_t
+{
+    size_t steps; // piecewise constant command intervals
+    struct socp_t *problem;
+
+    // Best plan of the last search
+    bool valid;
+    double start_time; // lander time of the planned state
+    double final_time; // duration of the descent, in s
+    double landing_error; // in m, distance to the objective at touchdown
+    double fuel; // in kg
+    double *acceleration_x, *acceleration_z, *sigma; // thrust over mass, per interval
+
+    struct guidance_stats_t stats;
+};
+
+// Allocate a plan without a problem, to hold copies of planned descents
+struct guidance_t* create_plan(size_t steps);
+
+// Allocate a planner with a number of command intervals
+struct guidance_t* create_guidance(size_t steps);
+
+// Free memory for a planner
+struct guidance_t* free_guidance(struct guidance_t *guidance);
+
+// Copy the plan and statistics of a planner, both with the same number of steps
+void copy_plan(struct guidance_t *to, const struct guidance_t *from);
+
+// Plan a descent from the lander state, searching the final time around the previous plan, within
+// GUIDANCE_TIME_BUDGET. Returns false when no soft landing was found, the previous plan is then kept
+// until it ends.
+bool plan_descent(struct guidance_t *guidance, const struct lander_t *lander);
+
+// Joystick command following the plan at the lander time, false when no plan covers it
+bool guidance_command(const struct guidance_t *guidance, const struct lander_t *lander,
+    double *joy_x, double *joy_z, double *joy_n);
+
+// 99th percentile of the plan times, in s
+double guidance_p99(const struct guidance_t *guidance);
+
+void print_guidance_stats(const struct guidance_t *guidance);
+
+#endif
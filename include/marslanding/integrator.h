@@ -0,0 +1,62 @@
+#ifndef __INTEGRATOR__
+#define __INTEGRATOR__
+
+#include "marslanding/dynamics.h"
+
+#include <stdbool.h>
+
+// Discrete events located by the integrator
+enum event_t
+{
+    EVENT_NONE = 0,
+    EVENT_TOUCHDOWN = 1, // PZ reaches 0
+    EVENT_DRY = 2 // M reaches the dry mass
+};
+
+// Explicit one-step method
+struct integrator_t
+{
+    const char *name;
+    bool adaptive; // step size controlled by the error estimate
+    double prediction_step; // sample interval of predicted trajectories, in s
+
+    // One step, the error is only estimated by adaptive methods, relative to the tolerance
+    bool (*step)(const struct lander_t *lander, const double *state, double step,
+        double *new_state, double *error);
+};
+
+const extern double INTEGRATOR_ABSOLUTE_TOLERANCE;
+const extern double INTEGRATOR_RELATIVE_TOLERANCE;
+const extern double EVENT_TOLERANCE;
+
+const extern struct integrator_t EULER_INTEGRATOR;
+const extern struct integrator_t RK4_INTEGRATOR;
+const extern struct integrator_t RK45_INTEGRATOR;
+const extern struct integrator_t ANALYTIC_INTEGRATOR; // closed form, see propagator.h
+
+// All integrators, NULL terminated
+const extern struct integrator_t *INTEGRATORS[];
+
+// Integrator by name, NULL if unknown
+const struct integrator_t* find_integrator(const char *name);
+
+// Next integrator in INTEGRATORS, wrapping around
+const struct integrator_t* next_integrator(const struct integrator_t *integrator);
+
+// Integrator of a lander, explicit Euler by default
+const struct integrator_t* lander_integrator(const struct lander_t *lander);
+
+// Classic fourth order Runge-Kutta step
+bool rk4(const struct lander_t *lander, const double *state, double step, double *new_state);
+
+// Dormand-Prince 5(4) step with embedded error estimate
+bool dormand_prince(const struct lander_t *lander, const double *state, double step,
+    double *new_state, double *error);
+
+// Integrate a state in place for a duration with the lander integrator, stopping at touchdown
+// when events are located. adaptive_step carries the step size between calls (may be NULL),
+// events receives the located events. Returns the time advanced, negative on failure.
+double integrate(const struct lander_t *lander, double *state, double duration,
+    double *adaptive_step, int *events);
+
+#endif
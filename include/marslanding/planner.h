@@ -0,0 +1,73 @@
+#ifndef __PLANNER__
+#define __PLANNER__
+
+#include "marslanding/dynamics.h"
+#include "marslanding/guidance.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Latest value exchanged between one writer and one reader without locks.
+// Three slots: the writer fills back, the reader owns front, publishing swaps back with middle.
+struct triple_buffer_t
+{
+    atomic_uint middle; // slot index, TRIPLE_BUFFER_FRESH set until the reader takes it
+    unsigned int back, front;
+};
+
+const extern unsigned int TRIPLE_BUFFER_FRESH;
+
+void init_triple_buffer(struct triple_buffer_t *buffer);
+
+// Publish the back slot, the writer then fills the returned one
+unsigned int publish_back(struct triple_buffer_t *buffer);
+
+// Take the latest published slot as front, false when nothing new was published
+bool acquire_front(struct triple_buffer_t *buffer);
+
+// Lander snapshot handed to the planning thread
+struct planner_request_t
+{
+    struct lander_t lander; // vehicle, time, state and flags only, no history or prediction
+    unsigned long epoch;
+};
+
+// Guidance re-planned on a background thread, the game loop never waits for a solve
+struct planner_t
+{
+    pthread_t thread;
+    sem_t wake; // posted for each request, never blocks the poster
+    atomic_bool quit;
+    atomic_ulong epoch; // bumped on reset, plans of older epochs are dropped
+
+    // Owned by the planning thread, the previous plan warm starts the final time search
+    struct guidance_t *guidance;
+
+    struct triple_buffer_t requests;
+    struct planner_request_t request[3];
+
+    struct triple_buffer_t plans;
+    struct guidance_t *plan[3];
+    unsigned long plan_epoch[3];
+    bool published; // a plan was read at least once
+};
+
+// Start the planning thread for plans with a number of command intervals
+struct planner_t* create_planner(size_t steps);
+
+// Stop the planning thread and free memory for a planner
+struct planner_t* free_planner(struct planner_t *planner);
+
+// Queue a plan from the lander state, replacing any request not started yet
+void request_plan(struct planner_t *planner, const struct lander_t *lander);
+
+// Drop the plans of states before a reset
+void reset_planner(struct planner_t *planner);
+
+// Most recent plan, NULL before the first one, invalid when it predates a reset
+const struct guidance_t* latest_plan(struct planner_t *planner);
+
+#endif
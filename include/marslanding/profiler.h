@@ -0,0 +1,79 @@
+#ifndef __PROFILER__
+#define __PROFILER__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Timed parts of a frame, zones may nest
+enum profile_zone_t
+{
+    PROFILE_FRAME = 0, // whole frame without the frame rate cap sleep
+    PROFILE_EVENTS,
+    PROFILE_PHYSICS, // fixed ticks, commands included
+    PROFILE_COMMAND, // joystick or autopilot thrust of a tick
+    PROFILE_DRAW,
+    PROFILE_PREDICT, // part of the drawing
+    PROFILE_PRESENT,
+    PROFILE_ZONES
+};
+
+// Log-linear buckets, PROFILE_SUBBUCKETS per power of two of ns
+enum { PROFILE_SUBBUCKETS = 8, PROFILE_BUCKETS = 64*PROFILE_SUBBUCKETS };
+
+const extern char *PROFILE_ZONE_NAMES[];
+const extern double PROFILE_WINDOW;
+
+struct profile_histogram_t
+{
+    uint32_t counts[PROFILE_BUCKETS];
+    uint64_t count;
+    uint64_t total; // in ns
+    uint64_t max; // in ns
+};
+
+// Percentiles of a histogram, in s, within an eighth of an octave
+struct profile_summary_t
+{
+    uint64_t count;
+    double mean, p50, p99, max;
+};
+
+struct profile_zone_stats_t
+{
+    struct profile_histogram_t total; // since start
+    struct profile_histogram_t window; // current window
+    struct profile_summary_t shown; // last complete window
+};
+
+// Timings of the game thread, not thread safe
+struct profiler_t
+{
+    uint64_t window_start; // in ns
+    struct profile_zone_stats_t zones[PROFILE_ZONES];
+};
+
+extern struct profiler_t profiler;
+
+// Monotonic clock in ns
+uint64_t profile_clock();
+
+// Start a timed scope, pass the result to profile_end
+uint64_t profile_begin();
+
+void profile_end(enum profile_zone_t zone, uint64_t start);
+
+// Once per frame, publishes the summaries of a window every PROFILE_WINDOW
+void profile_frame();
+
+// Count a duration in a histogram
+void add_duration(struct profile_histogram_t *histogram, uint64_t ns);
+
+void summarize_histogram(const struct profile_histogram_t *histogram, struct profile_summary_t *summary);
+
+// Table of the zones since start, in ms
+void print_profile(FILE *file);
+
+bool write_profile(const char *path);
+
+#endif
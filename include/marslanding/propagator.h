@@ -0,0 +1,47 @@
+#ifndef __PROPAGATOR__
+#define __PROPAGATOR__
+
+#include "marslanding/dynamics.h"
+#include "marslanding/integrator.h"
+#include "marslanding/trajectory.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+const extern double PREDICTION_RESOLUTION;
+const extern double PREDICTION_MAX_INTERVAL;
+
+// Constant thrust flight from a state, wet with linearly decreasing mass then ballistic
+struct arc_t
+{
+    double start_time;
+    double state[TRAJECTORY_DIM]; // at start_time
+    struct thrust_t thrust;
+    double dry_mass;
+    double flow; // mass flow in kg/s
+
+    double dry_time; // INFINITY when never dry
+    double dry_state[TRAJECTORY_DIM]; // at dry_time
+};
+
+// Closed-form arc of a vehicle with a constant thrust, starting at a time and state
+void init_arc(struct arc_t *arc, const struct vehicle_t *vehicle, const struct thrust_t *thrust,
+    double time, const double *state);
+
+// State at any time after the start, ignoring the ground
+void arc_state(const struct arc_t *arc, double time, double *state);
+
+// Time of the first ground impact, the start time when already grounded
+double arc_touchdown_time(const struct arc_t *arc);
+
+// Exact step stopping at touchdown, integrator interface
+bool arc_step(const struct lander_t *lander, const double *state, double step,
+    double *new_state, double *error);
+
+// Jump the lander a duration ahead with its current thrust, stopping at touchdown
+bool forward_arc(struct lander_t *lander, double duration);
+
+// Append samples every resolution meters along the arc until end_time, returns false when full
+bool sample_arc(const struct arc_t *arc, double end_time, double resolution, struct trajectory_t *samples);
+
+#endif
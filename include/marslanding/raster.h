@@ -0,0 +1,42 @@
+#ifndef __RASTER__
+#define __RASTER__
+
+#include "marslanding/render.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Software render target, RGBA pixels in memory order, rows without padding
+struct framebuffer_t
+{
+    int width, height;
+    uint32_t *pixels;
+    uint32_t *layer; // cached layer, allocated on first use
+    uint32_t *target; // pixels, or layer while drawing it
+    bool has_layer;
+
+    uint32_t color;
+    int alpha;
+
+    struct render_backend_t backend;
+};
+
+// Allocate a white framebuffer
+struct framebuffer_t* create_framebuffer(int width, int height);
+
+// Free memory for a framebuffer
+struct framebuffer_t* free_framebuffer(struct framebuffer_t *framebuffer);
+
+// Pixel at a position, as r, g, b and a bytes
+void get_pixel(const struct framebuffer_t *framebuffer, int x, int y, unsigned char *rgba);
+
+// Binary PPM of the pixels, alpha dropped
+bool write_ppm(const struct framebuffer_t *framebuffer, const char *path);
+
+// RGB PNG of the pixels, compressed with runs of pixels and rows only
+bool write_png(const struct framebuffer_t *framebuffer, const char *path);
+
+// PNG when the path ends with .png, PPM otherwise
+bool write_frame(const struct framebuffer_t *framebuffer, const char *path);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef __RECORDER__
+#define __RECORDER__
+
+#include "marslanding/dynamics.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+const extern char RECORDER_MAGIC[8];
+const extern uint32_t RECORDER_VERSION;
+const extern size_t RECORDER_INITIAL_CAPACITY;
+
+// Start of a flight log, followed by count records
+struct recorder_header_t
+{
+    char magic[8];
+    uint32_t version; // bumped when the record layout changes
+    uint32_t header_size;
+    uint32_t record_size;
+    uint32_t reserved;
+    uint64_t count; // complete records, updated after each one
+    double time_step; // in s between ticks
+    double dry_mass; // in kg
+};
+
+// One physics tick, in the byte order of the recording machine
+struct flight_record_t
+{
+    double time;
+    double state[TRAJECTORY_DIM];
+    double thrust_x, thrust_z, thrust_norm; // in N
+    double joy_x, joy_z, joy_n; // joystick axes as read, the autopilot may override them
+};
+
+// Append-only flight log mapped in memory, grown by doubling
+struct recorder_t
+{
+    int file;
+    bool writable;
+    size_t capacity; // records the mapping can hold
+    size_t size; // of the mapping, in bytes
+    void *map;
+    struct recorder_header_t *header;
+    struct flight_record_t *records;
+};
+
+// Create a log for a vehicle, replacing any file at path
+struct recorder_t* create_recorder(const char *path, const struct vehicle_t *vehicle);
+
+// Open an existing log read only, NULL when the header does not match this version
+struct recorder_t* open_recorder(const char *path);
+
+// Trim the file to its records and free memory for a log
+struct recorder_t* close_recorder(struct recorder_t *recorder);
+
+// Append the lander state and command of a tick
+bool record_tick(struct recorder_t *recorder, const struct lander_t *lander,
+    double joy_x, double joy_z, double joy_n);
+
+size_t record_count(const struct recorder_t *recorder);
+
+const struct flight_record_t* get_record(const struct recorder_t *recorder, size_t i);
+
+// Header line and one CSV row per record
+void print_records_csv(FILE *file, const struct recorder_t *recorder);
+
+#endif
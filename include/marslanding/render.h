@@ -0,0 +1,62 @@
+#ifndef __RENDER__
+#define __RENDER__
+
+#include <stdbool.h>
+
+struct render_point_t
+{
+    int x, y;
+};
+
+struct render_rect_t
+{
+    int x, y, w, h;
+};
+
+// Drawing primitives of a render target, an SDL renderer or a software framebuffer
+struct render_backend_t
+{
+    const char *name;
+    void *context;
+
+    void (*set_color)(void *context, int r, int g, int b, int a);
+    void (*clear)(void *context);
+    void (*fill_rects)(void *context, const struct render_rect_t *rects, int count);
+    void (*draw_lines)(void *context, const struct render_point_t *points, int count);
+    void (*draw_points)(void *context, const struct render_point_t *points, int count);
+
+    // Cached layer, optional: primitives between begin and end draw into the layer,
+    // draw_layer covers the target with it and fails once the layer is lost
+    bool (*begin_layer)(void *context);
+    void (*end_layer)(void *context);
+    bool (*draw_layer)(void *context);
+    void (*drop_layer)(void *context);
+};
+
+// Target of the draw functions
+extern struct render_backend_t *renderer;
+
+void render_color(int r, int g, int b, int a);
+
+void render_clear();
+
+void render_fill_rect(const struct render_rect_t *rect);
+
+void render_fill_rects(const struct render_rect_t *rects, int count);
+
+void render_lines(const struct render_point_t *points, int count);
+
+void render_points(const struct render_point_t *points, int count);
+
+// Start drawing into the cached layer, false when the backend has none
+bool render_begin_layer();
+
+void render_end_layer();
+
+// Cover the target with the cached layer, false when it must be drawn again
+bool render_layer();
+
+// Release the cached layer, after a size change
+void render_drop_layer();
+
+#endif
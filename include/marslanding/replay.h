@@ -0,0 +1,117 @@
+#ifndef __REPLAY__
+#define __REPLAY__
+
+#include "marslanding/dynamics.h"
+#include "marslanding/integrator.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+const extern int REPLAY_VERSION;
+const extern uint64_t REPLAY_SNAPSHOT_PERIOD;
+
+// Inputs that change the simulation, applied before the tick they are keyed to
+enum input_type_t
+{
+    INPUT_COMMAND = 0, // joystick or autopilot command, held until the next one
+    INPUT_INTEGRATOR = 1,
+    INPUT_RESET = 2, // back to the initial state
+    INPUT_SCENARIO = 3 // new vehicle and initial state, then reset
+};
+
+struct input_event_t
+{
+    uint64_t tick; // physics ticks since the start of the session, pauses excluded
+    enum input_type_t type;
+    double joy_x, joy_z, joy_n; // commands only
+    const struct integrator_t *integrator; // integrator changes only
+    struct vehicle_t vehicle; // scenario changes only, derived
+    double state[TRAJECTORY_DIM]; // scenario changes only
+};
+
+// Input stream of a session, written as it is played
+struct input_log_t
+{
+    FILE *file;
+    bool has_command;
+    double joy_x, joy_z, joy_n; // last command written
+};
+
+// Replay position at the start of a tick, before its inputs
+struct replay_snapshot_t
+{
+    uint64_t tick;
+    size_t next_event;
+    double command[3];
+
+    double time;
+    double state[TRAJECTORY_DIM];
+    struct thrust_t thrust;
+    bool is_dry;
+    bool is_grounded;
+    const struct integrator_t *integrator;
+    double adaptive_step;
+    struct vehicle_t vehicle;
+    double reset_state[TRAJECTORY_DIM];
+};
+
+// Session re-simulated from its input stream, bit for bit
+struct replay_t
+{
+    double initial_state[TRAJECTORY_DIM];
+    const struct integrator_t *initial_integrator;
+    bool locate_events;
+    uint64_t end_tick; // UINT64_MAX when the log was not closed
+
+    struct input_event_t *events;
+    size_t event_count;
+
+    struct lander_t *lander; // without history
+    uint64_t tick;
+    size_t next_event;
+    double command[3];
+    double reset_state[TRAJECTORY_DIM]; // initial state of the current scenario
+
+    // Every REPLAY_SNAPSHOT_PERIOD ticks, taken the first time a tick is reached
+    struct replay_snapshot_t *snapshots;
+    size_t snapshot_count, snapshot_capacity;
+};
+
+// Start the input log of a session from the current lander state and integrator
+struct input_log_t* create_input_log(const char *path, const struct lander_t *lander);
+
+// Write the last tick of the session and free memory for a log
+struct input_log_t* close_input_log(struct input_log_t *log, uint64_t tick);
+
+// Log the command of a tick, only when it differs from the previous one
+void log_command(struct input_log_t *log, uint64_t tick, double joy_x, double joy_z, double joy_n);
+
+void log_integrator(struct input_log_t *log, uint64_t tick, const struct integrator_t *integrator);
+
+void log_reset(struct input_log_t *log, uint64_t tick);
+
+// Log a scenario change, the vehicle parameters and initial state
+void log_scenario(struct input_log_t *log, uint64_t tick, const struct vehicle_t *vehicle,
+    const double *initial_state);
+
+// Load an input log, positioned at tick 0
+struct replay_t* load_replay(const char *path);
+
+// Free memory for a replay
+struct replay_t* free_replay(struct replay_t *replay);
+
+// Back to tick 0, snapshots are kept
+void rewind_replay(struct replay_t *replay);
+
+// Apply the inputs of the current tick and run it, false at the end of the session or on the ground
+bool step_replay(struct replay_t *replay);
+
+// Step up to a tick, false when the session stops before
+bool run_replay(struct replay_t *replay, uint64_t tick);
+
+// Jump to a tick from the closest snapshot before it, false when the session stops before
+bool seek_replay(struct replay_t *replay, uint64_t tick);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef __SCENARIO__
+#define __SCENARIO__
+
+#include "marslanding/dynamics.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+// Default scene bounds
+const extern double SCENE_MIN_Z, SCENE_MAX_Z;
+const extern double SCENE_MIN_X, SCENE_MAX_X;
+
+const extern double SCENARIO_CHECK_PERIOD;
+
+// Vehicle, initial state and scene of a mission, loaded from a text file of key = value lines
+struct scenario_t
+{
+    char name[64];
+    struct vehicle_t vehicle; // derived constants computed once loaded
+    double initial_state[TRAJECTORY_DIM];
+    double scene_min_x, scene_max_x, scene_min_z, scene_max_z; // in m
+};
+
+// Scenario file followed for changes
+struct scenario_watch_t
+{
+    const char *path;
+    struct timespec modified; // of the loaded version
+    double next_check; // in s of wall time
+};
+
+// Default vehicle, initial state and scene
+void init_scenario(struct scenario_t *scenario);
+
+// Set a parameter by its file key, false for an unknown key or a value the key cannot hold.
+// Derive the vehicle again after it.
+bool set_scenario_value(struct scenario_t *scenario, const char *key, double value);
+
+// Check physical consistency, error holds the reason when false
+bool validate_scenario(const struct scenario_t *scenario, char *error, size_t size);
+
+// Parse key = value lines over the defaults, then derive and validate. Missing m is the wet mass.
+bool parse_scenario(const char *text, size_t length, struct scenario_t *scenario, char *error, size_t size);
+
+// Load, derive and validate a scenario file, the scenario is unchanged on error
+bool load_scenario(const char *path, struct scenario_t *scenario, char *error, size_t size);
+
+// Start watching a loaded scenario file
+void watch_scenario(struct scenario_watch_t *watch, const char *path);
+
+// Reload the file when it changed since the last load, at most every SCENARIO_CHECK_PERIOD.
+// True when the scenario was replaced, an invalid file keeps the scenario and fills error.
+bool reload_scenario(struct scenario_watch_t *watch, double now, struct scenario_t *scenario,
+    char *error, size_t size);
+
+void print_scenario(const struct scenario_t *scenario);
+
+#endif
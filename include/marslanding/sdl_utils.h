@@ -1,6 +1,8 @@
 #ifndef __SDL_UTILS__
 #define __SDL_UTILS__
 
+#include "marslanding/render.h"
+
 #include <SDL2/SDL.h>
 #include <stdbool.h> 
 
@@ -11,6 +13,10 @@ extern SDL_Window *window;
 extern SDL_Renderer *screen;
 const extern int SCREEN_WIDTH;  
 const extern int SCREEN_HEIGHT;
+const extern bool VSYNC;
+
+// Draw functions backend on the main screen
+extern struct render_backend_t sdl_backend;
 
 // Gamepad 
 extern SDL_Joystick* gamepad;
@@ -20,8 +26,9 @@ const extern bool JOY_MANDATORY;
 // Timer
 struct timer_t
 {
-    Uint32 current_tick;
-    Uint32 previous_tick;
+    Uint64 current_tick;
+    Uint64 previous_tick;
+    double accumulator; // elapsed time not yet simulated, in s
 };
 extern struct timer_t timer;
 
@@ -34,6 +41,9 @@ bool init_joystick();
 // Initialize timer
 void init_timer();
 
+// Seconds elapsed since previous update or initialization
+double update_timer();
+
 // Destroy screen + window and quit SDL
 void quit_sdl();
 
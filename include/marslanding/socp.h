@@ -0,0 +1,71 @@
+#ifndef __SOCP__
+#define __SOCP__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Outcome of an interior-point solve
+enum socp_status_t
+{
+    SOCP_OPTIMAL = 0,
+    SOCP_MAX_ITERATIONS = 1, // no convergence, usually an infeasible problem
+    SOCP_NUMERICAL_ERROR = 2,
+    SOCP_DEADLINE = 3 // stopped at the deadline before convergence
+};
+
+struct socp_workspace_t;
+
+// Dense second-order cone program
+//   minimize c'x subject to Ax = b, Gx + s = h, s in K
+// K is a nonnegative orthant of dimension l followed by second-order cones
+// {(s0,s1) : |s1| <= s0} of dimensions cone_dims
+struct socp_t
+{
+    size_t n; // variables
+    size_t p; // equality constraints
+    size_t l; // nonnegative orthant rows
+    size_t nb_cones;
+    size_t *cone_dims;
+    size_t m; // cone rows, l plus all cone dimensions
+
+    double *c; // n
+    double *A; // p x n, row major
+    double *b; // p
+    double *G; // m x n, row major
+    double *h; // m
+
+    // Limits of a solve, SOCP_MAX_ITERATIONS_COUNT and no deadline by default
+    int max_iterations;
+    double deadline; // in s of socp_clock()
+
+    // Primal and dual solution
+    double *x, *y, *z, *s;
+
+    int iterations;
+    double gap; // s'z
+    double residual; // largest relative primal or dual residual
+
+    struct socp_workspace_t *work;
+};
+
+const extern int SOCP_MAX_ITERATIONS_COUNT;
+const extern double SOCP_FEASIBILITY_TOLERANCE;
+const extern double SOCP_ABSOLUTE_TOLERANCE;
+const extern double SOCP_RELATIVE_TOLERANCE;
+
+// Allocate a zeroed problem, cone_dims holds nb_cones dimensions of at least 2
+struct socp_t* create_socp(size_t n, size_t p, size_t l, size_t nb_cones, const size_t *cone_dims);
+
+// Free memory for a problem
+struct socp_t* free_socp(struct socp_t *socp);
+
+// Zero the problem data before filling it again
+void clear_socp(struct socp_t *socp);
+
+// Monotonic clock in s, for deadlines
+double socp_clock();
+
+// Primal-dual interior point with Nesterov-Todd scaling and Mehrotra correction
+enum socp_status_t solve_socp(struct socp_t *socp);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef __SUGGESTER__
+#define __SUGGESTER__
+
+#include "marslanding/dynamics.h"
+#include "marslanding/planner.h"
+#include "marslanding/thread_pool.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+const extern double SUGGEST_PERIOD;
+const extern double SUGGEST_BUDGET;
+const extern double SUGGEST_SPEED_WEIGHT;
+const extern int SUGGEST_ANGLES, SUGGEST_MAGNITUDES;
+const extern int SUGGEST_SEEDS;
+const extern double SUGGEST_SWITCH_FRACTIONS[];
+const extern int SUGGEST_SWITCHES;
+const extern int SUGGEST_REFINEMENTS;
+
+// Joystick command, unit direction and magnitude in [0,1], idle when the direction is zero
+struct suggest_command_t
+{
+    double joy_x, joy_z, joy_n;
+};
+
+// Command of the search space: a direction angle from the vertical and a magnitude held until
+// switch_time, then a second one until touchdown
+struct suggest_candidate_t
+{
+    double angle[2]; // in rad, NAN for the idle command
+    double magnitude[2]; // in [0,1]
+    double switch_time; // in s of lander time, INFINITY for a constant command
+};
+
+// Best command found from a state, to hit the objective softly
+struct suggestion_t
+{
+    bool valid;
+    double time; // lander time of the state
+    struct suggest_candidate_t candidate;
+    double miss; // in m from the objective at touchdown
+    double speed; // in m/s at touchdown
+    double cost; // miss plus SUGGEST_SPEED_WEIGHT times speed, in m
+    size_t candidates; // flown by the search
+    double solve_time; // wall time of the search, in s
+};
+
+// Suggested command searched on a background thread, candidates flown across a work-stealing pool
+struct suggester_t
+{
+    pthread_t thread;
+    sem_t wake;
+    atomic_bool quit;
+
+    // Owned by the suggestion thread
+    struct thread_pool_t *pool;
+    struct suggest_candidate_t *candidates;
+    double *costs; // per candidate
+    double *touchdown_times; // per candidate
+    size_t capacity;
+
+    struct triple_buffer_t requests;
+    struct lander_t request[3]; // vehicle, time and state only
+
+    struct triple_buffer_t results;
+    struct suggestion_t result[3];
+    bool published;
+};
+
+// Start the suggestion thread with a pool of threads workers, 0 to leave one processor to the game
+struct suggester_t* create_suggester(int threads);
+
+// Stop the suggestion thread and free memory for a suggester
+struct suggester_t* free_suggester(struct suggester_t *suggester);
+
+// Search a command from the lander state, replacing any request not started yet
+void request_suggestion(struct suggester_t *suggester, const struct lander_t *lander);
+
+// Most recent suggestion, NULL before the first one
+const struct suggestion_t* latest_suggestion(struct suggester_t *suggester);
+
+// Search the best command within a wall time budget in s, on the calling thread.
+// Not to be called while the suggestion thread has a request.
+void search_suggestion(struct suggester_t *suggester, const struct lander_t *lander, double budget,
+    struct suggestion_t *suggestion);
+
+// Touchdown cost of a candidate from a state, INFINITY when it never lands
+double fly_candidate(const struct lander_t *lander, const struct suggest_candidate_t *candidate,
+    double *miss, double *speed, double *touchdown_time);
+
+// Joystick command of a candidate at a lander time
+void candidate_command(const struct suggest_candidate_t *candidate, double time,
+    struct suggest_command_t *command);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __TELEMETRY__
+#define __TELEMETRY__
+
+#include "marslanding/dynamics.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+const extern size_t TELEMETRY_CAPACITY;
+const extern double TELEMETRY_DEFAULT_RATE;
+
+enum telemetry_format_t
+{
+    TELEMETRY_HUMAN = 0, // one line per sample
+    TELEMETRY_CSV = 1, // header line first
+    TELEMETRY_JSON = 2 // one object per line
+};
+
+// Lander state at a tick, copied into the queue
+struct telemetry_sample_t
+{
+    uint64_t tick;
+    double time;
+    double state[TRAJECTORY_DIM];
+    struct thrust_t thrust;
+    bool is_grounded;
+};
+
+// Samples formatted and written on a background thread, the simulation never waits for the output.
+// Single producer, single consumer ring: the producer owns head, the consumer owns tail.
+struct telemetry_t
+{
+    pthread_t thread;
+    sem_t wake; // posted for each sample, never blocks the poster
+    atomic_bool quit;
+
+    FILE *file;
+    enum telemetry_format_t format;
+
+    struct telemetry_sample_t *samples; // TELEMETRY_CAPACITY slots
+    _Alignas(64) atomic_size_t head; // next slot written
+    _Alignas(64) atomic_size_t tail; // next slot formatted
+
+    // Producer side
+    _Alignas(64) double period; // in s of simulated time between samples
+    double next_time, last_time;
+    size_t pushed;
+    size_t dropped; // queue full, the writer is behind
+};
+
+// Format by name, human, csv or json, false if unknown
+bool find_telemetry_format(const char *name, enum telemetry_format_t *format);
+
+// Start the writing thread for a number of samples per simulated second
+struct telemetry_t* create_telemetry(FILE *file, enum telemetry_format_t format, double rate);
+
+// Write the queued samples, stop the writing thread and free memory for telemetry
+struct telemetry_t* free_telemetry(struct telemetry_t *telemetry);
+
+// Queue the lander state when a sample is due, at touchdown or after a reset. Drops it when full.
+void push_telemetry(struct telemetry_t *telemetry, const struct lander_t *lander, uint64_t tick);
+
+void print_telemetry_stats(const struct telemetry_t *telemetry);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef __THREAD_POOL__
+#define __THREAD_POOL__
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Task run on the [begin,end) slice of a parallel loop by a worker
+typedef void (*pool_task_t)(void *context, size_t begin, size_t end, int worker);
+
+struct thread_pool_t;
+
+// Worker thread and its index in the pool
+struct pool_worker_t
+{
+    struct thread_pool_t *pool;
+    pthread_t thread;
+    int id;
+
+    // Iterations left to the worker, begin in the high half and end in the low half.
+    // The worker takes chunks from the front, idle workers steal the back half.
+    _Alignas(64) atomic_uint_least64_t range;
+};
+
+// Fixed set of worker threads running parallel loops
+struct thread_pool_t
+{
+    int size; // number of workers, including the calling thread as worker 0
+    struct pool_worker_t *workers;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+
+    // Current loop
+    pool_task_t task;
+    void *context;
+    size_t count, chunk;
+    atomic_ulong steals; // ranges taken from another worker, since start
+    int running; // workers still busy with the loop
+    unsigned long generation;
+    bool quit;
+};
+
+// Number of online processors
+int processor_count();
+
+// Start a pool of size workers, 0 for one per processor
+struct thread_pool_t* create_thread_pool(int size);
+
+// Stop the workers and free memory for a pool
+struct thread_pool_t* free_thread_pool(struct thread_pool_t* pool);
+
+// Run task over [0,count) in chunks, returns once all chunks are done.
+// Each worker starts with an equal share and steals from the others once done, count < 2^32.
+void parallel_for(struct thread_pool_t* pool, size_t count, size_t chunk, pool_task_t task, void *context);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef __TRAJECTORY__
+#define __TRAJECTORY__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Number of state variables stored per sample (PX, PZ, VX, VZ, M)
+#define TRAJECTORY_DIM 5
+
+// Fixed capacity ring buffer of states, stored as one contiguous column per variable
+struct trajectory_t
+{
+    size_t capacity; // power of two
+    size_t first; // storage index of the oldest sample
+    size_t length;
+    double *time;
+    double *state[TRAJECTORY_DIM];
+};
+
+// Allocate a trajectory holding at least capacity samples
+struct trajectory_t* create_trajectory(size_t capacity);
+
+// Free memory for a trajectory
+struct trajectory_t* free_trajectory(struct trajectory_t* traj);
+
+// Remove all samples, keep storage
+void clear_trajectory(struct trajectory_t* traj);
+
+// Append a sample, evicting the oldest one when full
+bool append_state(struct trajectory_t* traj, double time, const double* state);
+
+// Copy the i-th oldest sample
+bool get_state(const struct trajectory_t* traj, size_t i, double* time, double* state);
+
+// Copy the most recent sample
+bool last_state(const struct trajectory_t* traj, double* time, double* state);
+
+// Linear interpolation of the state at a time within the samples
+bool interpolate_state(const struct trajectory_t* traj, double time, double* state);
+
+// Drop the count oldest samples, returns the number of dropped samples
+size_t evict_states(struct trajectory_t* traj, size_t count);
+
+// Drop all samples before a certain time
+size_t evict_states_before(struct trajectory_t* traj, double min_time);
+
+// Drop the samples before a certain time but the last one, so that the time can still be interpolated
+size_t evict_states_until(struct trajectory_t* traj, double time);
+
+// Storage index of the i-th oldest sample, to read the columns directly
+static inline size_t sample_index(const struct trajectory_t* traj, size_t i)
+{
+    return (traj->first + i) & (traj->capacity - 1);
+}
+
+#endif
@@ -0,0 +1,529 @@
+#include "marslanding/batch.h"
+
+#include "marslanding/descent.h"
+#include "marslanding/dynamics.h"
+#include "marslanding/fleet.h"
+#include "marslanding/integrator.h"
+#include "marslanding/thread_pool.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const size_t BATCH_CHUNK = 64; // runs per scheduled slice
+
+// Load a CSV profile with time,joy_x,joy_z,joy_n rows
+struct thrust_profile_t* load_thrust_profile(const char *path)
+{
+    FILE *file = fopen(path,"r");
+    if(file == NULL) return NULL;
+
+    struct thrust_profile_t *profile = calloc(1,sizeof(struct thrust_profile_t));
+    if(profile == NULL)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t capacity = 0;
+    char line[256];
+
+    while(fgets(line,sizeof(line),file) != NULL)
+    {
+        double t, x, z, n;
+
+        // Skip header, comments and malformed lines
+        if(sscanf(line,"%lf,%lf,%lf,%lf",&t,&x,&z,&n) != 4) continue;
+
+        if(profile->length == capacity)
+        {
+            capacity = (capacity == 0) ? 64 : 2*capacity;
+
+            double **columns[4] = {&profile->time,&profile->joy_x,&profile->joy_z,&profile->joy_n};
+
+            for(int i = 0; i < 4; i++)
+            {
+                double *column = realloc(*columns[i],capacity*sizeof(double));
+                if(column == NULL)
+                {
+                    fclose(file);
+                    return free_thrust_profile(profile);
+                }
+                *columns[i] = column;
+            }
+        }
+
+        // Same conditioning as the joystick axes
+        double norm = sqrt(x*x+z*z);
+        if(norm > 0.0)
+        {
+            x /= norm;
+            z /= norm;
+        }
+        if(n < 0.0) n = 0.0;
+        if(n > 1.0) n = 1.0;
+
+        profile->time[profile->length] = t;
+        profile->joy_x[profile->length] = x;
+        profile->joy_z[profile->length] = z;
+        profile->joy_n[profile->length] = n;
+        profile->length++;
+    }
+
+    fclose(file);
+
+    return profile;
+}
+
+// Free memory for a profile
+struct thrust_profile_t* free_thrust_profile(struct thrust_profile_t *profile)
+{
+    if(profile == NULL) return NULL;
+
+    free(profile->time);
+    free(profile->joy_x);
+    free(profile->joy_z);
+    free(profile->joy_n);
+    free(profile);
+
+    return NULL;
+}
+
+// Joystick command at a time, row is a search hint updated for increasing times
+void profile_command(const struct thrust_profile_t *profile, double time, size_t *row,
+    double *joy_x, double *joy_z, double *joy_n)
+{
+    *joy_x = 0.0;
+    *joy_z = 0.0;
+    *joy_n = 0.0;
+
+    if(profile == NULL || profile->length == 0 || time < profile->time[0]) return;
+
+    size_t i = *row;
+    if(i >= profile->length || profile->time[i] > time) i = 0;
+
+    while(i+1 < profile->length && profile->time[i+1] <= time) i++;
+
+    *row = i;
+    *joy_x = profile->joy_x[i];
+    *joy_z = profile->joy_z[i];
+    *joy_n = profile->joy_n[i];
+}
+
+// Time the command of the current row is replaced, INFINITY after the last row
+static double profile_row_end(const struct thrust_profile_t *profile, double time, size_t row)
+{
+    if(profile == NULL || profile->length == 0) return INFINITY;
+    if(time < profile->time[0]) return profile->time[0];
+
+    return (row+1 < profile->length) ? profile->time[row+1] : INFINITY;
+}
+
+// SplitMix64 generator
+static unsigned long long next_random(unsigned long long *seed)
+{
+    unsigned long long z = (*seed += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in (0,1]
+static double next_uniform(unsigned long long *seed)
+{
+    return ((next_random(seed) >> 11) + 1.0) * 0x1.0p-53;
+}
+
+// Initial state of a run around a mean, reproducible from seed and run index
+void dispersed_state(unsigned long long seed, size_t run, const double *mean, const double *sigma,
+    double *state)
+{
+    unsigned long long rng = seed ^ (0xD1B54A32D192ED03ULL*(run+1));
+
+    for(int i = 0; i < STATE_DIM; i += 2)
+    {
+        // Box-Muller, two normal samples per draw
+        double radius = sqrt(-2.0*log(next_uniform(&rng)));
+        double angle = 2.0*M_PI*next_uniform(&rng);
+
+        state[i] = mean[i] + sigma[i]*radius*cos(angle);
+        if(i+1 < STATE_DIM)
+            state[i+1] = mean[i+1] + sigma[i+1]*radius*sin(angle);
+    }
+}
+
+// Fly a descent of a campaign on a reset lander, observer is optional and called after every tick
+static void fly_run(const struct batch_config_t *config, struct lander_t *lander,
+    struct run_result_t *result, run_observer_t observer, void *context)
+{
+    const struct vehicle_t *vehicle = &config->vehicle;
+    const struct thrust_profile_t *profile = config->profile;
+    double max_time = config->max_time;
+
+    size_t row = 0;
+
+    struct guidance_t *guidance = config->autopilot ? create_guidance(GUIDANCE_STEPS) : NULL;
+    double next_plan_time = 0.0;
+
+    if(observer != NULL) observer(context,lander,guidance);
+
+    // Unobserved Euler and RK4 runs fly whole profile rows in the descent kernel, same ticks
+    const struct integrator_t *integrator = lander_integrator(lander);
+    bool kernel = (observer == NULL && guidance == NULL && !lander->locate_events &&
+        (integrator == &EULER_INTEGRATOR || integrator == &RK4_INTEGRATOR));
+    enum descent_scheme_t scheme = (integrator == &RK4_INTEGRATOR) ? DESCENT_RK4 : DESCENT_EULER;
+
+    while(!lander->is_grounded && lander->time < max_time)
+    {
+        double joy_x, joy_z, joy_n;
+        profile_command(profile,lander->time,&row,&joy_x,&joy_z,&joy_n);
+
+        if(kernel)
+        {
+            double end_time = fmin(profile_row_end(profile,lander->time,row),max_time);
+
+            compute_thrust(lander,joy_x,joy_z,joy_n);
+            lander->is_grounded = !descent_fly(vehicle,scheme,joy_x,joy_z,joy_n,FORWARD_TIME_STEP,end_time,
+                lander->state,&lander->time);
+            lander->is_dry = (lander->state[M] <= vehicle->dry_mass);
+            continue;
+        }
+
+        if(guidance != NULL)
+        {
+            if(lander->time >= next_plan_time)
+            {
+                plan_descent(guidance,lander);
+                next_plan_time = lander->time + GUIDANCE_PERIOD;
+            }
+
+            // The profile remains the fallback without a feasible plan
+            guidance_command(guidance,lander,&joy_x,&joy_z,&joy_n);
+        }
+
+        compute_thrust(lander,joy_x,joy_z,joy_n);
+
+        forward_step(lander,FORWARD_TIME_STEP);
+
+        if(observer != NULL) observer(context,lander,guidance);
+    }
+
+    result->plan_time = (guidance != NULL) ? guidance->stats.max_time : 0.0;
+    result->plan_p99 = (guidance != NULL) ? guidance_p99(guidance) : 0.0;
+    free_guidance(guidance);
+
+    const double *state = lander->state;
+
+    result->landed = lander->is_grounded;
+    result->landing_error = fabs(state[PX]);
+    result->touchdown_velocity = sqrt(state[VX]*state[VX]+state[VZ]*state[VZ]);
+    result->fuel_remaining = fmax(state[M]-vehicle->dry_mass,0.0);
+    result->time = lander->time;
+}
+
+// Fly a descent of a campaign from a state until touchdown or max_time
+void simulate_run(const struct batch_config_t *config, const double *initial_state,
+    struct run_result_t *result)
+{
+    // Lander without history, private to the calling thread
+    struct lander_t lander;
+    memset(&lander,0,sizeof(struct lander_t));
+
+    lander.vehicle = config->vehicle;
+    lander.integrator = config->integrator;
+    lander.locate_events = config->locate_events;
+    reset_lander(&lander,initial_state);
+
+    fly_run(config,&lander,result,NULL,NULL);
+}
+
+// Fly a descent with a history, observer is called after every tick
+bool observe_run(const struct batch_config_t *config, const double *initial_state,
+    struct run_result_t *result, run_observer_t observer, void *context)
+{
+    struct lander_t *lander = create_lander(TRAJECTORY_CAPACITY);
+    if(lander == NULL) return false;
+
+    lander->vehicle = config->vehicle;
+    lander->integrator = config->integrator;
+    lander->locate_events = config->locate_events;
+    reset_lander(lander,initial_state);
+
+    fly_run(config,lander,result,observer,context);
+
+    free_lander(lander);
+
+    return true;
+}
+
+static void fleet_result(const struct fleet_t *fleet, size_t i, double time, bool landed,
+    struct run_result_t *result)
+{
+    double state[TRAJECTORY_DIM];
+    get_fleet_state(fleet,i,state);
+
+    result->landed = landed;
+    result->landing_error = fabs(state[PX]);
+    result->touchdown_velocity = sqrt(state[VX]*state[VX]+state[VZ]*state[VZ]);
+    result->fuel_remaining = fmax(state[M]-fleet->vehicle.dry_mass,0.0);
+    result->time = time;
+    result->plan_time = 0.0;
+    result->plan_p99 = 0.0;
+}
+
+// Fly a block of descents together with the vectorized fleet kernel, one result per run
+void simulate_fleet(struct fleet_t *fleet, const struct thrust_profile_t *profile,
+    double max_time, struct run_result_t *results)
+{
+    const double *pz = fleet->state[PZ];
+    const double *m = fleet->state[M];
+
+    double time = 0.0;
+    size_t row = 0;
+    size_t flying = 0;
+
+    for (size_t i = 0; i < fleet->size; i++)
+    {
+        if (pz[i] <= 0.0)
+            fleet_result(fleet,i,time,true,&results[i]);
+        else
+        {
+            results[i].landed = false;
+            flying++;
+        }
+    }
+
+    while (flying > 0 && time < max_time)
+    {
+        double joy_x, joy_z, joy_n;
+        profile_command(profile,time,&row,&joy_x,&joy_z,&joy_n);
+
+        // Only the idle command depends on the mass, linearly
+        struct thrust_t thrust;
+        thrust_command(&fleet->vehicle,joy_x,joy_z,joy_n,1.0,&thrust);
+        bool idle = (joy_x == 0.0 && joy_z == 0.0);
+
+        for (size_t i = 0; i < fleet->size; i++)
+        {
+            double scale = idle ? m[i] : 1.0;
+
+            fleet->thrust_x[i] = thrust.x*scale;
+            fleet->thrust_z[i] = thrust.z*scale;
+            fleet->thrust_norm[i] = thrust.norm*scale;
+        }
+
+        fleet_euler(fleet,FORWARD_TIME_STEP);
+        time += FORWARD_TIME_STEP;
+
+        // Record touchdowns, grounded landers keep being stepped but are ignored
+        for (size_t i = 0; i < fleet->size; i++)
+        {
+            if (results[i].landed || pz[i] > 0.0) continue;
+
+            fleet_result(fleet,i,time,true,&results[i]);
+            flying--;
+        }
+    }
+
+    for (size_t i = 0; i < fleet->size; i++)
+    {
+        if (!results[i].landed) fleet_result(fleet,i,time,false,&results[i]);
+    }
+}
+
+void add_sample(struct statistics_t *stats, double x)
+{
+    // Welford update
+    stats->count++;
+
+    double delta = x - stats->mean;
+    stats->mean += delta/stats->count;
+    stats->m2 += delta*(x - stats->mean);
+
+    if(stats->count == 1 || x < stats->min) stats->min = x;
+    if(stats->count == 1 || x > stats->max) stats->max = x;
+}
+
+void merge_statistics(struct statistics_t *stats, const struct statistics_t *other)
+{
+    if(other->count == 0) return;
+
+    if(stats->count == 0)
+    {
+        *stats = *other;
+        return;
+    }
+
+    double count = (double)(stats->count + other->count);
+    double delta = other->mean - stats->mean;
+
+    stats->mean += delta*other->count/count;
+    stats->m2 += other->m2 + delta*delta*stats->count*other->count/count;
+    stats->min = fmin(stats->min,other->min);
+    stats->max = fmax(stats->max,other->max);
+    stats->count += other->count;
+}
+
+double standard_deviation(const struct statistics_t *stats)
+{
+    if(stats->count < 2) return 0.0;
+
+    return sqrt(stats->m2/(stats->count-1));
+}
+
+// Shared by the workers of a campaign
+struct batch_job_t
+{
+    const struct batch_config_t *config;
+    struct batch_summary_t *summaries; // one per worker
+    struct run_result_t *results;
+};
+
+static void add_result(struct batch_summary_t *summary, const struct run_result_t *result)
+{
+    summary->runs++;
+    if(!result->landed) return;
+
+    summary->landed++;
+    add_sample(&summary->landing_error,result->landing_error);
+    add_sample(&summary->touchdown_velocity,result->touchdown_velocity);
+    add_sample(&summary->fuel_remaining,result->fuel_remaining);
+    add_sample(&summary->time,result->time);
+    if(result->plan_time > 0.0) add_sample(&summary->plan_time,1e3*result->plan_time);
+    if(result->plan_p99 > 0.0) add_sample(&summary->plan_p99,1e3*result->plan_p99);
+}
+
+static void batch_task(void *context, size_t begin, size_t end, int worker)
+{
+    struct batch_job_t *job = context;
+    const struct batch_config_t *config = job->config;
+    struct batch_summary_t *summary = &job->summaries[worker];
+
+    for(size_t run = begin; run < end; run++)
+    {
+        double state[TRAJECTORY_DIM];
+        dispersed_state(config->seed,run,config->initial_state,config->sigma,state);
+
+        struct run_result_t result;
+        simulate_run(config,state,&result);
+
+        if(job->results != NULL) job->results[run] = result;
+
+        add_result(summary,&result);
+    }
+}
+
+static void fleet_task(void *context, size_t begin, size_t end, int worker)
+{
+    struct batch_job_t *job = context;
+    const struct batch_config_t *config = job->config;
+    struct batch_summary_t *summary = &job->summaries[worker];
+
+    struct fleet_t *fleet = create_fleet(end-begin,&config->vehicle);
+    struct run_result_t *results = malloc((end-begin)*sizeof(struct run_result_t));
+
+    if(fleet == NULL || results == NULL)
+    {
+        // Fall back to one lander at a time
+        free_fleet(fleet);
+        free(results);
+        batch_task(context,begin,end,worker);
+        return;
+    }
+
+    for(size_t run = begin; run < end; run++)
+    {
+        double state[TRAJECTORY_DIM];
+        dispersed_state(config->seed,run,config->initial_state,config->sigma,state);
+
+        set_fleet_lander(fleet,run-begin,state,NULL);
+    }
+
+    simulate_fleet(fleet,config->profile,config->max_time,results);
+
+    for(size_t run = begin; run < end; run++)
+    {
+        if(job->results != NULL) job->results[run] = results[run-begin];
+
+        add_result(summary,&results[run-begin]);
+    }
+
+    free(results);
+    free_fleet(fleet);
+}
+
+// Run a campaign on all workers, results is optional and holds one entry per run
+bool run_batch(const struct batch_config_t *config, struct batch_summary_t *summary,
+    struct run_result_t *results)
+{
+    struct thread_pool_t *pool = create_thread_pool(config->threads);
+    if(pool == NULL) return false;
+
+    struct batch_job_t job;
+    job.config = config;
+    job.results = results;
+    job.summaries = calloc(pool->size,sizeof(struct batch_summary_t));
+    if(job.summaries == NULL)
+    {
+        free_thread_pool(pool);
+        return false;
+    }
+
+    // The fleet kernel only implements explicit Euler without event location nor autopilot
+    bool is_euler = (config->integrator == NULL || config->integrator == &EULER_INTEGRATOR);
+    bool vectorized = config->vectorized && is_euler && !config->locate_events && !config->autopilot;
+
+    parallel_for(pool,config->runs,BATCH_CHUNK,vectorized ? fleet_task : batch_task,&job);
+
+    memset(summary,0,sizeof(struct batch_summary_t));
+
+    for(int i = 0; i < pool->size; i++)
+    {
+        summary->runs += job.summaries[i].runs;
+        summary->landed += job.summaries[i].landed;
+        merge_statistics(&summary->landing_error,&job.summaries[i].landing_error);
+        merge_statistics(&summary->touchdown_velocity,&job.summaries[i].touchdown_velocity);
+        merge_statistics(&summary->fuel_remaining,&job.summaries[i].fuel_remaining);
+        merge_statistics(&summary->time,&job.summaries[i].time);
+        merge_statistics(&summary->plan_time,&job.summaries[i].plan_time);
+        merge_statistics(&summary->plan_p99,&job.summaries[i].plan_p99);
+    }
+
+    free(job.summaries);
+    free_thread_pool(pool);
+
+    return true;
+}
+
+static void print_statistics(FILE *file, const char *name, const char *unit, const struct statistics_t *stats)
+{
+    fprintf(file,"  %-20s mean = %10.2f %-4s std = %10.2f  min = %10.2f  max = %10.2f\n",
+        name,stats->mean,unit,standard_deviation(stats),stats->min,stats->max);
+}
+
+void print_batch_summary(FILE *file, const struct batch_summary_t *summary)
+{
+    fprintf(file,"Batch summary (%zu runs, %zu landed)\n{\n",summary->runs,summary->landed);
+    print_statistics(file,"Landing error",      "m",  &summary->landing_error);
+    print_statistics(file,"Touchdown velocity", "m/s",&summary->touchdown_velocity);
+    print_statistics(file,"Fuel remaining",     "kg", &summary->fuel_remaining);
+    print_statistics(file,"Touchdown time",     "s",  &summary->time);
+    if(summary->plan_time.count > 0)
+    {
+        print_statistics(file,"Worst plan time",    "ms", &summary->plan_time);
+        print_statistics(file,"P99 plan time",      "ms", &summary->plan_p99);
+    }
+    fprintf(file,"}\n");
+}
+
+void print_run_results(FILE *file, const struct run_result_t *results, size_t runs)
+{
+    fprintf(file,"run,landed,landing_error,touchdown_velocity,fuel_remaining,time\n");
+
+    for(size_t i = 0; i < runs; i++)
+    {
+        fprintf(file,"%zu,%d,%.6f,%.6f,%.6f,%.2f\n",i,results[i].landed,
+            results[i].landing_error,results[i].touchdown_velocity,
+            results[i].fuel_remaining,results[i].time);
+    }
+}
@@ -0,0 +1,448 @@
+#include "marslanding/batch.h"
+
+#include "marslanding/draw.h"
+#include "marslanding/dynamics.h"
+#include "marslanding/fleet.h"
+#include "marslanding/integrator.h"
+#include "marslanding/raster.h"
+#include "marslanding/render.h"
+#include "marslanding/scenario.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum { MAX_SWEEPS = 4 };
+
+// Scenario parameter taking count values evenly spaced from first to last
+struct sweep_t
+{
+    char key[32];
+    double first, last;
+    int count;
+};
+
+static void print_usage()
+{
+    printf("Usage: marslanding_batch [options]\n");
+    printf("  -n RUNS           number of descents (default 1000)\n");
+    printf("  -j THREADS        worker threads, 0 for one per core (default 0)\n");
+    printf("  -s SEED           random seed (default 1)\n");
+    printf("  -d PX,PZ,VX,VZ,M  initial state standard deviations (default 100,50,5,5,0)\n");
+    printf("  -p PROFILE        CSV thrust profile time,joy_x,joy_z,joy_n (default idle)\n");
+    printf("  -t TIME           maximum simulated time per run in s (default 600)\n");
+    printf("  -o FILE           write per-run results as CSV, the sweep table with -w\n");
+    printf("  -i INTEGRATOR     euler, rk4, rk45 or analytic (default euler)\n");
+    printf("  -e                locate touchdown and fuel depletion exactly\n");
+    printf("  -g                fly with the guidance autopilot, the profile is the fallback\n");
+    printf("  -v                step runs in blocks with the vectorized fleet kernel (euler only)\n");
+    printf("  -c                check the vectorized kernel against the scalar one and exit\n");
+    printf("  -f PATTERN        render the first run to numbered frames, e.g. frame_%%05d.png or .ppm\n");
+    printf("  -r RATE           rendered frames per simulated second (default 30)\n");
+    printf("  -S SCENARIO       vehicle and initial state from a scenario file\n");
+    printf("  -w KEY=A:B:N      sweep a scenario parameter over N values from A to B, up to %d times,\n",MAX_SWEEPS);
+    printf("                    one CSV row of means per grid point, to the -o file or stdout\n");
+}
+
+const int FRAME_WIDTH = 1200, FRAME_HEIGHT = 650; // in px, the game window size
+
+static double wall_time()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return (double)now.tv_sec + 1e-9*(double)now.tv_nsec;
+}
+
+// Compare the vectorized kernel with the scalar one on dispersed landers
+static bool check_fleet(const struct batch_config_t *config)
+{
+    const size_t size = 1001; // not a multiple of the vector width
+    const double tolerance = 1e-12;
+
+    struct fleet_t *fleet = create_fleet(size,&config->vehicle);
+    if (fleet == NULL) return false;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        double state[TRAJECTORY_DIM];
+        dispersed_state(config->seed,i,config->initial_state,config->sigma,state);
+
+        // Mix of throttles, directions and dry landers
+        if (i % 7 == 0) state[M] = config->vehicle.dry_mass;
+
+        struct thrust_t thrust;
+        double angle = 0.01*i;
+        thrust_command(&config->vehicle,sin(angle),cos(angle),(i % 11)/10.0,state[M],&thrust);
+
+        set_fleet_lander(fleet,i,state,&thrust);
+    }
+
+    double deviation = check_fleet_euler(fleet,FORWARD_TIME_STEP,3000);
+
+    printf("Fleet kernel (%s) deviation from euler(): %g\n",fleet_instruction_set(),deviation);
+
+    free_fleet(fleet);
+
+    return deviation <= tolerance;
+}
+
+// Frames of an observed run drawn by the software rasterizer
+struct frame_writer_t
+{
+    struct framebuffer_t *framebuffer;
+    const char *pattern; // of the frame index
+    double period; // in s of simulated time
+    double next_time;
+    int frames;
+    bool failed;
+};
+
+static void write_run_frame(void *context, struct lander_t *lander, const struct guidance_t *guidance)
+{
+    struct frame_writer_t *writer = context;
+
+    if (writer->failed) return;
+    if (lander->time < writer->next_time && !lander->is_grounded) return;
+
+    while (writer->next_time <= lander->time) writer->next_time += writer->period;
+
+    view.lander = lander;
+    view.render_alpha = 1.0;
+    view.predict = true;
+    view.autopilot = guidance != NULL;
+    view.plan = guidance;
+
+    draw_static_layer();
+    draw_all();
+
+    char path[4096];
+    snprintf(path,sizeof(path),writer->pattern,writer->frames);
+
+    if (!write_frame(writer->framebuffer,path))
+    {
+        printf("Failed to write frame %s\n",path);
+        writer->failed = true;
+        return;
+    }
+
+    writer->frames++;
+}
+
+// Fly the first run of the campaign again and render it headless
+static bool render_run(const struct batch_config_t *config, const struct scenario_t *scenario,
+    const char *pattern, double frame_rate)
+{
+    struct frame_writer_t writer = {create_framebuffer(FRAME_WIDTH,FRAME_HEIGHT), pattern, 1.0/frame_rate, 0.0, 0, false};
+    if (writer.framebuffer == NULL) return false;
+
+    renderer = &writer.framebuffer->backend;
+    init_scene(FRAME_WIDTH,FRAME_HEIGHT,scenario);
+
+    double state[TRAJECTORY_DIM];
+    dispersed_state(config->seed,0,config->initial_state,config->sigma,state);
+
+    struct run_result_t result;
+
+    double start = wall_time();
+    bool flown = observe_run(config,state,&result,write_run_frame,&writer);
+    double elapsed = wall_time() - start;
+
+    if (flown && !writer.failed)
+        printf("%d frames of %.1f s rendered in %.3f s (%.0fx real time, %s backend)\n",
+            writer.frames,result.time,elapsed,result.time/elapsed,renderer->name);
+
+    quit_scene();
+    renderer = NULL;
+    free_framebuffer(writer.framebuffer);
+
+    return flown && !writer.failed;
+}
+
+// KEY=FIRST:LAST:COUNT with a key of the scenario files
+static bool parse_sweep(const char *text, struct sweep_t *sweep)
+{
+    if (sscanf(text,"%31[^=]=%lf:%lf:%d",sweep->key,&sweep->first,&sweep->last,&sweep->count) != 4) return false;
+
+    struct scenario_t scenario;
+    init_scenario(&scenario);
+
+    return sweep->count >= 1 && set_scenario_value(&scenario,sweep->key,sweep->first);
+}
+
+// Vehicle and mean initial state of the campaign
+static void use_scenario(struct batch_config_t *config, const struct scenario_t *scenario)
+{
+    config->vehicle = scenario->vehicle;
+    for (int i = 0; i < STATE_DIM; i++) config->initial_state[i] = scenario->initial_state[i];
+}
+
+static double sweep_value(const struct sweep_t *sweep, int k)
+{
+    if (sweep->count == 1) return sweep->first;
+
+    return sweep->first + (sweep->last - sweep->first)*k/(sweep->count - 1);
+}
+
+// Run the campaign at every point of the grid, invalid points are reported and left empty
+static bool run_sweep(struct batch_config_t *config, const struct scenario_t *base,
+    const struct sweep_t *sweeps, int sweep_count, FILE *file)
+{
+    for (int s = 0; s < sweep_count; s++) fprintf(file,"%s,",sweeps[s].key);
+    fprintf(file,"runs,landed,landing_error,touchdown_velocity,fuel_remaining,time\n");
+
+    int index[MAX_SWEEPS] = {0};
+
+    while (true)
+    {
+        struct scenario_t scenario = *base;
+
+        char error[128];
+        bool valid = true;
+
+        for (int s = 0; s < sweep_count; s++)
+        {
+            double value = sweep_value(&sweeps[s],index[s]);
+            fprintf(file,"%.17g,",value);
+
+            if (valid && !set_scenario_value(&scenario,sweeps[s].key,value))
+            {
+                snprintf(error,sizeof(error),"%s cannot be %g",sweeps[s].key,value);
+                valid = false;
+            }
+        }
+
+        derive_vehicle(&scenario.vehicle);
+
+        if (valid && validate_scenario(&scenario,error,sizeof(error)))
+        {
+            use_scenario(config,&scenario);
+
+            struct batch_summary_t summary;
+            if (!run_batch(config,&summary,NULL)) return false;
+
+            fprintf(file,"%zu,%zu,%.17g,%.17g,%.17g,%.17g\n",summary.runs,summary.landed,
+                summary.landing_error.mean,summary.touchdown_velocity.mean,summary.fuel_remaining.mean,
+                summary.time.mean);
+        }
+        else
+        {
+            fprintf(file,"0,0,,,,\n");
+            fprintf(stderr,"Skipped grid point: %s\n",error);
+        }
+
+        // Next grid point, the last parameter changing fastest
+        int s = sweep_count-1;
+        while (s >= 0 && ++index[s] == sweeps[s].count)
+        {
+            index[s] = 0;
+            s--;
+        }
+
+        if (s < 0) return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    struct batch_config_t config;
+    struct scenario_t scenario;
+    init_scenario(&scenario);
+    use_scenario(&config,&scenario);
+    config.runs = 1000;
+    config.threads = 0;
+    config.seed = 1;
+    config.max_time = 600.0;
+    config.profile = NULL;
+    config.vectorized = false;
+    config.integrator = NULL;
+    config.locate_events = false;
+    config.autopilot = false;
+
+    const double sigma[] = {100.0, 50.0, 5.0, 5.0, 0.0};
+    for (int i = 0; i < STATE_DIM; i++) config.sigma[i] = sigma[i];
+
+    struct sweep_t sweeps[MAX_SWEEPS];
+    int sweep_count = 0;
+
+    const char *profile_path = NULL;
+    const char *output_path = NULL;
+    const char *frame_pattern = NULL;
+    double frame_rate = 30.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = (i+1 < argc) ? argv[i+1] : NULL;
+
+        if (strcmp(argv[i],"-h") == 0)
+        {
+            print_usage();
+            return 0;
+        }
+
+        if (strcmp(argv[i],"-v") == 0)
+        {
+            config.vectorized = true;
+            continue;
+        }
+
+        if (strcmp(argv[i],"-e") == 0)
+        {
+            config.locate_events = true;
+            continue;
+        }
+
+        if (strcmp(argv[i],"-g") == 0)
+        {
+            config.autopilot = true;
+            continue;
+        }
+
+        if (strcmp(argv[i],"-c") == 0)
+        {
+            return check_fleet(&config) ? 0 : -1;
+        }
+
+        if (value == NULL)
+        {
+            print_usage();
+            return -1;
+        }
+
+        if (strcmp(argv[i],"-n") == 0) config.runs = strtoull(value,NULL,10);
+        else if (strcmp(argv[i],"-j") == 0) config.threads = atoi(value);
+        else if (strcmp(argv[i],"-s") == 0) config.seed = strtoull(value,NULL,10);
+        else if (strcmp(argv[i],"-t") == 0) config.max_time = atof(value);
+        else if (strcmp(argv[i],"-p") == 0) profile_path = value;
+        else if (strcmp(argv[i],"-o") == 0) output_path = value;
+        else if (strcmp(argv[i],"-f") == 0) frame_pattern = value;
+        else if (strcmp(argv[i],"-r") == 0) frame_rate = atof(value);
+        else if (strcmp(argv[i],"-S") == 0)
+        {
+            char error[128];
+            if (!load_scenario(value,&scenario,error,sizeof(error)))
+            {
+                printf("Invalid scenario %s: %s\n",value,error);
+                return -1;
+            }
+            use_scenario(&config,&scenario);
+        }
+        else if (strcmp(argv[i],"-w") == 0)
+        {
+            if (sweep_count == MAX_SWEEPS || !parse_sweep(value,&sweeps[sweep_count]))
+            {
+                print_usage();
+                return -1;
+            }
+            sweep_count++;
+        }
+        else if (strcmp(argv[i],"-i") == 0)
+        {
+            config.integrator = find_integrator(value);
+            if (config.integrator == NULL)
+            {
+                print_usage();
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i],"-d") == 0)
+        {
+            double *s = config.sigma;
+            if (sscanf(value,"%lf,%lf,%lf,%lf,%lf",&s[0],&s[1],&s[2],&s[3],&s[4]) != 5)
+            {
+                print_usage();
+                return -1;
+            }
+        }
+        else
+        {
+            print_usage();
+            return -1;
+        }
+
+        i++;
+    }
+
+    struct thrust_profile_t *profile = NULL;
+    if (profile_path != NULL)
+    {
+        profile = load_thrust_profile(profile_path);
+        if (profile == NULL)
+        {
+            printf("Failed to load thrust profile %s\n",profile_path);
+            return -1;
+        }
+        config.profile = profile;
+    }
+
+    if (sweep_count > 0)
+    {
+        FILE *file = (output_path != NULL) ? fopen(output_path,"w") : stdout;
+        if (file == NULL)
+        {
+            printf("Failed to open %s\n",output_path);
+            return -1;
+        }
+
+        bool swept = run_sweep(&config,&scenario,sweeps,sweep_count,file);
+        if (file != stdout) fclose(file);
+
+        free_thrust_profile(profile);
+
+        if (!swept) printf("Failed to run batch\n");
+
+        return swept ? 0 : -1;
+    }
+
+    struct run_result_t *results = NULL;
+    if (output_path != NULL)
+    {
+        results = malloc(config.runs*sizeof(struct run_result_t));
+        if (results == NULL)
+        {
+            printf("Failed to allocate results for %zu runs\n",config.runs);
+            return -1;
+        }
+    }
+
+    struct batch_summary_t summary;
+
+    double start = wall_time();
+
+    if (!run_batch(&config,&summary,results))
+    {
+        printf("Failed to run batch\n");
+        return -1;
+    }
+
+    double elapsed = wall_time() - start;
+
+    print_batch_summary(stdout,&summary);
+    printf("%zu runs in %.3f s (%.0f runs/s)\n",summary.runs,elapsed,summary.runs/elapsed);
+
+    if (results != NULL)
+    {
+        FILE *file = fopen(output_path,"w");
+        if (file == NULL)
+        {
+            printf("Failed to open %s\n",output_path);
+            return -1;
+        }
+
+        print_run_results(file,results,config.runs);
+        fclose(file);
+        free(results);
+    }
+
+    if (frame_pattern != NULL && (frame_rate <= 0.0 || !render_run(&config,&scenario,frame_pattern,frame_rate)))
+    {
+        printf("Failed to render frames to %s\n",frame_pattern);
+        return -1;
+    }
+
+    free_thrust_profile(profile);
+
+    return 0;
+}
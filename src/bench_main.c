@@ -0,0 +1,620 @@
+#include "marslanding/descent.h"
+#include "marslanding/draw.h"
+#include "marslanding/dynamics.h"
+#include "marslanding/footprint.h"
+#include "marslanding/integrator.h"
+#include "marslanding/profiler.h"
+#include "marslanding/raster.h"
+#include "marslanding/render.h"
+#include "marslanding/scenario.h"
+#include "marslanding/suggester.h"
+#include "marslanding/trajectory.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void print_usage()
+{
+    printf("Usage: marslanding_bench [options]\n");
+    printf("  Time the simulation and drawing kernels headless, results as JSON\n");
+    printf("  -t TIME           target time per benchmark in s (default 0.5)\n");
+    printf("  -f FILTER         only the benchmarks whose name contains FILTER\n");
+    printf("  -o FILE           write the JSON to FILE instead of stdout\n");
+    printf("  -l                list the benchmarks and exit\n");
+}
+
+const int BENCH_VERSION = 1; // of the JSON layout
+const int BENCH_MIN_BATCHES = 5;
+const int BENCH_MAX_BATCHES = 1000;
+const double BENCH_BATCH_TIME = 1e-3; // in s, batches are timed as a whole
+
+const int FRAME_WIDTH = 1200, FRAME_HEIGHT = 650; // in px, the game window size
+
+// Runs a benchmark body a number of times
+typedef void (*bench_body_t)(void *context, size_t iterations);
+
+struct bench_result_t
+{
+    char name[64];
+    const char *unit; // of one iteration
+    size_t iterations;
+    double seconds;
+    double median, min, max; // in ns per iteration over batches
+};
+
+struct bench_suite_t
+{
+    double target_time;
+    const char *filter;
+    bool list;
+
+    struct bench_result_t results[64];
+    int count;
+};
+
+// Results are read back so that the compiler keeps the benchmarked calls
+volatile double bench_sink = 0.0;
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+// Size batches to BENCH_BATCH_TIME, then time batches until the target time
+static void run_bench(struct bench_suite_t *suite, const char *name, const char *unit,
+    bench_body_t body, void *context)
+{
+    if (suite->filter != NULL && strstr(name,suite->filter) == NULL) return;
+    if (suite->count == (int)(sizeof(suite->results)/sizeof(suite->results[0]))) return;
+
+    if (suite->list)
+    {
+        printf("%s\n",name);
+        return;
+    }
+
+    size_t batch = 1;
+    while (true)
+    {
+        uint64_t start = profile_clock();
+        body(context,batch);
+        double elapsed = 1e-9*(double)(profile_clock() - start);
+
+        if (elapsed >= BENCH_BATCH_TIME || batch >= ((size_t)1 << 30)) break;
+        batch *= 2;
+    }
+
+    double per_batch[BENCH_MAX_BATCHES];
+    int batches = 0;
+    double total = 0.0;
+
+    while (batches < BENCH_MAX_BATCHES && (batches < BENCH_MIN_BATCHES || total < suite->target_time))
+    {
+        uint64_t start = profile_clock();
+        body(context,batch);
+        uint64_t elapsed = profile_clock() - start;
+
+        total += 1e-9*(double)elapsed;
+        per_batch[batches++] = (double)elapsed/(double)batch;
+    }
+
+    qsort(per_batch,batches,sizeof(double),compare_doubles);
+
+    struct bench_result_t *result = &suite->results[suite->count++];
+
+    snprintf(result->name,sizeof(result->name),"%s",name);
+    result->unit = unit;
+    result->iterations = batch*(size_t)batches;
+    result->seconds = total;
+    result->median = per_batch[batches/2];
+    result->min = per_batch[0];
+    result->max = per_batch[batches-1];
+
+    fprintf(stderr,"%-28s %12.1f ns/%s\n",name,result->median,unit);
+}
+
+// Lander at an altitude and vertical speed with a constant command, without history
+static struct lander_t* bench_lander(double altitude, double vz, double joy_z, double joy_n)
+{
+    struct lander_t *lander = create_lander(0);
+    if (lander == NULL) return NULL;
+
+    double state[TRAJECTORY_DIM];
+    memcpy(state,INITIAL_STATE,sizeof(state));
+    state[PZ] = altitude;
+    state[VZ] = vz;
+
+    reset_lander(lander,state);
+    compute_thrust(lander,0.0,joy_z,joy_n);
+
+    return lander;
+}
+
+static void bench_dynamics(void *context, size_t iterations)
+{
+    const struct lander_t *lander = context;
+    double dynamics[TRAJECTORY_DIM], sum = 0.0;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        system_dynamics(lander,lander->state,dynamics);
+        sum += dynamics[VZ];
+    }
+
+    bench_sink = sum;
+}
+
+static void bench_euler(void *context, size_t iterations)
+{
+    const struct lander_t *lander = context;
+    double state[TRAJECTORY_DIM], sum = 0.0;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        euler(lander,lander->state,FORWARD_TIME_STEP,state);
+        sum += state[PZ];
+    }
+
+    bench_sink = sum;
+}
+
+static void bench_forward_tick(void *context, size_t iterations)
+{
+    struct lander_t *lander = context;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        if (lander->is_grounded) reset_lander(lander,INITIAL_STATE);
+        forward_tick(lander);
+    }
+
+    bench_sink = lander->state[PZ];
+}
+
+// Lander and restart state of forward_duration and predict benchmarks
+struct bench_flight_t
+{
+    struct lander_t *lander;
+    double state[TRAJECTORY_DIM];
+    struct thrust_t thrust;
+    double duration; // in s
+};
+
+static void restart_flight(struct bench_flight_t *flight)
+{
+    reset_lander(flight->lander,flight->state);
+    flight->lander->thrust = flight->thrust;
+}
+
+static void bench_forward_duration(void *context, size_t iterations)
+{
+    struct bench_flight_t *flight = context;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        restart_flight(flight);
+        forward_duration(flight->lander,flight->duration);
+    }
+
+    bench_sink = flight->lander->state[PZ];
+}
+
+static void bench_predict(void *context, size_t iterations)
+{
+    struct bench_flight_t *flight = context;
+    size_t samples = 0;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        invalidate_prediction(flight->lander);
+        const struct trajectory_t *predicted = predict(flight->lander);
+        if (predicted != NULL) samples += predicted->length;
+    }
+
+    bench_sink = (double)samples;
+}
+
+// One program of the landing footprint fan, a quarter of the fuel at the upper bound then held
+static void bench_footprint_program(void *context, size_t iterations)
+{
+    const struct lander_t *lander = context;
+    volatile double x = 0.0;
+
+    for (size_t i = 0; i < iterations; i++)
+        x = program_touchdown(lander,0.3 + 1e-9*(double)i,lander->vehicle.rho_2,0.25);
+
+    (void)x;
+}
+
+struct bench_suggest_t
+{
+    struct suggester_t *suggester;
+    struct lander_t *lander;
+};
+
+// Whole suggested command search without a time budget
+static void bench_suggest(void *context, size_t iterations)
+{
+    struct bench_suggest_t *bench = context;
+    struct suggestion_t suggestion;
+
+    for (size_t i = 0; i < iterations; i++)
+        search_suggestion(bench->suggester,bench->lander,INFINITY,&suggestion);
+}
+
+struct bench_descent_t
+{
+    struct lander_t *lander;
+    double joy[3];
+    enum descent_scheme_t scheme;
+};
+
+// Whole descent from the initial state with a constant command, tick by tick as in the game
+static void bench_descent_ticks(void *context, size_t iterations)
+{
+    struct bench_descent_t *bench = context;
+    struct lander_t *lander = bench->lander;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        reset_lander(lander,INITIAL_STATE);
+
+        while (!lander->is_grounded && lander->time < 600.0)
+        {
+            compute_thrust(lander,bench->joy[0],bench->joy[1],bench->joy[2]);
+            forward_step(lander,FORWARD_TIME_STEP);
+        }
+    }
+}
+
+// Same descent in the kernel used by batch runs
+static void bench_descent_kernel(void *context, size_t iterations)
+{
+    struct bench_descent_t *bench = context;
+    double state[TRAJECTORY_DIM];
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        double time = 0.0;
+        memcpy(state,INITIAL_STATE,sizeof(state));
+
+        descent_fly(&bench->lander->vehicle,bench->scheme,bench->joy[0],bench->joy[1],bench->joy[2],
+            FORWARD_TIME_STEP,600.0,state,&time);
+    }
+
+    bench_sink = state[PX];
+}
+
+// Scenario file with every key, parsed from memory
+static const char BENCH_SCENARIO[] =
+    "# Nominal descent\n"
+    "name = nominal\n"
+    "dry_mass = 1505\nwet_mass = 1905\nisp = 225\nnb_thrusters = 6\n"
+    "t_1 = 0.3\nt_2 = 0.8\nt_bar = 3100\nphi = 27 # deg\n"
+    "px = 2000\npz = 1500\nvx = 100\nvz = -75\nm = 1905\n"
+    "scene_min_x = -500\nscene_max_x = 4500\nscene_min_z = -500\nscene_max_z = 2000\n";
+
+static void bench_scenario_parse(void *context, size_t iterations)
+{
+    struct scenario_t *scenario = context;
+    char error[128];
+
+    for (size_t i = 0; i < iterations; i++)
+        parse_scenario(BENCH_SCENARIO,sizeof(BENCH_SCENARIO)-1,scenario,error,sizeof(error));
+}
+
+static bool init_flight(struct bench_flight_t *flight, double altitude, double vz, double joy_n,
+    const struct integrator_t *integrator, double duration)
+{
+    flight->lander = bench_lander(altitude,vz,1.0,joy_n);
+    if (flight->lander == NULL) return false;
+
+    flight->lander->integrator = integrator;
+    memcpy(flight->state,flight->lander->state,sizeof(flight->state));
+    flight->thrust = flight->lander->thrust;
+    flight->duration = duration;
+
+    return true;
+}
+
+static void bench_append(void *context, size_t iterations)
+{
+    struct trajectory_t *traj = context;
+    double state[TRAJECTORY_DIM];
+    memcpy(state,INITIAL_STATE,sizeof(state));
+
+    // Full ring, every append evicts the oldest state
+    for (size_t i = 0; i < iterations; i++)
+    {
+        state[PX] = (double)i;
+        append_state(traj,(double)i,state);
+    }
+
+    bench_sink = (double)traj->length;
+}
+
+// Fill then clear a 1024 states trajectory
+static void bench_fill_clear(void *context, size_t iterations)
+{
+    struct trajectory_t *traj = context;
+    double state[TRAJECTORY_DIM];
+    memcpy(state,INITIAL_STATE,sizeof(state));
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        for (int k = 0; k < 1024; k++) append_state(traj,k*FORWARD_TIME_STEP,state);
+        clear_trajectory(traj);
+    }
+
+    bench_sink = (double)traj->length;
+}
+
+// Sliding window of 1000 states, one append and one eviction by time per iteration
+static void bench_evict_before(void *context, size_t iterations)
+{
+    struct trajectory_t *traj = context;
+    double state[TRAJECTORY_DIM];
+    memcpy(state,INITIAL_STATE,sizeof(state));
+
+    double time = 0.0;
+    last_state(traj,&time,state);
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        time += FORWARD_TIME_STEP;
+        append_state(traj,time,state);
+        evict_states_before(traj,time-1000*FORWARD_TIME_STEP);
+    }
+
+    bench_sink = (double)traj->length;
+}
+
+static void bench_draw_state_list(void *context, size_t iterations)
+{
+    const struct trajectory_t *traj = context;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        render_color(0xFF, 0xFF, 0xFF, 0xFF);
+        draw_state_list(traj);
+    }
+}
+
+static void bench_draw_frame(void *context, size_t iterations)
+{
+    (void)context;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        draw_static_layer();
+        draw_all();
+    }
+}
+
+static void run_physics_benches(struct bench_suite_t *suite)
+{
+    struct lander_t *lander = bench_lander(INITIAL_STATE[PZ],INITIAL_STATE[VZ],1.0,0.5);
+    if (lander == NULL) return;
+
+    run_bench(suite,"system_dynamics","call",bench_dynamics,lander);
+    run_bench(suite,"euler_step","step",bench_euler,lander);
+    run_bench(suite,"forward_tick","tick",bench_forward_tick,lander);
+
+    free_lander(lander);
+
+    // Hover high up with the idle command, neither ground nor dry within the duration
+    const double durations[] = {1.0, 10.0, 100.0};
+
+    for (int i = 0; i < 3; i++)
+    {
+        struct bench_flight_t flight;
+        if (!init_flight(&flight,1e5,0.0,0.0,NULL,durations[i])) return;
+        thrust_command(&flight.lander->vehicle,0.0,0.0,0.0,flight.state[M],&flight.thrust);
+
+        char name[64];
+        snprintf(name,sizeof(name),"forward_duration_%.0fs",durations[i]);
+        run_bench(suite,name,"call",bench_forward_duration,&flight);
+
+        free_lander(flight.lander);
+    }
+
+    // Idle command hovers, the other one burns dry before touchdown, with each integrator of the kernel
+    const double joys[2][3] = {{0.0, 0.0, 0.0}, {0.0, 1.0, 1.0}};
+    const char *commands[2] = {"idle", "burn"};
+
+    const struct integrator_t *integrators[2] = {&EULER_INTEGRATOR, &RK4_INTEGRATOR};
+    const enum descent_scheme_t schemes[2] = {DESCENT_EULER, DESCENT_RK4};
+
+    for (int j = 0; j < 2; j++)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            struct bench_descent_t descent = {create_lander(0), {joys[i][0], joys[i][1], joys[i][2]}, schemes[j]};
+            if (descent.lander == NULL) return;
+            descent.lander->integrator = integrators[j];
+
+            char name[64];
+            snprintf(name,sizeof(name),"descent_ticks_%s_%s",integrators[j]->name,commands[i]);
+            run_bench(suite,name,"descent",bench_descent_ticks,&descent);
+
+            snprintf(name,sizeof(name),"descent_kernel_%s_%s",integrators[j]->name,commands[i]);
+            run_bench(suite,name,"descent",bench_descent_kernel,&descent);
+
+            free_lander(descent.lander);
+        }
+    }
+
+    struct scenario_t scenario;
+    run_bench(suite,"scenario_parse","file",bench_scenario_parse,&scenario);
+}
+
+static void run_prediction_benches(struct bench_suite_t *suite)
+{
+    const double altitudes[] = {1500.0, 500.0, 50.0};
+    const struct integrator_t *integrators[] = {&EULER_INTEGRATOR, &ANALYTIC_INTEGRATOR};
+
+    for (int k = 0; k < 2; k++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            struct bench_flight_t flight;
+            if (!init_flight(&flight,altitudes[i],-20.0,0.3,integrators[k],0.0)) return;
+
+            char name[64];
+            snprintf(name,sizeof(name),"predict_%s_%.0fm",integrators[k]->name,altitudes[i]);
+            run_bench(suite,name,"prediction",bench_predict,&flight);
+
+            free_lander(flight.lander);
+        }
+    }
+
+    struct lander_t *lander = bench_lander(INITIAL_STATE[PZ],INITIAL_STATE[VZ],0.0,0.0);
+    if (lander == NULL) return;
+
+    run_bench(suite,"footprint_program","program",bench_footprint_program,lander);
+
+    struct bench_suggest_t suggest = {create_suggester(0), lander};
+
+    if (suggest.suggester != NULL)
+    {
+        run_bench(suite,"suggest_search","search",bench_suggest,&suggest);
+        free_suggester(suggest.suggester);
+    }
+
+    free_lander(lander);
+}
+
+static void run_trajectory_benches(struct bench_suite_t *suite)
+{
+    struct trajectory_t *traj = create_trajectory(4096);
+    if (traj == NULL) return;
+
+    double state[TRAJECTORY_DIM];
+    memcpy(state,INITIAL_STATE,sizeof(state));
+    for (int i = 0; i < 4096; i++) append_state(traj,i*FORWARD_TIME_STEP,state);
+
+    run_bench(suite,"trajectory_append","state",bench_append,traj);
+
+    clear_trajectory(traj);
+    run_bench(suite,"trajectory_fill_clear_1024","1024 states",bench_fill_clear,traj);
+
+    clear_trajectory(traj);
+    for (int i = 0; i < 1000; i++) append_state(traj,i*FORWARD_TIME_STEP,state);
+    run_bench(suite,"trajectory_evict_before","state",bench_evict_before,traj);
+
+    free_trajectory(traj);
+}
+
+// Software rasterizer target, the drawing code is the same as in the game
+static void run_draw_benches(struct bench_suite_t *suite)
+{
+    struct framebuffer_t *framebuffer = create_framebuffer(FRAME_WIDTH,FRAME_HEIGHT);
+    struct lander_t *lander = create_lander(TRAJECTORY_CAPACITY);
+
+    if (framebuffer != NULL && lander != NULL)
+    {
+        renderer = &framebuffer->backend;
+        init_scene(FRAME_WIDTH,FRAME_HEIGHT,NULL);
+
+        // History of a descent with a steady command
+        compute_thrust(lander,0.3,0.95,0.4);
+        while (!lander->is_grounded && lander->time < 60.0) forward_tick(lander);
+
+        view.lander = lander;
+        view.render_alpha = 1.0;
+        view.predict = true;
+
+        char name[64];
+        snprintf(name,sizeof(name),"draw_state_list_%zu",lander->history->length);
+        run_bench(suite,name,"draw",bench_draw_state_list,lander->history);
+
+        // Back in flight so that the frame has a prediction
+        reset_lander(lander,INITIAL_STATE);
+        compute_thrust(lander,0.3,0.95,0.4);
+        for (int i = 0; i < 1000; i++) forward_tick(lander);
+
+        run_bench(suite,"draw_frame_software","frame",bench_draw_frame,NULL);
+
+        quit_scene();
+        renderer = NULL;
+    }
+
+    free_lander(lander);
+    free_framebuffer(framebuffer);
+}
+
+static void print_json(FILE *file, const struct bench_suite_t *suite)
+{
+    fprintf(file,"{\n");
+    fprintf(file,"  \"suite\": \"marslanding_bench\",\n");
+    fprintf(file,"  \"version\": %d,\n",BENCH_VERSION);
+#ifdef __VERSION__
+    fprintf(file,"  \"compiler\": \"%s\",\n",__VERSION__);
+#endif
+    fprintf(file,"  \"target_time\": %g,\n",suite->target_time);
+    fprintf(file,"  \"benchmarks\": [\n");
+
+    for (int i = 0; i < suite->count; i++)
+    {
+        const struct bench_result_t *r = &suite->results[i];
+
+        fprintf(file,"    {\"name\": \"%s\", \"unit\": \"%s\", \"iterations\": %zu, \"seconds\": %.6f, "
+            "\"per_second\": %.1f, \"ns\": {\"median\": %.2f, \"min\": %.2f, \"max\": %.2f}}%s\n",
+            r->name,r->unit,r->iterations,r->seconds,(double)r->iterations/r->seconds,
+            r->median,r->min,r->max,(i+1 < suite->count) ? "," : "");
+    }
+
+    fprintf(file,"  ]\n}\n");
+}
+
+int main(int argc, char** argv)
+{
+    static struct bench_suite_t suite;
+    suite.target_time = 0.5;
+
+    const char *output_path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = (i+1 < argc) ? argv[i+1] : NULL;
+
+        if (strcmp(argv[i],"-h") == 0)
+        {
+            print_usage();
+            return 0;
+        }
+        else if (strcmp(argv[i],"-t") == 0 && value != NULL) suite.target_time = atof(argv[++i]);
+        else if (strcmp(argv[i],"-f") == 0 && value != NULL) suite.filter = argv[++i];
+        else if (strcmp(argv[i],"-o") == 0 && value != NULL) output_path = argv[++i];
+        else if (strcmp(argv[i],"-l") == 0) suite.list = true;
+        else
+        {
+            print_usage();
+            return -1;
+        }
+    }
+
+    run_physics_benches(&suite);
+    run_prediction_benches(&suite);
+    run_trajectory_benches(&suite);
+    run_draw_benches(&suite);
+
+    if (suite.list) return 0;
+
+    FILE *file = (output_path != NULL) ? fopen(output_path,"w") : stdout;
+    if (file == NULL)
+    {
+        printf("Failed to open %s\n",output_path);
+        return -1;
+    }
+
+    print_json(file,&suite);
+
+    if (file != stdout) fclose(file);
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "marslanding/decimation.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+const size_t DECIMATION_INITIAL_CAPACITY = 256;
+
+// Allocate an empty summary for a pixel size and tolerance
+struct decimation_t* create_decimation(double scale_x, double scale_z, double tolerance)
+{
+    if(scale_x <= 0.0 || scale_z <= 0.0 || tolerance <= 0.0) return NULL;
+
+    struct decimation_t *decimation = calloc(1,sizeof(struct decimation_t));
+    if(decimation == NULL) return NULL;
+
+    decimation->x = malloc(2*DECIMATION_INITIAL_CAPACITY*sizeof(double));
+    if(decimation->x == NULL)
+    {
+        free(decimation);
+        return NULL;
+    }
+
+    decimation->z = decimation->x + DECIMATION_INITIAL_CAPACITY;
+    decimation->capacity = DECIMATION_INITIAL_CAPACITY;
+
+    decimation->scale_x = scale_x;
+    decimation->scale_z = scale_z;
+    decimation->tolerance = tolerance;
+
+    return decimation;
+}
+
+// Free memory for a summary
+struct decimation_t* free_decimation(struct decimation_t *decimation)
+{
+    if(decimation == NULL) return NULL;
+
+    free(decimation->x);
+    free(decimation);
+
+    return NULL;
+}
+
+// Remove all points, keep storage
+void clear_decimation(struct decimation_t *decimation)
+{
+    if(decimation == NULL) return;
+
+    decimation->length = 0;
+    decimation->has_tail = false;
+    decimation->has_cone = false;
+}
+
+// Append a kept point, doubling the storage when full
+static bool keep_point(struct decimation_t *decimation, double x, double z)
+{
+    if(decimation->length == decimation->capacity)
+    {
+        size_t capacity = 2*decimation->capacity;
+
+        // Single block, the z column moves behind the larger x column
+        double *block = realloc(decimation->x,2*capacity*sizeof(double));
+        if(block == NULL) return false;
+
+        for(size_t i = decimation->length; i-- > 0;)
+            block[capacity+i] = block[decimation->capacity+i];
+
+        decimation->x = block;
+        decimation->z = block + capacity;
+        decimation->capacity = capacity;
+    }
+
+    decimation->x[decimation->length] = x;
+    decimation->z[decimation->length] = z;
+    decimation->length++;
+
+    decimation->has_tail = false;
+    decimation->has_cone = false;
+
+    return true;
+}
+
+// Add the next point of the path
+bool add_point(struct decimation_t *decimation, double x, double z)
+{
+    if(decimation == NULL) return false;
+
+    if(decimation->length == 0) return keep_point(decimation,x,z);
+
+    size_t last = decimation->length-1;
+    double dx = (x - decimation->x[last])*decimation->scale_x;
+    double dz = (z - decimation->z[last])*decimation->scale_z;
+    double distance = sqrt(dx*dx + dz*dz);
+
+    // Closer than a point already in the cone: the path turned back, past the end of any segment
+    // to the new point, so the tail is the turning point
+    if(decimation->has_cone && distance < decimation->farthest)
+    {
+        if(!keep_point(decimation,decimation->tail_x,decimation->tail_z)) return false;
+
+        return add_point(decimation,x,z);
+    }
+
+    // Within tolerance of the last kept point, so of any segment starting there
+    if(distance <= decimation->tolerance)
+    {
+        decimation->has_tail = true;
+        decimation->tail_x = x;
+        decimation->tail_z = z;
+        return true;
+    }
+
+    double angle = atan2(dz,dx);
+    double spread = asin(decimation->tolerance/distance);
+
+    if(!decimation->has_cone)
+    {
+        decimation->has_cone = true;
+        decimation->reference = angle;
+        decimation->lower = -spread;
+        decimation->upper = spread;
+    }
+    else
+    {
+        double relative = remainder(angle - decimation->reference,2.0*M_PI);
+
+        // The path left the sleeve, the tail becomes a kept point and starts a new one
+        if(relative < decimation->lower || relative > decimation->upper)
+        {
+            if(!keep_point(decimation,decimation->tail_x,decimation->tail_z)) return false;
+
+            return add_point(decimation,x,z);
+        }
+
+        decimation->lower = fmax(decimation->lower,relative - spread);
+        decimation->upper = fmin(decimation->upper,relative + spread);
+    }
+
+    decimation->farthest = distance;
+
+    decimation->has_tail = true;
+    decimation->tail_x = x;
+    decimation->tail_z = z;
+
+    return true;
+}
+
+// Number of points of the simplified polyline, kept points plus the tail
+size_t decimation_length(const struct decimation_t *decimation)
+{
+    if(decimation == NULL) return 0;
+
+    return decimation->length + (decimation->has_tail ? 1 : 0);
+}
+
+// Copy the i-th point of the simplified polyline
+bool get_point(const struct decimation_t *decimation, size_t i, double *x, double *z)
+{
+    if(i >= decimation_length(decimation)) return false;
+
+    if(i < decimation->length)
+    {
+        *x = decimation->x[i];
+        *z = decimation->z[i];
+    }
+    else
+    {
+        *x = decimation->tail_x;
+        *z = decimation->tail_z;
+    }
+
+    return true;
+}
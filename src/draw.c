@@ -1,12 +1,19 @@
 #include "marslanding/draw.h"
 
-#include "marslanding/sdl_utils.h"
+#include "marslanding/decimation.h"
 #include "marslanding/dynamics.h"
-#include "marslanding/state_list.h"
-#include "marslanding/game.h"
-
-#include <SDL2/SDL.h>
+#include "marslanding/footprint.h"
+#include "marslanding/guidance.h"
+#include "marslanding/profiler.h"
+#include "marslanding/render.h"
+#include "marslanding/scenario.h"
+#include "marslanding/suggester.h"
+#include "marslanding/trajectory.h"
+
+#include <ctype.h>
+#include <math.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h> 
 
 const int WINDOW_MARGIN = 10;
@@ -15,10 +22,9 @@ const int SCENE_X = 0, SCENE_Y = 0; // in %
 const int SCENE_WIDTH = 100, SCENE_HEIGHT = 33; // in %
 const int SCENE_TOP_MARGIN = 20; // in px
 
-const double SCENE_MIN_Z = -500.0; // in m
-const double SCENE_MAX_Z = 2000.0; // in m
-const double SCENE_MIN_X = -500.0; // in m
-const double SCENE_MAX_X = 4500.0; // in m
+// Bounds and initial state of the scenario of the scene
+double scene_min_x = 0, scene_max_x = 0, scene_min_z = 0, scene_max_z = 0; // in m
+double scene_initial_state[TRAJECTORY_DIM];
 
 double scene_delta_x = 0;
 double scene_delta_z = 0;
@@ -30,31 +36,112 @@ const int GROUND_R = 0xFF, GROUND_G = 0x8C, GROUND_B = 0x00, GROUND_A = 0xFF;
 
 const int TRAJ_R = 0xFF, TRAJ_G = 0xFF, TRAJ_B = 0xFF, TRAJ_A = 0xFF;
 
+const int FOOTPRINT_R = 0x00, FOOTPRINT_G = 0x80, FOOTPRINT_B = 0x00, FOOTPRINT_A = 0x90;
+
+const int SUGGEST_R = 0xFF, SUGGEST_G = 0x00, SUGGEST_B = 0xFF, SUGGEST_A = 0x80;
+
 const double VELOCITY_DRAW_FACTOR = 3.0;
 const double THRUST_DRAW_FACTOR = 0.03;
 
 const int SQUARE_WIDTH = 7;
 
-void init_scene()
+const int FONT_SCALE = 2; // in px per font pixel
+
+const double HISTORY_TOLERANCE = 0.5; // in px between the drawn and the flown history
+
+struct view_t view = {NULL, 1.0, true, false, NULL, false, NULL, NULL};
+
+int screen_width = 0, screen_height = 0; // in px
+
+// Ground, frames, objective and initial state are rendered once in the cached layer
+bool static_layer_valid = false;
+
+// Screen space samples of the trajectory being drawn, grown as needed
+struct render_point_t *polyline = NULL;
+size_t polyline_capacity = 0;
+int polyline_start = 0, polyline_count = 0;
+
+// Screen resolution summary of the history, the full history stays in the lander
+struct decimation_t *history_summary = NULL;
+double summary_time = 0.0; // of the last history sample in the summary
+
+// 3x5 pixel glyphs, rows from the top
+static const char* glyph(char c)
 {
-    scene_x = WINDOW_MARGIN + (SCENE_X*SCREEN_WIDTH)/100;
-    scene_y = WINDOW_MARGIN + (SCENE_Y*SCREEN_HEIGHT)/100;
+    static const char *digits[10] = {
+        "111101101101111", "010110010010111", "111001111100111", "111001111001111", "101101111001001",
+        "111100111001111", "111100111101111", "111001001001001", "111101111101111", "111101111001111"};
+
+    static const char *letters[26] = {
+        "010101111101101", "110101110101110", "011100100100011", "110101101101110", "111100110100111",
+        "111100110100100", "011100101101011", "101101111101101", "111010010010111", "001001001101010",
+        "101101110101101", "100100100100111", "101111111101101", "110101101101101", "010101101101010",
+        "110101110100100", "010101101110011", "110101110101101", "011100010001110", "111010010010010",
+        "101101101101111", "101101101101010", "101101111111101", "101101010101101", "101101010010010",
+        "111001010100111"};
+
+    c = toupper((unsigned char)c);
+
+    if (c >= '0' && c <= '9') return digits[c-'0'];
+    if (c >= 'A' && c <= 'Z') return letters[c-'A'];
+    if (c == '.') return "000000000000010";
+    if (c == '-') return "000000111000000";
+    if (c == ':') return "000010000010000";
+    if (c == '/') return "001001010100100";
+
+    return "000000000000000";
+}
 
-    scene_delta_x = SCENE_MAX_X-SCENE_MIN_X;
-    scene_delta_z = SCENE_MAX_Z-SCENE_MIN_Z;
+void init_scene(int width, int height, const struct scenario_t *scenario)
+{
+    struct scenario_t defaults;
+    if (scenario == NULL)
+    {
+        init_scenario(&defaults);
+        scenario = &defaults;
+    }
+
+    scene_min_x = scenario->scene_min_x;
+    scene_max_x = scenario->scene_max_x;
+    scene_min_z = scenario->scene_min_z;
+    scene_max_z = scenario->scene_max_z;
+    for (int i = 0; i < TRAJECTORY_DIM; i++) scene_initial_state[i] = scenario->initial_state[i];
+
+    screen_width = width;
+    screen_height = height;
 
-    scene_width = SCENE_WIDTH*(SCREEN_WIDTH-2*WINDOW_MARGIN)/100;
-    scene_height = (double) (scene_delta_z/scene_delta_x)* (double) (SCREEN_WIDTH-2*WINDOW_MARGIN);
+    scene_x = WINDOW_MARGIN + (SCENE_X*width)/100;
+    scene_y = WINDOW_MARGIN + (SCENE_Y*height)/100;
+
+    scene_delta_x = scene_max_x-scene_min_x;
+    scene_delta_z = scene_max_z-scene_min_z;
+
+    scene_width = SCENE_WIDTH*(width-2*WINDOW_MARGIN)/100;
+    scene_height = (double) (scene_delta_z/scene_delta_x)* (double) (width-2*WINDOW_MARGIN);
 
     // printf("Scene init : x=%i, y=%i, w=%i, h=%i\n",scene_x,scene_y,scene_width,scene_height);
+
+    history_summary = free_decimation(history_summary);
+    history_summary = create_decimation(scene_width/scene_delta_x,scene_height/scene_delta_z,HISTORY_TOLERANCE);
+}
+
+void quit_scene()
+{
+    free(polyline);
+    polyline = NULL;
+    polyline_capacity = 0;
+
+    history_summary = free_decimation(history_summary);
+
+    static_layer_valid = false;
 }
 
 void scene_coordinates(double px, double pz, int *x, int *y, bool *out)
 {
     *out = false;
 
-    *x = scene_x + scene_width*(px-SCENE_MIN_X)/scene_delta_x;
-    *y = scene_y + scene_height*(SCENE_MAX_Z-pz)/scene_delta_z;
+    *x = scene_x + scene_width*(px-scene_min_x)/scene_delta_x;
+    *y = scene_y + scene_height*(scene_max_z-pz)/scene_delta_z;
 
     if (*x < scene_x) { *x = scene_x; *out = true; }
     if (*x > scene_x + scene_width) { *x = scene_x + scene_width; *out = true; }
@@ -62,29 +149,72 @@ void scene_coordinates(double px, double pz, int *x, int *y, bool *out)
     if (*y > scene_y + scene_height) { *y = scene_y + scene_height; *out = true; }
 }
 
-void draw_scene()
+// Parts of the scene that never change
+void draw_static_scene()
 {
     draw_ground();
     draw_objective();
 
     draw_scene_frame();
 
+    draw_initial_state();
+}
+
+// Parts of the scene that change every frame
+void draw_scene()
+{
+    draw_footprint();
     draw_predicted_trajectory();
     draw_trajectory();
-    
-    draw_initial_state();
+
     draw_current_state();    
 }
 
+// Rebuild the static layer before the next frame, after a resize or a lost render target
+void invalidate_static_layer(bool resized)
+{
+    if (resized) render_drop_layer();
+
+    static_layer_valid = false;
+}
+
+static void draw_background()
+{
+    render_color(0xFF, 0xFF, 0xFF, 0xFF);
+    render_clear();
+
+    draw_static_scene();
+    draw_mass_frame();
+}
+
+// Cover the whole target with the static layer, drawn directly when the backend has no layer
+void draw_static_layer()
+{
+    if (static_layer_valid && render_layer()) return;
+
+    static_layer_valid = false;
+
+    if (render_begin_layer())
+    {
+        draw_background();
+        render_end_layer();
+
+        static_layer_valid = render_layer();
+        if (static_layer_valid) return;
+    }
+
+    draw_background();
+}
+
 void draw_scene_frame()
 {
-    SDL_SetRenderDrawColor(screen, 0x00, 0x00, 0x00, 0xFF);
+    render_color(0x00, 0x00, 0x00, 0xFF);
     draw_frame(scene_x, scene_y, scene_width, scene_height);
 }
 
 void draw_frame(int x, int y, int w, int h)
 {
-    SDL_Point points[5]; 
+    struct render_point_t points[5]; 
 
     points[0].x = x;
     points[0].y = y;
@@ -101,20 +231,39 @@ void draw_frame(int x, int y, int w, int h)
     points[4].x = x;
     points[4].y = y;
 
-    SDL_RenderDrawLines(screen,points,5);
+    render_lines(points,5);
 }
 
 void draw_ground()
 {
-    SDL_Rect rect;
+    struct render_rect_t rect;
     bool out = false;
-    scene_coordinates(SCENE_MIN_X,0.0,&rect.x,&rect.y,&out);
-    scene_coordinates(SCENE_MAX_X,SCENE_MIN_Z,&rect.w,&rect.h,&out);
+    scene_coordinates(scene_min_x,0.0,&rect.x,&rect.y,&out);
+    scene_coordinates(scene_max_x,scene_min_z,&rect.w,&rect.h,&out);
     rect.h -= rect.y;
     rect.w = scene_width;
             
-    SDL_SetRenderDrawColor(screen, GROUND_R, GROUND_G, GROUND_B, GROUND_A);
-    SDL_RenderFillRect(screen, &rect);
+    render_color(GROUND_R, GROUND_G, GROUND_B, GROUND_A);
+    render_fill_rect(&rect);
+}
+
+// Band of the ground reachable from the lander, hidden while it predates the current state
+void draw_footprint()
+{
+    const struct footprint_result_t *footprint = view.footprint;
+
+    if (footprint == NULL || !footprint->valid || footprint->time > view.lander->time) return;
+
+    struct render_rect_t rect;
+    int right = 0, bottom = 0;
+    bool out = false;
+    scene_coordinates(footprint->x_min,0.0,&rect.x,&rect.y,&out);
+    scene_coordinates(footprint->x_max,0.0,&right,&bottom,&out);
+    rect.w = right - rect.x + 1;
+    rect.h = 2*SQUARE_WIDTH;
+
+    render_color(FOOTPRINT_R, FOOTPRINT_G, FOOTPRINT_B, FOOTPRINT_A);
+    render_fill_rect(&rect);
 }
 
 void draw_initial_state()
@@ -125,13 +274,13 @@ void draw_initial_state()
 
 void draw_initial_position()
 {
-    SDL_SetRenderDrawColor(screen, 0x00, 0xFF, 0x00, 0xFF);
-    draw_square(INITIAL_STATE[PX],INITIAL_STATE[PZ],SQUARE_WIDTH);
+    render_color(0x00, 0xFF, 0x00, 0xFF);
+    draw_square(scene_initial_state[PX],scene_initial_state[PZ],SQUARE_WIDTH);
 }
 
 void draw_square(double px, double pz, int w)
 {
-    SDL_Rect rect;
+    struct render_rect_t rect;
     bool out = false;    
     
     scene_coordinates(px,pz,&rect.x,&rect.y,&out);
@@ -143,20 +292,20 @@ void draw_square(double px, double pz, int w)
     rect.w = w;
     rect.h = w;
 
-    SDL_RenderFillRect(screen, &rect);
+    render_fill_rect(&rect);
 }
 
 void draw_initial_velocity()
 {
-    SDL_SetRenderDrawColor(screen, 0x00, 0xFF, 0x00, 0xFF);
-    draw_arrow(INITIAL_STATE[PX],INITIAL_STATE[PZ],
-                INITIAL_STATE[VX],INITIAL_STATE[VZ],
+    render_color(0x00, 0xFF, 0x00, 0xFF);
+    draw_arrow(scene_initial_state[PX],scene_initial_state[PZ],
+                scene_initial_state[VX],scene_initial_state[VZ],
                 VELOCITY_DRAW_FACTOR);
 }
 
 void draw_arrow(double x, double y, double u, double v, double k)
 {
-    SDL_Point pts[2];
+    struct render_point_t pts[2];
     bool out;
 
     scene_coordinates(x,y,&pts[0].x,&pts[0].y,&out);
@@ -165,58 +314,169 @@ void draw_arrow(double x, double y, double u, double v, double k)
 
     scene_coordinates(x+k*u,y+k*v,&pts[1].x,&pts[1].y,&out);
 
-    SDL_RenderDrawLines(screen,pts,2);
+    render_lines(pts,2);
 }
 
 void draw_objective()
 {    
-    SDL_SetRenderDrawColor(screen, 0xFF, 0x00, 0x00, 0xFF);
+    render_color(0xFF, 0x00, 0x00, 0xFF);
     draw_square(0.0,0.0,SQUARE_WIDTH);
 }
 
-void draw_trajectory()
+// Submit a run of visible samples, a single sample has no line
+static void draw_polyline(const struct render_point_t *points, int count)
 {
-    if (state_list == NULL) return;
-
-    SDL_SetRenderDrawColor(screen, 0x00, 0x00, 0x00, 0xFF);
-
-    draw_state_list(state_list);
+    if (count == 1) render_points(points,1);
+    if (count > 1) render_lines(points,count);
 }
 
-void draw_state_list(struct state_list_t * list)
+// Start projecting a trajectory of at most length samples
+static bool begin_polyline(size_t length)
 {
-    if (list == NULL) return;
+    if (length > polyline_capacity)
+    {
+        struct render_point_t *points = realloc(polyline,length*sizeof(struct render_point_t));
+        if (points == NULL) return false;
+
+        polyline = points;
+        polyline_capacity = length;
+    }
+
+    polyline_start = 0;
+    polyline_count = 0;
 
-    struct state_list_t *local_list = list;
+    return true;
+}
 
+// Samples on the same pixel as the previous one are dropped and samples out of the scene break the line
+static void add_polyline_point(double px, double pz)
+{
     bool out = false;
     int x = 0, y = 0;
 
-    while (local_list != NULL)
+    scene_coordinates(px,pz,&x,&y,&out);
+
+    if (out)
     {
-        if (local_list->state != NULL)
-        {
-            scene_coordinates(local_list->state[PX],local_list->state[PZ],&x,&y,&out);
+        draw_polyline(polyline+polyline_start,polyline_count-polyline_start);
+        polyline_start = polyline_count;
+        return;
+    }
+
+    if (polyline_count > polyline_start &&
+        polyline[polyline_count-1].x == x && polyline[polyline_count-1].y == y) return;
+
+    polyline[polyline_count].x = x;
+    polyline[polyline_count].y = y;
+    polyline_count++;
+}
+
+static void end_polyline()
+{
+    draw_polyline(polyline+polyline_start,polyline_count-polyline_start);
+}
+
+// Add the history samples appended since the last frame to the summary
+static void update_history_summary(const struct trajectory_t *history)
+{
+    double time, state[TRAJECTORY_DIM];
+
+    if (!last_state(history,&time,state))
+    {
+        clear_decimation(history_summary);
+        return;
+    }
+
+    // A reset restarts the history
+    if (time < summary_time || decimation_length(history_summary) == 0)
+    {
+        clear_decimation(history_summary);
+        summary_time = -INFINITY;
+    }
+
+    size_t count = 0;
+    while (count < history->length && history->time[sample_index(history,history->length-1-count)] > summary_time)
+        count++;
+
+    for (size_t i = history->length-count; i < history->length; i++)
+    {
+        size_t k = sample_index(history,i);
+        add_point(history_summary,history->state[PX][k],history->state[PZ][k]);
+    }
+
+    summary_time = time;
+}
+
+// Flown history from its screen resolution summary, the cost does not grow with the flight
+void draw_trajectory()
+{
+    if (view.lander->history == NULL) return;
+
+    render_color(0x00, 0x00, 0x00, 0xFF);
+
+    if (history_summary == NULL)
+    {
+        draw_state_list(view.lander->history);
+        return;
+    }
+
+    update_history_summary(view.lander->history);
+
+    size_t length = decimation_length(history_summary);
+    if (!begin_polyline(length)) return;
+
+    double px = 0.0, pz = 0.0;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        get_point(history_summary,i,&px,&pz);
+        add_polyline_point(px,pz);
+    }
+
+    end_polyline();
+}
 
-            if (!out) SDL_RenderDrawPoint(screen,x,y);
-        }      
+// Project the samples once and submit them as polylines
+void draw_state_list(const struct trajectory_t * traj)
+{
+    if (traj == NULL || traj->length == 0) return;
+
+    if (!begin_polyline(traj->length)) return;
 
-        local_list = local_list->next;
+    for (size_t i = 0; i < traj->length; i++)
+    {
+        size_t k = sample_index(traj,i);
+        add_polyline_point(traj->state[PX][k],traj->state[PZ][k]);
     }
+
+    end_polyline();
 }
 
 void draw_predicted_trajectory()
 {
-    if (!PREDICT) return;
+    if (!view.predict) return;
     
-    struct state_list_t * predicted = predict(state_list);
+    uint64_t start = profile_begin();
+    const struct trajectory_t * predicted = predict(view.lander);
+    profile_end(PROFILE_PREDICT,start);
+
     if (predicted == NULL) return;
 
-    SDL_SetRenderDrawColor(screen, 0x77, 0x88, 0x99, 0xFF);
+    render_color(0x77, 0x88, 0x99, 0xFF);
 
     draw_state_list(predicted);
+}
+
+// Current state interpolated between the last two physics ticks
+static bool rendered_state(double *state)
+{
+    for (int i = 0; i < STATE_DIM; i++)
+        state[i] = view.lander->state[i];
 
-    free_state_list(predicted);
+    if (view.render_alpha < 1.0)
+        interpolate_state(view.lander->history,view.lander->time-(1.0-view.render_alpha)*FORWARD_TIME_STEP,state);
+
+    return true;
 }
 
 void draw_current_state()
@@ -224,84 +484,207 @@ void draw_current_state()
     draw_current_position();
     draw_current_velocity();
     draw_current_thrust();
+    draw_suggestion();
 }
 
 void draw_current_position()
 {
-    if (state_list == NULL) return;
-    if (state_list->state == NULL) return;
+    double state[TRAJECTORY_DIM];
+    if (!rendered_state(state)) return;
             
-    SDL_SetRenderDrawColor(screen, 0x00, 0x00, 0x00, 0xFF);
-    draw_square(state_list->state[PX],state_list->state[PZ],SQUARE_WIDTH);
+    render_color(0x00, 0x00, 0x00, 0xFF);
+    draw_square(state[PX],state[PZ],SQUARE_WIDTH);
 }
 
 void draw_current_velocity()
 {
-    if (state_list == NULL) return;
-    if (state_list->state == NULL) return;
+    double state[TRAJECTORY_DIM];
+    if (!rendered_state(state)) return;
     
-    SDL_SetRenderDrawColor(screen, 0x00, 0x00, 0xFF, 0xFF);
-    draw_arrow(state_list->state[PX],state_list->state[PZ],
-                state_list->state[VX],state_list->state[VZ],
+    render_color(0x00, 0x00, 0xFF, 0xFF);
+    draw_arrow(state[PX],state[PZ],
+                state[VX],state[VZ],
                 VELOCITY_DRAW_FACTOR);
 }
 
 void draw_current_thrust()
 {
-    if (is_dry) return;
+    if (view.lander->is_dry) return;
+
+    double state[TRAJECTORY_DIM];
+    if (!rendered_state(state)) return;
     
-    SDL_SetRenderDrawColor(screen, 0xFF, 0x00, 0x00, 0xFF);
-    draw_arrow(state_list->state[PX],state_list->state[PZ],
-                current_thrust_x,current_thrust_z,
+    render_color(0xFF, 0x00, 0x00, 0xFF);
+    draw_arrow(state[PX],state[PZ],
+                view.lander->thrust.x,view.lander->thrust.z,
                 THRUST_DRAW_FACTOR);
 }
 
+// Ghost of the suggested thrust and what it achieves, hidden while it predates the current state
+void draw_suggestion()
+{
+    const struct suggestion_t *suggestion = view.suggestion;
+
+    if (suggestion == NULL || !suggestion->valid || suggestion->time > view.lander->time) return;
+    if (view.lander->is_grounded) return;
+
+    double state[TRAJECTORY_DIM];
+    if (!rendered_state(state)) return;
+
+    struct suggest_command_t command;
+    struct thrust_t thrust;
+    candidate_command(&suggestion->candidate,view.lander->time,&command);
+    thrust_command(&view.lander->vehicle,command.joy_x,command.joy_z,command.joy_n,state[M],&thrust);
+
+    render_color(SUGGEST_R, SUGGEST_G, SUGGEST_B, SUGGEST_A);
+    draw_arrow(state[PX],state[PZ],thrust.x,thrust.z,THRUST_DRAW_FACTOR);
+
+    char miss[FONT_MAX_LENGTH+1], detail[FONT_MAX_LENGTH+1];
+    snprintf(miss,sizeof(miss),"SUGGEST MISS %.0f M",suggestion->miss);
+
+    double left = suggestion->candidate.switch_time - view.lander->time;
+    if (left > 0.0 && isfinite(left))
+        snprintf(detail,sizeof(detail),"%.1f M/S SWITCH %.1f S",suggestion->speed,left);
+    else
+        snprintf(detail,sizeof(detail),"%.1f M/S",suggestion->speed);
+
+    int line = 7*FONT_SCALE;
+    int width = 4*24*FONT_SCALE; // room for 24 characters
+    int x = scene_x + scene_width - WINDOW_MARGIN - width;
+    int y = scene_y + WINDOW_MARGIN + 3*line; // below the autopilot status
+
+    render_color(0x00, 0x00, 0x00, 0xFF);
+    draw_text(x,y,miss);
+    draw_text(x,y+line,detail);
+}
+
 void draw_gravity()
 {
     
 }
 
+// Fuel gauge inside the cached frame
 void draw_mass()
 {
-    if (is_dry) 
-    {
-        draw_mass_frame();
-        return;
-    }
+    if (view.lander->is_dry) return;
 
-    double mass = state_list->state[M]-DRY_MASS;
-    double half = (WET_MASS-DRY_MASS)/2.0;
+    const struct vehicle_t *vehicle = &view.lander->vehicle;
+
+    double mass = view.lander->state[M]-vehicle->dry_mass;
+    double half = (vehicle->wet_mass-vehicle->dry_mass)/2.0;
 
     if (mass >= half)
-        SDL_SetRenderDrawColor(screen, 0x00, 0xFF, 0x00, 0xFF);
+        render_color(0x00, 0xFF, 0x00, 0xFF);
     
     if (mass < half && mass >= half/2.0)
-        SDL_SetRenderDrawColor(screen, 0xFF, 0x8C, 0x00, 0xFF);
+        render_color(0xFF, 0x8C, 0x00, 0xFF);
 
     if (mass < half/2.0)
-        SDL_SetRenderDrawColor(screen, 0xFF, 0x00, 0x00, 0xFF);
+        render_color(0xFF, 0x00, 0x00, 0xFF);
 
-    double ratio = mass/(WET_MASS-DRY_MASS);
+    double ratio = mass/(vehicle->wet_mass-vehicle->dry_mass);
 
-    SDL_Rect rect;    
-    rect.w = scene_height/12;
-    rect.h = ratio*scene_height/3;
-    rect.x = scene_x+WINDOW_MARGIN;
+    // Inset by one pixel to leave the frame untouched
+    struct render_rect_t rect;    
+    rect.w = scene_height/12 - 1;
+    rect.h = ratio*(scene_height/3 - 1);
+    rect.x = scene_x+WINDOW_MARGIN + 1;
     rect.y = scene_y+WINDOW_MARGIN + scene_height/3 - rect.h;
 
-    SDL_RenderFillRect(screen,&rect);
-
-    draw_mass_frame();
+    if (rect.h > 0) render_fill_rect(&rect);
 }
 
 void draw_mass_frame()
 {
-    SDL_SetRenderDrawColor(screen, 0x00, 0x00, 0x00, 0xFF);
+    render_color(0x00, 0x00, 0x00, 0xFF);
     draw_frame(scene_x+WINDOW_MARGIN, scene_y+WINDOW_MARGIN, scene_height/12, scene_height/3);
 }
 
+// Text in the 3x5 font from its top left corner, one fill call per line
+void draw_text(int x, int y, const char *text)
+{
+    struct render_rect_t rects[FONT_MAX_LENGTH*15];
+    int count = 0;
+
+    for (int i = 0; text[i] != '\0' && i < FONT_MAX_LENGTH; i++)
+    {
+        const char *pixels = glyph(text[i]);
+
+        for (int k = 0; k < 15; k++)
+        {
+            if (pixels[k] != '1') continue;
+
+            rects[count].x = x + (4*i + k%3)*FONT_SCALE;
+            rects[count].y = y + (k/3)*FONT_SCALE;
+            rects[count].w = FONT_SCALE;
+            rects[count].h = FONT_SCALE;
+            count++;
+        }
+    }
+
+    if (count > 0) render_fill_rects(rects,count);
+}
+
+// Age of the flown plan in simulated time and wall time of its solve
+void draw_autopilot_status()
+{
+    if (!view.autopilot) return;
+
+    const struct guidance_t *plan = view.plan;
+
+    char age[FONT_MAX_LENGTH+1], latency[FONT_MAX_LENGTH+1];
+
+    if (plan == NULL || !plan->valid)
+    {
+        snprintf(age,sizeof(age),"NO PLAN");
+        latency[0] = '\0';
+    }
+    else
+    {
+        snprintf(age,sizeof(age),"PLAN AGE %.2f S",view.lander->time - plan->start_time);
+        snprintf(latency,sizeof(latency),"SOLVE %.1f MS",1e3*plan->stats.last_time);
+    }
+
+    int line = 7*FONT_SCALE;
+    int width = 4*16*FONT_SCALE; // room for 16 characters
+    int x = scene_x + scene_width - WINDOW_MARGIN - width;
+    int y = scene_y + WINDOW_MARGIN;
+
+    render_color(0x00, 0x00, 0x00, 0xFF);
+    draw_text(x,y,age);
+    draw_text(x,y+line,latency);
+}
+
+// Frame profile of the last window, right of the mass gauge
+void draw_profile_overlay()
+{
+    if (!view.profile) return;
+
+    char text[FONT_MAX_LENGTH+1];
+
+    int line = 7*FONT_SCALE;
+    int x = scene_x + 2*WINDOW_MARGIN + scene_height/12;
+    int y = scene_y + WINDOW_MARGIN;
+
+    render_color(0x00, 0x00, 0x00, 0xFF);
+
+    draw_text(x,y,"MS        P50    P99    MAX");
+
+    for (int i = 0; i < PROFILE_ZONES; i++)
+    {
+        const struct profile_summary_t *shown = &profiler.zones[i].shown;
+
+        snprintf(text,sizeof(text),"%-7s %6.2f %6.2f %6.2f",PROFILE_ZONE_NAMES[i],
+            1e3*shown->p50,1e3*shown->p99,1e3*shown->max);
+
+        draw_text(x,y+(i+1)*line,text);
+    }
+}
+
 void draw_all()
 {
     draw_scene();
     draw_mass();
+    draw_autopilot_status();
+    draw_profile_overlay();
 }
\ No newline at end of file
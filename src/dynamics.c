@@ -1,16 +1,20 @@
 #include "marslanding/dynamics.h"
 
-#include "marslanding/sdl_utils.h"
-#include "marslanding/game.h"
+#include "marslanding/integrator.h"
+#include "marslanding/propagator.h"
 
-#include <SDL2/SDL.h>
 #include <stdlib.h> 
 #include <stdio.h>
 #include <math.h> 
 
 const double FORWARD_TIME_STEP = 0.01;
 
-// Vehicule parameters
+const size_t TRAJECTORY_CAPACITY = 1 << 16; // ~11 min of flight
+const size_t PREDICTION_CAPACITY = 1 << 15;
+const double PREDICTION_THRUST_TOLERANCE = 1e-3; // relative
+const double PREDICTION_STATE_TOLERANCE[] = {0.5, 0.5, 0.05, 0.05, 0.05}; // m, m, m/s, m/s, kg
+
+// Default vehicule parameters
 const double DRY_MASS = 1505.0;
 const double WET_MASS = 1905.0;
 const double ISP = 225.0;
@@ -31,149 +35,155 @@ const char* STATE_UNITS[] = {"m","m","m/s","m/s","kg",NULL};
 
 const double INITIAL_STATE[] = {2000.0, 1500.0, 100.0, -75.0, 1905.0};
 
-struct state_list_t * state_list = NULL;
+// Default vehicle parameters
+void init_vehicle(struct vehicle_t *vehicle)
+{
+    vehicle->dry_mass = DRY_MASS;
+    vehicle->wet_mass = WET_MASS;
+    vehicle->isp = ISP;
+    vehicle->nb_thrusters = NB_THRUSTERS;
+    vehicle->t_1 = T_1;
+    vehicle->t_2 = T_2;
+    vehicle->t_bar = T_bar;
+    vehicle->phi = PHI;
+
+    derive_vehicle(vehicle);
+}
 
-double current_thrust_x = 0.0;
-double current_thrust_z = 0.0;
-double current_thrust_norm = 0.0;
+// Compute derived constants from vehicle parameters
+void derive_vehicle(struct vehicle_t *vehicle)
+{
+    vehicle->cos_phi = cos(vehicle->phi*M_PI/180.0);
+    vehicle->alpha = 1.0/vehicle->isp/EARTH_GRAVITY/vehicle->cos_phi;
+    vehicle->rho_1 = (double)(vehicle->nb_thrusters)*vehicle->t_1*vehicle->t_bar*vehicle->cos_phi;
+    vehicle->rho_2 = (double)(vehicle->nb_thrusters)*vehicle->t_2*vehicle->t_bar*vehicle->cos_phi;
+}
+
+// Allocate a lander with the default vehicle at the initial state, history_capacity may be 0
+struct lander_t* create_lander(size_t history_capacity)
+{
+    struct lander_t *lander = calloc(1,sizeof(struct lander_t));
+    if (lander == NULL) return NULL;
+
+    if (history_capacity > 0)
+    {
+        lander->history = create_trajectory(history_capacity);
+        if (lander->history == NULL) return free_lander(lander);
+    }
 
-double cos_phi = 0.0;
-double alpha = 0.0;
-double rho_1 = 0.0, rho_2 = 0.0;
+    init_vehicle(&lander->vehicle);
+    reset_lander(lander,INITIAL_STATE);
 
-bool is_dry = false;
-bool is_grounded = false;
+    return lander;
+}
 
-// Non-const copy of initial state
-double* copy_initial_state()
+// Free memory for a lander
+struct lander_t* free_lander(struct lander_t *lander)
 {
-    double *state = malloc(STATE_DIM*sizeof(double));
-    if(state == NULL) return NULL;
+    if (lander == NULL) return NULL;
 
-    for(int i = 0; i < STATE_DIM; i++)
-        state[i] = INITIAL_STATE[i];
+    free_trajectory(lander->history);
+    free_trajectory(lander->prediction.samples);
+    free(lander);
 
-    return state;
+    return NULL;
 }
 
-// Initialize dynamics parameters
-void init_dynamics()
+// Restart a lander from a state with idle thrust
+void reset_lander(struct lander_t *lander, const double *state)
 {
-    cos_phi = cos(PHI*M_PI/180.0);
-    alpha = 1.0/ISP/EARTH_GRAVITY/cos_phi;
-    rho_1 = (double)(NB_THRUSTERS)*T_1*T_bar*cos_phi;
-    rho_2 = (double)(NB_THRUSTERS)*T_2*T_bar*cos_phi;
-
-    current_thrust_z = MARS_GRAVITY*INITIAL_STATE[M];
-    current_thrust_x = 0.0;
-
-    is_dry = (INITIAL_STATE[M] <= DRY_MASS);
-    is_grounded = (INITIAL_STATE[PZ] <= 0.0);
-    
-    compute_thrust();
-}
+    lander->time = 0.0;
+    for (int i = 0; i < STATE_DIM; i++)
+        lander->state[i] = state[i];
 
-// Initialize linked list of states with initial conditions
-void* init_state_list()
-{    
-    state_list = free_state_list(state_list);
-    
-    state_list = add_state(NULL,0.0,copy_initial_state());
-    
-    return state_list;
+    thrust_command(&lander->vehicle,0.0,0.0,0.0,state[M],&lander->thrust);
+
+    lander->is_dry = (state[M] <= lander->vehicle.dry_mass);
+    lander->is_grounded = (state[PZ] <= 0.0);
+    lander->adaptive_step = 0.0;
+
+    clear_trajectory(lander->history);
+    append_state(lander->history,lander->time,lander->state);
+
+    invalidate_prediction(lander);
 }
 
 // Integrate dynamics for a fixed step time
-double* forward_step(double *state, double step)
+bool forward_step(struct lander_t *lander, double step)
 {    
-    double* new_state = euler(state,step);
-    if (new_state == NULL) return NULL;
+    double advanced = integrate(lander,lander->state,step,&lander->adaptive_step,NULL);
+    if (advanced < 0.0) return false;
+
+    lander->time += advanced;
 
     // ground impact event
-    if (new_state[PZ] <= 0.0) 
-    {
-        is_grounded = true;
-        GAME_OVER = true;
-    }
+    if (lander->state[PZ] <= 0.0) lander->is_grounded = true;
 
     // dry event
-    if (new_state[M] <= DRY_MASS) is_dry = true;
+    if (lander->state[M] <= lander->vehicle.dry_mass) lander->is_dry = true;
 
-    return new_state;
+    append_state(lander->history,lander->time,lander->state);
+
+    return true;
 }
 
-double * euler(double *state, double step)
+bool euler(const struct lander_t *lander, const double *state, double step, double *new_state)
 {
-    double* new_state = system_dynamics(state);
-    if (new_state == NULL) return NULL;
+    double dynamics[TRAJECTORY_DIM];
+    if (!system_dynamics(lander,state,dynamics)) return false;
 
     for(int i = 0; i < STATE_DIM; i++)
     {
         // Euler step
-        new_state[i] *= step;
-        new_state[i] += state[i];
+        dynamics[i] *= step;
+        new_state[i] = dynamics[i] + state[i];
     }
 
-    return new_state;
+    return true;
 }
 
-// Integrate dynamics for any duration with small steps stored in the global linked list
-void forward()
+// Integrate dynamics for one fixed time step
+void forward_tick(struct lander_t *lander)
 {
-    if (!is_grounded)
+    if (!lander->is_grounded)
     {
-        // Compute trajectories
-        timer.current_tick = SDL_GetTicks();
-        double elapsed_time = (double)(timer.current_tick-timer.previous_tick)/1000.0;
-
-        state_list = forward_duration(state_list,elapsed_time);
-
-        timer.previous_tick = timer.current_tick;
-        // print_current_state(); 
+        forward_duration(lander,FORWARD_TIME_STEP);
     }
 }
 
-// Integrate dynamics for any duration with small steps stored in a linked list
-struct state_list_t * forward_duration(struct state_list_t *state, double duration)
+// Integrate dynamics for any duration with small steps, in constant stack
+bool forward_duration(struct lander_t *lander, double duration)
 {
-    if(duration <= 0.0) return state;
-    
-    if(duration > FORWARD_TIME_STEP)
+    while(duration > 0.0)
     {
-        state = add_state(state, // head of list
-            state->time+FORWARD_TIME_STEP, // time
-            forward_step(state->state,FORWARD_TIME_STEP)); // state
+        double step = (duration > FORWARD_TIME_STEP) ? FORWARD_TIME_STEP : duration;
 
-        return forward_duration(state,duration-FORWARD_TIME_STEP);
-    }
-    else
-    {
-        state = add_state(state, // head of list
-            state->time+duration, // time
-            forward_step(state->state,duration)); // state
+        if(!forward_step(lander,step)) return false;
 
-        return state;
+        duration -= step;
     }
+
+    return true;
 }
 
 // Compute system dynamics
-double* system_dynamics(double *state)
+bool system_dynamics(const struct lander_t *lander, const double *state, double *dynamics)
 {
-    if(state == NULL) return NULL;
-    
-    double* dynamics = malloc(STATE_DIM*sizeof(double));
-    if(dynamics == NULL) return NULL;
+    if(lander == NULL || state == NULL || dynamics == NULL) return false;
+
+    const struct vehicle_t *vehicle = &lander->vehicle;
+    const struct thrust_t *thrust = &lander->thrust;
 
     dynamics[PX] = state[VX];
     dynamics[PZ] = state[VZ];
 
-    if (state[M] > DRY_MASS && state[PZ] > 0.0)
+    if (state[M] > vehicle->dry_mass && state[PZ] > 0.0)
     {
-        dynamics[VX] = current_thrust_x/state[M];
-        dynamics[VZ] = -MARS_GRAVITY + current_thrust_z/state[M];
-        dynamics[M] = -alpha*current_thrust_norm;
+        dynamics[VX] = thrust->x/state[M];
+        dynamics[VZ] = -MARS_GRAVITY + thrust->z/state[M];
+        dynamics[M] = -vehicle->alpha*thrust->norm;
     }
-    else if (state[M] <= DRY_MASS && state[PZ] > 0.0)
+    else if (state[M] <= vehicle->dry_mass && state[PZ] > 0.0)
     {
         dynamics[VX] = 0.0;
         dynamics[VZ] = -MARS_GRAVITY;
@@ -186,72 +196,160 @@ double* system_dynamics(double *state)
         dynamics[M] = 0.0;
     } 
 
-    return dynamics;
+    return true;
+}
+
+static bool same_thrust(double a, double b)
+{
+    return fabs(a-b) <= PREDICTION_THRUST_TOLERANCE*fmax(fabs(a),fabs(b));
 }
 
-struct state_list_t * predict(struct state_list_t *initial_state)
+// Check if the cached prediction still holds for the lander
+static bool prediction_holds(const struct lander_t *lander)
 {
-    if (initial_state == NULL) return NULL;
-    if (initial_state->state == NULL) return NULL;
+    const struct prediction_t *prediction = &lander->prediction;
+
+    if (!prediction->valid) return false;
+    if (prediction->integrator != lander_integrator(lander)) return false;
 
-    struct state_list_t * state = malloc(sizeof(struct state_list_t));
-    if (state == NULL) return NULL;
-    state->state = malloc(STATE_DIM*sizeof(double));
+    if (!same_thrust(prediction->thrust.x,lander->thrust.x)) return false;
+    if (!same_thrust(prediction->thrust.z,lander->thrust.z)) return false;
+    if (!same_thrust(prediction->thrust.norm,lander->thrust.norm)) return false;
+
+    double predicted[TRAJECTORY_DIM];
+    if (!interpolate_state(prediction->samples,lander->time,predicted)) return false;
 
-    state->time = initial_state->time;
     for (int i = 0; i < STATE_DIM; i++)
     {
-        state->state[i] = initial_state->state[i];
+        if (fabs(predicted[i]-lander->state[i]) > PREDICTION_STATE_TOLERANCE[i]) return false;
     }
-    state->next = NULL;
 
-    while((state->state[PZ] >= 0.0) && (state->state[M] > DRY_MASS))
+    // Refill a truncated prediction once half of it is consumed
+    if (prediction->truncated && 2*prediction->samples->length < prediction->samples->capacity) return false;
+
+    return true;
+}
+
+const struct trajectory_t * predict(struct lander_t *lander)
+{
+    struct prediction_t *prediction = &lander->prediction;
+
+    if (prediction->samples == NULL) prediction->samples = create_trajectory(PREDICTION_CAPACITY);
+    if (prediction->samples == NULL) return NULL;
+
+    // Shift the previous prediction to the current time, keeping a sample to interpolate from
+    if (prediction_holds(lander))
+    {
+        evict_states_until(prediction->samples,lander->time);
+        return prediction->samples;
+    }
+
+    struct trajectory_t * predicted = prediction->samples;
+    clear_trajectory(predicted);
+
+    double time = lander->time;
+    double state[TRAJECTORY_DIM];
+    for (int i = 0; i < STATE_DIM; i++)
+        state[i] = lander->state[i];
+
+    const struct integrator_t *integrator = lander_integrator(lander);
+    prediction->thrust = lander->thrust;
+    prediction->integrator = integrator;
+    prediction->valid = true;
+
+    // Closed form, sampled at the display resolution up to ground or dry
+    if (integrator == &ANALYTIC_INTEGRATOR)
+    {
+        struct arc_t arc;
+        init_arc(&arc,&lander->vehicle,&lander->thrust,time,state);
+
+        double resolution = (lander->prediction_resolution > 0.0) ?
+            lander->prediction_resolution : PREDICTION_RESOLUTION;
+        double end_time = fmin(arc.dry_time,arc_touchdown_time(&arc));
+
+        prediction->truncated = !sample_arc(&arc,end_time,resolution,predicted);
+
+        return predicted;
+    }
+
+    append_state(predicted,time,state);
+
+    double adaptive_step = lander->adaptive_step;
+    int events = EVENT_NONE;
+
+    // Stop before the buffer wraps around
+    while((state[PZ] >= 0.0) && (state[M] > lander->vehicle.dry_mass) 
+        && !(events & EVENT_TOUCHDOWN) && (predicted->length < predicted->capacity))
     {
-        state = add_state(state,state->time+FORWARD_TIME_STEP,euler(state->state,FORWARD_TIME_STEP));        
+        double advanced = integrate(lander,state,integrator->prediction_step,&adaptive_step,&events);
+        if (advanced < 0.0) break;
+        time += advanced;
+
+        append_state(predicted,time,state);
     }
 
-    return state;
+    prediction->truncated = (predicted->length == predicted->capacity);
+
+    return predicted;
 }
 
-void compute_thrust()
+// Force the next prediction to be recomputed
+void invalidate_prediction(struct lander_t *lander)
 {
-    if (joy_thrust_x == 0.0 && joy_thrust_z == 0.0)
+    lander->prediction.valid = false;
+}
+
+// Thrust commanded by a unit direction and a magnitude in [0,1], gravity compensation when idle
+void thrust_command(const struct vehicle_t *vehicle, double joy_x, double joy_z, double joy_n,
+    double mass, struct thrust_t *thrust)
+{
+    if (joy_x == 0.0 && joy_z == 0.0)
     {
-        current_thrust_x = 0.0;
-        current_thrust_z = MARS_GRAVITY*state_list->state[M];
-        current_thrust_norm = current_thrust_z;
+        thrust->x = 0.0;
+        thrust->z = MARS_GRAVITY*mass;
+        thrust->norm = thrust->z;
     }
     else
     {
-        current_thrust_norm = rho_1 + (rho_2-rho_1)*joy_thrust_n;
-        current_thrust_x = joy_thrust_x*current_thrust_norm;
-        current_thrust_z = joy_thrust_z*current_thrust_norm;
+        thrust->norm = vehicle->rho_1 + (vehicle->rho_2-vehicle->rho_1)*joy_n;
+        thrust->x = joy_x*thrust->norm;
+        thrust->z = joy_z*thrust->norm;
     }    
 }
 
-void print_current_state()
+// Update lander thrust from the joystick command
+void compute_thrust(struct lander_t *lander, double joy_x, double joy_z, double joy_n)
+{
+    thrust_command(&lander->vehicle,joy_x,joy_z,joy_n,lander->state[M],&lander->thrust);
+}
+
+static int throttle_level(const struct lander_t *lander)
+{
+    const struct vehicle_t *vehicle = &lander->vehicle;
+
+    return lander->thrust.norm/vehicle->nb_thrusters/vehicle->t_bar/vehicle->cos_phi*100;
+}
+
+void print_current_state(const struct lander_t *lander)
 {    
-    printf("Current state (t=%.2fs) \n{\n",state_list->time);
+    printf("Current state (t=%.2fs) \n{\n",lander->time);
     for(int i = 0; i < STATE_DIM; i++)
     {
-        printf("  %s = %.2f %s",STATE_NAMES[i],state_list->state[i],STATE_UNITS[i]);
+        printf("  %s = %.2f %s",STATE_NAMES[i],lander->state[i],STATE_UNITS[i]);
         if (i < STATE_DIM-1)
             printf("\n");
     }
-    printf(" (DRY @ %.2f)\n",DRY_MASS);
+    printf(" (DRY @ %.2f)\n",lander->vehicle.dry_mass);
 
-    int throttle_level = current_thrust_norm/NB_THRUSTERS/T_bar/cos_phi*100;
-    printf("  TX = %.2f N\n",current_thrust_x);
-    printf("  TZ = %.2f N\n",current_thrust_z);
-    printf("  |T| = %.2f N (%i%%)",current_thrust_norm,throttle_level);
+    printf("  TX = %.2f N\n",lander->thrust.x);
+    printf("  TZ = %.2f N\n",lander->thrust.z);
+    printf("  |T| = %.2f N (%i%%)",lander->thrust.norm,throttle_level(lander));
 
     printf("\n}\n");
 }
 
-void print_current_thrust()
+void print_current_thrust(const struct lander_t *lander)
 {
-    int throttle_level = current_thrust_norm/NB_THRUSTERS/T_bar/cos_phi*100;
-
     printf("Current thrust : Tx = %f, Tz = %f, Tn = %f (%i%%)\n",
-        current_thrust_x,current_thrust_z,current_thrust_norm,throttle_level);
-}
\ No newline at end of file
+        lander->thrust.x,lander->thrust.z,lander->thrust.norm,throttle_level(lander));
+}
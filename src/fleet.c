@@ -0,0 +1,290 @@
+#include "marslanding/fleet.h"
+
+#include "marslanding/dynamics.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define FLEET_SSE2
+#endif
+
+#if defined(FLEET_SSE2) && defined(__GNUC__)
+#define FLEET_AVX2
+#endif
+
+const size_t FLEET_VECTOR_WIDTH = 4; // doubles per AVX register
+
+// Allocate a fleet of size landers at the initial state with idle thrust
+struct fleet_t* create_fleet(size_t size, const struct vehicle_t *vehicle)
+{
+    if (size == 0) return NULL;
+
+    struct fleet_t *fleet = calloc(1,sizeof(struct fleet_t));
+    if (fleet == NULL) return NULL;
+
+    fleet->vehicle = *vehicle;
+    fleet->size = size;
+    fleet->capacity = (size + FLEET_VECTOR_WIDTH-1)/FLEET_VECTOR_WIDTH*FLEET_VECTOR_WIDTH;
+
+    // Single block for all columns
+    double *block = malloc((TRAJECTORY_DIM+3)*fleet->capacity*sizeof(double));
+    if (block == NULL)
+    {
+        free(fleet);
+        return NULL;
+    }
+
+    for (int i = 0; i < TRAJECTORY_DIM; i++)
+        fleet->state[i] = block + i*fleet->capacity;
+
+    fleet->thrust_x = block + TRAJECTORY_DIM*fleet->capacity;
+    fleet->thrust_z = block + (TRAJECTORY_DIM+1)*fleet->capacity;
+    fleet->thrust_norm = block + (TRAJECTORY_DIM+2)*fleet->capacity;
+
+    struct thrust_t thrust;
+    thrust_command(vehicle,0.0,0.0,0.0,INITIAL_STATE[M],&thrust);
+
+    // Padding lanes are kept grounded so they never produce NaN
+    double grounded[TRAJECTORY_DIM] = {0.0, 0.0, 0.0, 0.0, vehicle->dry_mass};
+
+    for (size_t i = 0; i < fleet->capacity; i++)
+        set_fleet_lander(fleet,i,(i < size) ? INITIAL_STATE : grounded,&thrust);
+
+    return fleet;
+}
+
+// Free memory for a fleet
+struct fleet_t* free_fleet(struct fleet_t *fleet)
+{
+    if (fleet == NULL) return NULL;
+
+    free(fleet->state[0]);
+    free(fleet);
+
+    return NULL;
+}
+
+// Set the state and thrust of the i-th lander
+void set_fleet_lander(struct fleet_t *fleet, size_t i, const double *state, const struct thrust_t *thrust)
+{
+    for (int j = 0; j < STATE_DIM; j++)
+        fleet->state[j][i] = state[j];
+
+    if (thrust == NULL) return;
+
+    fleet->thrust_x[i] = thrust->x;
+    fleet->thrust_z[i] = thrust->z;
+    fleet->thrust_norm[i] = thrust->norm;
+}
+
+// Copy the state of the i-th lander
+void get_fleet_state(const struct fleet_t *fleet, size_t i, double *state)
+{
+    for (int j = 0; j < STATE_DIM; j++)
+        state[j] = fleet->state[j][i];
+}
+
+// Euler step of lander i, same operations as system_dynamics() and euler()
+static inline void lander_euler(struct fleet_t *fleet, size_t i, double step)
+{
+    double *px = fleet->state[PX], *pz = fleet->state[PZ];
+    double *vx = fleet->state[VX], *vz = fleet->state[VZ];
+    double *m = fleet->state[M];
+
+    double ax = 0.0, az = 0.0, dm = 0.0;
+
+    if (m[i] > fleet->vehicle.dry_mass && pz[i] > 0.0)
+    {
+        ax = fleet->thrust_x[i]/m[i];
+        az = -MARS_GRAVITY + fleet->thrust_z[i]/m[i];
+        dm = -fleet->vehicle.alpha*fleet->thrust_norm[i];
+    }
+    else if (pz[i] > 0.0)
+    {
+        az = -MARS_GRAVITY;
+    }
+
+    px[i] = vx[i]*step + px[i];
+    pz[i] = vz[i]*step + pz[i];
+    vx[i] = ax*step + vx[i];
+    vz[i] = az*step + vz[i];
+    m[i] = dm*step + m[i];
+}
+
+// Euler step of all landers one at a time
+void fleet_euler_scalar(struct fleet_t *fleet, double step)
+{
+    for (size_t i = 0; i < fleet->size; i++)
+        lander_euler(fleet,i,step);
+}
+
+#ifdef FLEET_SSE2
+
+// Two landers per iteration, dry and grounded regimes selected with masks
+static void fleet_euler_sse2(struct fleet_t *fleet, double step)
+{
+    double *px = fleet->state[PX], *pz = fleet->state[PZ];
+    double *vx = fleet->state[VX], *vz = fleet->state[VZ];
+    double *m = fleet->state[M];
+
+    const __m128d dt = _mm_set1_pd(step);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d dry = _mm_set1_pd(fleet->vehicle.dry_mass);
+    const __m128d gravity = _mm_set1_pd(-MARS_GRAVITY);
+    const __m128d alpha = _mm_set1_pd(-fleet->vehicle.alpha);
+
+    for (size_t i = 0; i < fleet->capacity; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(px+i), z = _mm_loadu_pd(pz+i);
+        __m128d u = _mm_loadu_pd(vx+i), w = _mm_loadu_pd(vz+i);
+        __m128d mass = _mm_loadu_pd(m+i);
+
+        __m128d airborne = _mm_cmpgt_pd(z,zero);
+        __m128d wet = _mm_and_pd(airborne,_mm_cmpgt_pd(mass,dry));
+
+        __m128d ax = _mm_div_pd(_mm_loadu_pd(fleet->thrust_x+i),mass);
+        __m128d az = _mm_add_pd(gravity,_mm_div_pd(_mm_loadu_pd(fleet->thrust_z+i),mass));
+        __m128d dm = _mm_mul_pd(alpha,_mm_loadu_pd(fleet->thrust_norm+i));
+
+        ax = _mm_and_pd(wet,ax);
+        az = _mm_or_pd(_mm_and_pd(wet,az),_mm_andnot_pd(wet,_mm_and_pd(airborne,gravity)));
+        dm = _mm_and_pd(wet,dm);
+
+        _mm_storeu_pd(px+i,_mm_add_pd(_mm_mul_pd(u,dt),x));
+        _mm_storeu_pd(pz+i,_mm_add_pd(_mm_mul_pd(w,dt),z));
+        _mm_storeu_pd(vx+i,_mm_add_pd(_mm_mul_pd(ax,dt),u));
+        _mm_storeu_pd(vz+i,_mm_add_pd(_mm_mul_pd(az,dt),w));
+        _mm_storeu_pd(m+i,_mm_add_pd(_mm_mul_pd(dm,dt),mass));
+    }
+}
+
+#endif
+
+#ifdef FLEET_AVX2
+
+// Four landers per iteration, compiled for AVX2 and selected at run time
+__attribute__((target("avx2")))
+static void fleet_euler_avx2(struct fleet_t *fleet, double step)
+{
+    double *px = fleet->state[PX], *pz = fleet->state[PZ];
+    double *vx = fleet->state[VX], *vz = fleet->state[VZ];
+    double *m = fleet->state[M];
+
+    const __m256d dt = _mm256_set1_pd(step);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d dry = _mm256_set1_pd(fleet->vehicle.dry_mass);
+    const __m256d gravity = _mm256_set1_pd(-MARS_GRAVITY);
+    const __m256d alpha = _mm256_set1_pd(-fleet->vehicle.alpha);
+
+    for (size_t i = 0; i < fleet->capacity; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(px+i), z = _mm256_loadu_pd(pz+i);
+        __m256d u = _mm256_loadu_pd(vx+i), w = _mm256_loadu_pd(vz+i);
+        __m256d mass = _mm256_loadu_pd(m+i);
+
+        __m256d airborne = _mm256_cmp_pd(z,zero,_CMP_GT_OQ);
+        __m256d wet = _mm256_and_pd(airborne,_mm256_cmp_pd(mass,dry,_CMP_GT_OQ));
+
+        __m256d ax = _mm256_div_pd(_mm256_loadu_pd(fleet->thrust_x+i),mass);
+        __m256d az = _mm256_add_pd(gravity,_mm256_div_pd(_mm256_loadu_pd(fleet->thrust_z+i),mass));
+        __m256d dm = _mm256_mul_pd(alpha,_mm256_loadu_pd(fleet->thrust_norm+i));
+
+        ax = _mm256_and_pd(wet,ax);
+        az = _mm256_blendv_pd(_mm256_and_pd(airborne,gravity),az,wet);
+        dm = _mm256_and_pd(wet,dm);
+
+        // Separate multiply and add, as the scalar path, no fused rounding
+        _mm256_storeu_pd(px+i,_mm256_add_pd(_mm256_mul_pd(u,dt),x));
+        _mm256_storeu_pd(pz+i,_mm256_add_pd(_mm256_mul_pd(w,dt),z));
+        _mm256_storeu_pd(vx+i,_mm256_add_pd(_mm256_mul_pd(ax,dt),u));
+        _mm256_storeu_pd(vz+i,_mm256_add_pd(_mm256_mul_pd(az,dt),w));
+        _mm256_storeu_pd(m+i,_mm256_add_pd(_mm256_mul_pd(dm,dt),mass));
+    }
+}
+
+static bool has_avx2()
+{
+    static int supported = -1;
+
+    if (supported < 0) supported = __builtin_cpu_supports("avx2") ? 1 : 0;
+
+    return supported == 1;
+}
+
+#endif
+
+// Euler step of all landers with the widest available vector instructions
+void fleet_euler(struct fleet_t *fleet, double step)
+{
+#ifdef FLEET_AVX2
+    if (has_avx2())
+    {
+        fleet_euler_avx2(fleet,step);
+        return;
+    }
+#endif
+
+#ifdef FLEET_SSE2
+    fleet_euler_sse2(fleet,step);
+#else
+    fleet_euler_scalar(fleet,step);
+#endif
+}
+
+// Name of the instruction set used by fleet_euler
+const char* fleet_instruction_set()
+{
+#ifdef FLEET_AVX2
+    if (has_avx2()) return "avx2";
+#endif
+
+#ifdef FLEET_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// Largest relative deviation between fleet_euler and the scalar euler over some steps
+double check_fleet_euler(struct fleet_t *fleet, double step, size_t steps)
+{
+    struct lander_t *landers = calloc(fleet->size,sizeof(struct lander_t));
+    if (landers == NULL) return INFINITY;
+
+    for (size_t i = 0; i < fleet->size; i++)
+    {
+        landers[i].vehicle = fleet->vehicle;
+        get_fleet_state(fleet,i,landers[i].state);
+
+        landers[i].thrust.x = fleet->thrust_x[i];
+        landers[i].thrust.z = fleet->thrust_z[i];
+        landers[i].thrust.norm = fleet->thrust_norm[i];
+    }
+
+    double deviation = 0.0;
+
+    for (size_t k = 0; k < steps; k++)
+    {
+        fleet_euler(fleet,step);
+
+        for (size_t i = 0; i < fleet->size; i++)
+        {
+            euler(&landers[i],landers[i].state,step,landers[i].state);
+
+            for (int j = 0; j < STATE_DIM; j++)
+            {
+                double expected = landers[i].state[j];
+                double error = fabs(fleet->state[j][i]-expected)/fmax(fabs(expected),1.0);
+
+                if (!(error <= deviation)) deviation = error; // catches NaN
+            }
+        }
+    }
+
+    free(landers);
+
+    return deviation;
+}
@@ -0,0 +1,250 @@
+#include "marslanding/footprint.h"
+
+#include "marslanding/dynamics.h"
+#include "marslanding/planner.h"
+#include "marslanding/profiler.h"
+#include "marslanding/propagator.h"
+#include "marslanding/thread_pool.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+const int FOOTPRINT_BASE_ANGLES = 16; // thrust directions of the first level
+const int FOOTPRINT_LEVELS = 5; // last level flies FOOTPRINT_BASE_ANGLES*2^4 directions
+const double FOOTPRINT_PERIOD = 0.2; // in s of simulated time between requests
+const double FOOTPRINT_BURN_FRACTIONS[] = {1.0, 0.5, 0.25}; // of the fuel burnt in the fixed direction
+const int FOOTPRINT_BURNS = 3;
+const double FOOTPRINT_KEY_RESOLUTION[] = {0.5, 0.5, 0.05, 0.05, 0.05}; // per state component
+const size_t FOOTPRINT_CHUNK = 16; // programs per parallel task
+
+// Touchdown x of one program from a state, NAN when it never lands
+double program_touchdown(const struct lander_t *lander, double angle, double norm, double burn_fraction)
+{
+    struct thrust_t thrust = {sin(angle)*norm, cos(angle)*norm, norm};
+    struct arc_t arc;
+
+    init_arc(&arc,&lander->vehicle,&thrust,lander->time,lander->state);
+
+    double touchdown = arc_touchdown_time(&arc);
+    double end_time = arc.start_time + burn_fraction*(arc.dry_time - arc.start_time);
+
+    // Lower bound upwards for the rest of the fuel
+    if(burn_fraction < 1.0 && touchdown > end_time)
+    {
+        double state[TRAJECTORY_DIM];
+        arc_state(&arc,end_time,state);
+
+        struct thrust_t hold = {0.0, lander->vehicle.rho_1, lander->vehicle.rho_1};
+        init_arc(&arc,&lander->vehicle,&hold,end_time,state);
+
+        touchdown = arc_touchdown_time(&arc);
+    }
+
+    if(!isfinite(touchdown)) return NAN;
+
+    double state[TRAJECTORY_DIM];
+    arc_state(&arc,touchdown,state);
+
+    return state[PX];
+}
+
+// Programs per direction: both thrust bounds, each with every burn fraction
+static size_t level_programs(int level)
+{
+    size_t angles = (level == 0) ? (size_t)FOOTPRINT_BASE_ANGLES : (size_t)FOOTPRINT_BASE_ANGLES << (level-1);
+
+    return angles*2*FOOTPRINT_BURNS;
+}
+
+struct level_task_t
+{
+    const struct lander_t *lander;
+    int level;
+    double *touchdown_x;
+};
+
+// Directions of a level are the midpoints of the previous ones
+static void fly_programs(void *context, size_t begin, size_t end, int worker)
+{
+    (void)worker;
+
+    const struct level_task_t *task = context;
+    const struct vehicle_t *vehicle = &task->lander->vehicle;
+
+    size_t angles = (size_t)FOOTPRINT_BASE_ANGLES << task->level;
+
+    for(size_t i = begin; i < end; i++)
+    {
+        size_t direction = i/(2*FOOTPRINT_BURNS);
+        size_t k = (task->level == 0) ? direction : 2*direction + 1;
+
+        double angle = 2.0*M_PI*(double)k/(double)angles;
+        double norm = ((i/FOOTPRINT_BURNS) % 2 == 0) ? vehicle->rho_1 : vehicle->rho_2;
+        double burn_fraction = FOOTPRINT_BURN_FRACTIONS[i % FOOTPRINT_BURNS];
+
+        task->touchdown_x[i] = program_touchdown(task->lander,angle,norm,burn_fraction);
+    }
+}
+
+// Refine the fan by one level and publish it
+static void fly_level(struct footprint_t *footprint)
+{
+    uint64_t start = profile_clock();
+
+    struct level_task_t task = {&footprint->lander, footprint->level, footprint->touchdown_x};
+    size_t count = level_programs(footprint->level);
+
+    parallel_for(footprint->pool,count,FOOTPRINT_CHUNK,fly_programs,&task);
+
+    struct footprint_result_t *fan = &footprint->fan;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        double x = footprint->touchdown_x[i];
+        if(isnan(x)) continue;
+
+        if(x < fan->x_min) fan->x_min = x;
+        if(x > fan->x_max) fan->x_max = x;
+        fan->valid = true;
+    }
+
+    fan->programs += count;
+    fan->level = ++footprint->level;
+    fan->solve_time = 1e-9*(double)(profile_clock() - start);
+
+    footprint->result[footprint->results.back] = *fan;
+    publish_back(&footprint->results);
+}
+
+static bool same_vehicle(const struct vehicle_t *a, const struct vehicle_t *b)
+{
+    return a->dry_mass == b->dry_mass && a->wet_mass == b->wet_mass && a->isp == b->isp &&
+        a->nb_thrusters == b->nb_thrusters && a->t_1 == b->t_1 && a->t_2 == b->t_2 &&
+        a->t_bar == b->t_bar && a->phi == b->phi;
+}
+
+// Start a new fan unless the request quantizes to the cached one with the same vehicle
+static void take_request(struct footprint_t *footprint, const struct lander_t *lander)
+{
+    long key[TRAJECTORY_DIM];
+    bool same = footprint->fan.programs > 0 && same_vehicle(&lander->vehicle,&footprint->lander.vehicle);
+
+    for(int i = 0; i < TRAJECTORY_DIM; i++)
+    {
+        key[i] = lround(lander->state[i]/FOOTPRINT_KEY_RESOLUTION[i]);
+        same = same && key[i] == footprint->key[i];
+    }
+
+    if(same) return;
+
+    for(int i = 0; i < TRAJECTORY_DIM; i++) footprint->key[i] = key[i];
+
+    footprint->lander = *lander;
+    footprint->level = 0;
+
+    struct footprint_result_t fan = {false, lander->time, INFINITY, -INFINITY, 0, 0, 0.0};
+    footprint->fan = fan;
+}
+
+static void* footprint_main(void *arg)
+{
+    struct footprint_t *footprint = arg;
+
+    while(true)
+    {
+        // Block once the fan is complete, otherwise only look for a newer request between levels
+        if(footprint->level >= FOOTPRINT_LEVELS)
+            while(sem_wait(&footprint->wake) != 0 && errno == EINTR);
+        else
+            sem_trywait(&footprint->wake);
+
+        if(atomic_load(&footprint->quit)) break;
+
+        if(acquire_front(&footprint->requests))
+            take_request(footprint,&footprint->request[footprint->requests.front].lander);
+
+        if(footprint->level < FOOTPRINT_LEVELS) fly_level(footprint);
+    }
+
+    return NULL;
+}
+
+// Start the footprint thread with a pool of threads workers, 0 to leave one processor to the game
+struct footprint_t* create_footprint(int threads)
+{
+    struct footprint_t *footprint = calloc(1,sizeof(struct footprint_t));
+    if(footprint == NULL) return NULL;
+
+    if(threads <= 0) threads = (processor_count() > 1) ? processor_count()-1 : 1;
+
+    footprint->pool = create_thread_pool(threads);
+    footprint->touchdown_x = malloc(level_programs(FOOTPRINT_LEVELS-1)*sizeof(double));
+
+    if(footprint->pool == NULL || footprint->touchdown_x == NULL || sem_init(&footprint->wake,0,0) != 0)
+    {
+        free(footprint->touchdown_x);
+        free_thread_pool(footprint->pool);
+        free(footprint);
+        return NULL;
+    }
+
+    atomic_init(&footprint->quit,false);
+    init_triple_buffer(&footprint->requests);
+    init_triple_buffer(&footprint->results);
+
+    // Nothing is refined before the first request
+    footprint->level = FOOTPRINT_LEVELS;
+
+    if(pthread_create(&footprint->thread,NULL,footprint_main,footprint) != 0)
+    {
+        sem_destroy(&footprint->wake);
+        free(footprint->touchdown_x);
+        free_thread_pool(footprint->pool);
+        free(footprint);
+        return NULL;
+    }
+
+    return footprint;
+}
+
+// Stop the footprint thread and free memory for a footprint
+struct footprint_t* free_footprint(struct footprint_t *footprint)
+{
+    if(footprint == NULL) return NULL;
+
+    atomic_store(&footprint->quit,true);
+    sem_post(&footprint->wake);
+    pthread_join(footprint->thread,NULL);
+
+    sem_destroy(&footprint->wake);
+
+    free(footprint->touchdown_x);
+    free_thread_pool(footprint->pool);
+    free(footprint);
+
+    return NULL;
+}
+
+// Compute the footprint from the lander state, nothing to do when it did not change
+void request_footprint(struct footprint_t *footprint, const struct lander_t *lander)
+{
+    struct lander_t *snapshot = &footprint->request[footprint->requests.back].lander;
+
+    snapshot->vehicle = lander->vehicle;
+    snapshot->time = lander->time;
+    for(int i = 0; i < TRAJECTORY_DIM; i++) snapshot->state[i] = lander->state[i];
+
+    publish_back(&footprint->requests);
+    sem_post(&footprint->wake);
+}
+
+// Most recent footprint, NULL before the first one
+const struct footprint_result_t* latest_footprint(struct footprint_t *footprint)
+{
+    if(acquire_front(&footprint->results)) footprint->published = true;
+
+    if(!footprint->published) return NULL;
+
+    return &footprint->result[footprint->results.front];
+}
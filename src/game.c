@@ -1,26 +1,76 @@
 #include "marslanding/game.h"
 
 #include "marslanding/dynamics.h"
+#include "marslanding/footprint.h"
+#include "marslanding/guidance.h"
+#include "marslanding/integrator.h"
+#include "marslanding/planner.h"
+#include "marslanding/profiler.h"
+#include "marslanding/recorder.h"
+#include "marslanding/render.h"
+#include "marslanding/replay.h"
+#include "marslanding/scenario.h"
 #include "marslanding/sdl_utils.h"
+#include "marslanding/suggester.h"
+#include "marslanding/telemetry.h"
 #include "marslanding/draw.h"
 
 #include <SDL2/SDL.h>
 #include <stddef.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 // Game state
 bool GAME_PAUSED = true; // Pause game if set to true
-bool GAME_OVER = false;
 bool QUIT = false; // Exit program if set to true
 
 bool PREDICT = true;
+bool AUTOPILOT = false;
+bool PROFILE = false;
+bool FOOTPRINT = false;
+bool SUGGEST = false;
+
+const double MAX_FRAME_TIME = 0.25; // in s, longer stalls are not caught up
+const int MAX_TICKS_PER_FRAME = 25;
+
+struct catch_up_t catch_up = {MAX_TICKS_PER_FRAME, false, 0, 0, 0.0, 0.0};
+const int FRAME_RATE_CAP = 120; // in Hz, 0 for uncapped, ignored with vsync
+
+double render_alpha = 1.0;
 
 double joy_thrust_x = 0.0;
 double joy_thrust_z = 0.0;
 double joy_thrust_n = 0.0;
 
+struct lander_t *lander = NULL;
+
+struct planner_t *planner = NULL;
+
+struct footprint_t *footprint = NULL;
+
+struct suggester_t *suggester = NULL;
+
+struct recorder_t *recorder = NULL;
+
+struct input_log_t *input_log = NULL;
+uint64_t sim_tick = 0;
+
+struct telemetry_t *telemetry = NULL;
+
+struct scenario_t scenario;
+struct scenario_watch_t scenario_watch = {NULL};
+
+const char *profile_path = NULL;
+
+double next_plan_time = 0.0;
+double next_footprint_time = 0.0;
+double next_suggestion_time = 0.0;
+bool autopilot_engaged = false; // last command came from a plan
+
 SDL_Event event;
 
-int init_game()
+int init_game(int argc, char** argv)
 {
     print_start_ascii();
     print_start_help();
@@ -31,15 +81,135 @@ int init_game()
         printf("Failed to initialize SDL\n");
         return -1;
     }
-    init_scene();
+
+    // Vehicle, initial state and scene from -S FILE, watched for changes
+    init_scenario(&scenario);
+    for (int i = 1; i+1 < argc; i++)
+    {
+        if (strcmp(argv[i],"-S") != 0) continue;
+
+        char error[256];
+        if (!load_scenario(argv[i+1],&scenario,error,sizeof(error)))
+        {
+            printf("Invalid scenario %s: %s\n",argv[i+1],error);
+            return -1;
+        }
+
+        watch_scenario(&scenario_watch,argv[i+1]);
+        print_scenario(&scenario);
+    }
+
+    init_scene(SCREEN_WIDTH,SCREEN_HEIGHT,&scenario);
 
     // Initial dynamical system
-    if (init_state_list() == NULL)
+    lander = create_lander(TRAJECTORY_CAPACITY);
+    if (lander == NULL)
     {
         printf("Failed to initialize lander\n");
         return -1;
     }
-    init_dynamics();    
+
+    lander->vehicle = scenario.vehicle;
+    reset_lander(lander,scenario.initial_state);
+    lander->locate_events = true;
+    lander->prediction_resolution = scene_delta_x/scene_width; // one pixel
+
+    planner = create_planner(GUIDANCE_STEPS);
+    if (planner == NULL)
+    {
+        printf("Failed to initialize guidance\n");
+        return -1;
+    }
+
+    footprint = create_footprint(0);
+    if (footprint == NULL)
+    {
+        printf("Failed to initialize footprint\n");
+        return -1;
+    }
+
+    suggester = create_suggester(0);
+    if (suggester == NULL)
+    {
+        printf("Failed to initialize suggestions\n");
+        return -1;
+    }
+
+    // Telemetry with -t FORMAT, -r RATE and -o FILE
+    enum telemetry_format_t telemetry_format;
+    const char *telemetry_path = NULL;
+    bool has_telemetry = false;
+    double telemetry_rate = TELEMETRY_DEFAULT_RATE;
+
+    // Flight log of every tick with -l FILE, input log to replay with -i FILE
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = (i+1 < argc) ? argv[i+1] : NULL;
+
+        // Fixed timestep catch-up with -b TICKS per frame, excess amortized with -a instead of dropped
+        if (strcmp(argv[i],"-b") == 0 && value != NULL) catch_up.tick_budget = atoi(value);
+
+        if (strcmp(argv[i],"-a") == 0) catch_up.amortize = true;
+
+        if (strcmp(argv[i],"-t") == 0 && value != NULL)
+        {
+            has_telemetry = find_telemetry_format(value,&telemetry_format);
+            if (!has_telemetry)
+            {
+                printf("Unknown telemetry format %s, human, csv or json\n",value);
+                return -1;
+            }
+        }
+
+        if (strcmp(argv[i],"-r") == 0 && value != NULL) telemetry_rate = atof(value);
+
+        if (strcmp(argv[i],"-o") == 0 && value != NULL) telemetry_path = value;
+
+        // Frame profile written on exit with -p FILE
+        if (strcmp(argv[i],"-p") == 0 && value != NULL) profile_path = value;
+
+        if (strcmp(argv[i],"-l") == 0 && value != NULL)
+        {
+            recorder = create_recorder(value,&lander->vehicle);
+            if (recorder == NULL)
+            {
+                printf("Failed to create flight log %s\n",value);
+                return -1;
+            }
+        }
+
+        if (strcmp(argv[i],"-i") == 0 && value != NULL)
+        {
+            input_log = create_input_log(value,lander);
+            if (input_log == NULL)
+            {
+                printf("Failed to create input log %s\n",value);
+                return -1;
+            }
+
+            // The replay starts with the default vehicle
+            if (scenario_watch.path != NULL)
+                log_scenario(input_log,sim_tick,&lander->vehicle,scenario.initial_state);
+        }
+    }
+
+    if (catch_up.tick_budget < 1)
+    {
+        printf("Catch-up budget must be at least one tick per frame\n");
+        return -1;
+    }
+
+    if (has_telemetry)
+    {
+        FILE *file = (telemetry_path != NULL) ? fopen(telemetry_path,"w") : stdout;
+
+        telemetry = create_telemetry(file,telemetry_format,telemetry_rate);
+        if (telemetry == NULL)
+        {
+            printf("Failed to start telemetry\n");
+            return -1;
+        }
+    }
 
     // Start the timer
     init_timer();
@@ -82,6 +252,11 @@ void print_start_help()
     printf("= Thrust Direction : Left Stick    =\n");
     printf("= Thrust Magnitude : Right Trigger =\n");
     printf("= Show Prediction  : Y Button      =\n");
+    printf("= Integrator       : X Button      =\n");
+    printf("= Autopilot        : B Button      =\n");
+    printf("= Profiler         : LB Button     =\n");
+    printf("= Footprint        : RB Button     =\n");
+    printf("= Suggestion       : A Button      =\n");
     printf("====================================\n");
     printf("============ TANGO DELTA ===========\n");
     printf("====================================\n");
@@ -92,21 +267,38 @@ void loop_game()
     // Main loop
     while (!QUIT)
     {
+        Uint64 frame_start = SDL_GetPerformanceCounter();
+        uint64_t frame_profile = profile_begin();
+
         // Event loop
+        uint64_t events_profile = profile_begin();
         while (SDL_PollEvent(&event))
         {
             handle_events();
         }
+        profile_end(PROFILE_EVENTS,events_profile);
+
+        update_scenario();
 
-        compute_thrust();
+        // Ticks set their own thrust in flight, the joystick previews it otherwise
+        if (GAME_PAUSED || lander->is_grounded) compute_thrust(lander,joy_thrust_x,joy_thrust_z,joy_thrust_n);
 
-        // Rendering loop
-        if(!GAME_PAUSED && !GAME_OVER)
+        // Physics loop
+        if(!GAME_PAUSED && !lander->is_grounded)
         {
-            forward();
+            uint64_t physics_profile = profile_begin();
+            advance_simulation();
+            profile_end(PROFILE_PHYSICS,physics_profile);
 
-            print_current_state();            
-        }  
+            // Final state only, the flight log holds every tick
+            if (lander->is_grounded) print_current_state(lander);
+        }
+        else
+        {
+            render_alpha = 1.0;
+        }
+
+        uint64_t draw_profile = profile_begin();
 
         render_screen();
 
@@ -114,10 +306,139 @@ void loop_game()
 
         if (GAME_PAUSED) render_pause();
 
-        SDL_RenderPresent(screen);             
+        profile_end(PROFILE_DRAW,draw_profile);
+
+        uint64_t present_profile = profile_begin();
+        SDL_RenderPresent(screen);
+        profile_end(PROFILE_PRESENT,present_profile);
+
+        profile_end(PROFILE_FRAME,frame_profile);
+        profile_frame();
+
+        cap_frame_rate(frame_start);
     }    
 }
 
+// Run the fixed physics ticks covered by the elapsed time, at most the catch-up budget.
+// Stalls longer than MAX_FRAME_TIME are clamped. The rest of a backlog over budget is either
+// dropped or kept for later frames, up to MAX_FRAME_TIME.
+void advance_simulation()
+{
+    double elapsed = update_timer();
+    if (elapsed > MAX_FRAME_TIME)
+    {
+        catch_up.clamped_stalls++;
+        catch_up.dropped_time += elapsed - MAX_FRAME_TIME;
+        elapsed = MAX_FRAME_TIME;
+    }
+
+    timer.accumulator += elapsed;
+    if (timer.accumulator > catch_up.max_backlog) catch_up.max_backlog = timer.accumulator;
+
+    int ticks = 0;
+    while (timer.accumulator >= FORWARD_TIME_STEP && ticks < catch_up.tick_budget && !lander->is_grounded)
+    {
+        command_tick();
+
+        forward_tick(lander);
+        sim_tick++;
+
+        push_telemetry(telemetry,lander,sim_tick);
+
+        record_tick(recorder,lander,joy_thrust_x,joy_thrust_z,joy_thrust_n);
+
+        timer.accumulator -= FORWARD_TIME_STEP;
+        ticks++;
+    }
+
+    if (ticks == catch_up.tick_budget && timer.accumulator >= FORWARD_TIME_STEP)
+    {
+        catch_up.capped_frames++;
+
+        // Drop the backlog instead of spiraling into ever longer frames
+        double kept = catch_up.amortize ? fmin(timer.accumulator,MAX_FRAME_TIME)
+            : fmod(timer.accumulator,FORWARD_TIME_STEP);
+
+        catch_up.dropped_time += timer.accumulator - kept;
+        timer.accumulator = kept;
+    }
+
+    render_alpha = lander->is_grounded ? 1.0 : fmin(timer.accumulator/FORWARD_TIME_STEP,1.0);
+}
+
+void print_catch_up_stats()
+{
+    if (catch_up.capped_frames == 0 && catch_up.clamped_stalls == 0) return;
+
+    printf("Catch-up : %lu frames over budget, %lu stalls clamped, %.2f s dropped, %.2f s max backlog (%s)\n",
+        catch_up.capped_frames,catch_up.clamped_stalls,catch_up.dropped_time,catch_up.max_backlog,
+        catch_up.amortize ? "amortized" : "dropped");
+}
+
+// Thrust of the next tick from the joystick or the autopilot. The command is the only input
+// of the tick, logged for replays which then do not depend on frame timing nor on the planner.
+void command_tick()
+{
+    uint64_t start = profile_begin();
+
+    double joy_x = joy_thrust_x;
+    double joy_z = joy_thrust_z;
+    double joy_n = joy_thrust_n;
+
+    if (AUTOPILOT) update_autopilot(&joy_x,&joy_z,&joy_n);
+
+    compute_thrust(lander,joy_x,joy_z,joy_n);
+
+    log_command(input_log,sim_tick,joy_x,joy_z,joy_n);
+
+    profile_end(PROFILE_COMMAND,start);
+}
+
+// Replace the joystick command by the latest plan, keeping the joystick without one.
+// Plans are requested every GUIDANCE_PERIOD and solved on the planner thread, never waited for.
+void update_autopilot(double *joy_x, double *joy_z, double *joy_n)
+{
+    if (lander->time >= next_plan_time)
+    {
+        request_plan(planner,lander);
+        next_plan_time = lander->time + GUIDANCE_PERIOD;
+    }
+
+    const struct guidance_t *plan = latest_plan(planner);
+
+    double plan_x, plan_z, plan_n;
+    bool engaged = plan != NULL && guidance_command(plan,lander,&plan_x,&plan_z,&plan_n);
+
+    if (engaged)
+    {
+        *joy_x = plan_x;
+        *joy_z = plan_z;
+        *joy_n = plan_n;
+    }
+
+    if (engaged != autopilot_engaged)
+    {
+        if (engaged) printf("Autopilot : landing in %.1f s, %.0f kg of fuel, %.1f m from objective\n",
+            plan->final_time,plan->fuel,plan->landing_error);
+        else printf("Autopilot : no feasible landing, joystick control\n");
+    }
+
+    autopilot_engaged = engaged;
+}
+
+// Sleep for the rest of the frame when the frame rate is capped
+void cap_frame_rate(Uint64 frame_start)
+{
+    if (VSYNC || FRAME_RATE_CAP <= 0) return;
+
+    double frame_time = (double)(SDL_GetPerformanceCounter()-frame_start);
+    frame_time /= (double)SDL_GetPerformanceFrequency();
+
+    double remaining = 1.0/FRAME_RATE_CAP - frame_time;
+
+    if (remaining > 0.0) SDL_Delay((Uint32)(remaining*1000.0));
+}
+
 void handle_events()
 {
     if(event.type == SDL_QUIT)
@@ -125,6 +446,17 @@ void handle_events()
         QUIT = true;
     }
 
+    // Cached static layer lost or out of size
+    if(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+    {
+        invalidate_static_layer(true);
+    }
+
+    if(event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET)
+    {
+        invalidate_static_layer(event.type == SDL_RENDER_DEVICE_RESET);
+    }
+
     handle_joy_axis();
 
     handle_joy_buttons();
@@ -133,7 +465,7 @@ void handle_events()
 void handle_joy_axis()
 {
     // joy axis disabled once grounded
-    if(is_grounded) return;
+    if(lander->is_grounded) return;
     
     if(event.type == SDL_JOYAXISMOTION)
     {
@@ -196,7 +528,7 @@ void handle_joy_buttons()
 
             if(!GAME_PAUSED)
             {
-                timer.previous_tick = SDL_GetTicks();
+                init_timer();
             }
             
         }
@@ -206,15 +538,10 @@ void handle_joy_buttons()
         {
             // printf("Reset\n");
             
-            init_state_list();
-            
-            init_timer();
-
-            init_dynamics();
+            reset_lander(lander,scenario.initial_state);
+            log_reset(input_log,sim_tick);
 
-            GAME_OVER = false;
-
-            GAME_PAUSED = true;
+            reset_game();
         }
 
         // predicted / 3 = Xbox Y
@@ -223,47 +550,179 @@ void handle_joy_buttons()
             PREDICT = !PREDICT;
         }
 
+        // autopilot / 1 = Xbox B
+        if(event.jbutton.button == 1 && event.jbutton.state == SDL_PRESSED)
+        {
+            AUTOPILOT = !AUTOPILOT;
+            next_plan_time = lander->time;
+            autopilot_engaged = false;
+
+            printf("Autopilot : %s\n",AUTOPILOT ? "on" : "off");
+            if (!AUTOPILOT) print_guidance_stats(latest_plan(planner));
+        }
+
+        // profiler overlay / 4 = Xbox LB
+        if(event.jbutton.button == 4 && event.jbutton.state == SDL_PRESSED)
+        {
+            PROFILE = !PROFILE;
+        }
+
+        // suggested command / 0 = Xbox A
+        if(event.jbutton.button == 0 && event.jbutton.state == SDL_PRESSED)
+        {
+            SUGGEST = !SUGGEST;
+            next_suggestion_time = lander->time;
+        }
+
+        // landing footprint / 5 = Xbox RB
+        if(event.jbutton.button == 5 && event.jbutton.state == SDL_PRESSED)
+        {
+            FOOTPRINT = !FOOTPRINT;
+            next_footprint_time = lander->time;
+        }
+
+        // integrator / 2 = Xbox X
+        if(event.jbutton.button == 2 && event.jbutton.state == SDL_PRESSED)
+        {
+            lander->integrator = next_integrator(lander_integrator(lander));
+            lander->adaptive_step = 0.0;
+            log_integrator(input_log,sim_tick,lander->integrator);
+
+            printf("Integrator : %s\n",lander->integrator->name);
+        }
+
         // printf("Event JoyButton {button: %i, state: %i}\n",
         //     event.jbutton.button, event.jbutton.state);
     }
 }
 
+// Back to the initial state, paused, with fresh background requests
+void reset_game()
+{
+    reset_planner(planner);
+    next_plan_time = 0.0;
+    next_footprint_time = 0.0;
+    next_suggestion_time = 0.0;
+
+    init_timer();
+
+    GAME_PAUSED = true;
+}
+
+// Apply the scenario file when it was saved, the flight restarts with the new vehicle
+void update_scenario()
+{
+    char error[256];
+
+    if (!reload_scenario(&scenario_watch,1e-9*profile_clock(),&scenario,error,sizeof(error)))
+    {
+        if (error[0] != '\0') printf("Invalid scenario %s: %s\n",scenario_watch.path,error);
+        return;
+    }
+
+    printf("Scenario reloaded\n");
+    print_scenario(&scenario);
+
+    init_scene(screen_width,screen_height,&scenario);
+    invalidate_static_layer(false);
+
+    lander->vehicle = scenario.vehicle;
+    lander->prediction_resolution = scene_delta_x/scene_width;
+    reset_lander(lander,scenario.initial_state);
+    log_scenario(input_log,sim_tick,&lander->vehicle,scenario.initial_state);
+
+    reset_game();
+}
+
 void render_screen()
 {
-    // Clear screen with white
-    SDL_SetRenderDrawColor(screen, 0xFF, 0xFF, 0xFF, 0xFF);
-    SDL_RenderClear(screen);
+    view.lander = lander;
+    view.render_alpha = render_alpha;
+    view.predict = PREDICT;
+    view.autopilot = AUTOPILOT;
+    view.plan = latest_plan(planner);
+    view.profile = PROFILE;
+    view.footprint = FOOTPRINT ? update_footprint() : NULL;
+    view.suggestion = SUGGEST ? update_suggestion() : NULL;
+
+    // Static layer covers the whole window, no clear needed
+    draw_static_layer();
 
     // Update screen
     // SDL_SetRenderDrawBlendMode(screen, SDL_BLENDMODE_BLEND);
     // SDL_RenderPresent(screen);
 
     // Free too old states
-    // shorten_state_list(state_list,timer.current_tick/1000.0-PERSISTENCE_DURATION);
+    // evict_states_before(lander->history,timer.current_tick/1000.0-PERSISTENCE_DURATION);
+}
+
+// Request the footprint every FOOTPRINT_PERIOD of simulated time, refined on its own thread meanwhile
+const struct footprint_result_t* update_footprint()
+{
+    if (lander->time >= next_footprint_time)
+    {
+        request_footprint(footprint,lander);
+        next_footprint_time = lander->time + FOOTPRINT_PERIOD;
+    }
+
+    return latest_footprint(footprint);
+}
+
+// Request a suggested command every SUGGEST_PERIOD of simulated time, searched within a frame
+const struct suggestion_t* update_suggestion()
+{
+    if (lander->time >= next_suggestion_time && !lander->is_grounded)
+    {
+        request_suggestion(suggester,lander);
+        next_suggestion_time = lander->time + SUGGEST_PERIOD;
+    }
+
+    return latest_suggestion(suggester);
 }
 
 void render_pause()
 {
-    SDL_SetRenderDrawColor(screen, 0x00, 0x00, 0x00, 0xAF);
+    render_color(0x00, 0x00, 0x00, 0xAF);
     
     int width = 30;
     int height = 100;
     int space = 20;
 
-    SDL_Rect rect;
+    struct render_rect_t rect;
     rect.w = width;
     rect.h = height;
     rect.x = SCREEN_WIDTH/2 + space/2;
     rect.y = SCREEN_HEIGHT/2 - height/2;
             
-    SDL_RenderFillRect(screen, &rect);
+    render_fill_rect(&rect);
 
     rect.x = rect.x - space - width;
 
-    SDL_RenderFillRect(screen, &rect);
+    render_fill_rect(&rect);
 }
 
 void quit_game()
 {    
+    lander = free_lander(lander);
+
+    print_guidance_stats(latest_plan(planner));
+    planner = free_planner(planner);
+    footprint = free_footprint(footprint);
+    suggester = free_suggester(suggester);
+
+    recorder = close_recorder(recorder);
+    input_log = close_input_log(input_log,sim_tick);
+
+    if (profile_path != NULL && !write_profile(profile_path))
+        printf("Failed to write frame profile %s\n",profile_path);
+
+    print_catch_up_stats();
+
+    print_telemetry_stats(telemetry);
+    FILE *telemetry_file = (telemetry != NULL) ? telemetry->file : NULL;
+    telemetry = free_telemetry(telemetry);
+    if (telemetry_file != NULL && telemetry_file != stdout) fclose(telemetry_file);
+
+    quit_scene();
     quit_sdl();
 }
\ No newline at end of file
@@ -0,0 +1,426 @@
+#include "marslanding/guidance.h"
+
+#include "marslanding/dynamics.h"
+#include "marslanding/profiler.h"
+#include "marslanding/socp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+const size_t GUIDANCE_STEPS = 20;
+const double GUIDANCE_PERIOD = 0.1; // in s between plans, 10 Hz
+const double LANDING_ERROR_WEIGHT = 1.0; // in m/s of delta-v per m of landing error
+const double GUIDANCE_FUEL_RESERVE = 10.0; // in kg, covers the plan discretization
+const double GLIDE_SLOPE = 10.0; // in deg above the horizontal, seen from the landing point
+const double GUIDANCE_TIME_BUDGET = 0.075; // in s of wall time per plan, within GUIDANCE_PERIOD
+const int GUIDANCE_SOLVE_ITERATIONS = 35; // interior point iterations per final time, most converge in 30
+
+const double GUIDANCE_MIN_TIME = 2.0; // in s
+const double GUIDANCE_MAX_TIME = 150.0; // in s
+const int GUIDANCE_SCAN_POINTS = 6; // final times tried without a previous plan
+const int GUIDANCE_GOLDEN_ITERATIONS = 6;
+const int GUIDANCE_REFINE_ITERATIONS = 3; // around the previous final time
+const double GUIDANCE_REFINE_WINDOW = 0.1; // relative to the previous final time
+
+// Allocate a plan without a problem, to hold copies of planned descents
+struct guidance_t* create_plan(size_t steps)
+{
+    if (steps < 2) return NULL;
+
+    struct guidance_t *guidance = calloc(1,sizeof(struct guidance_t));
+    if (guidance == NULL) return NULL;
+
+    guidance->steps = steps;
+    guidance->acceleration_x = calloc(3*steps,sizeof(double));
+
+    if (guidance->acceleration_x == NULL) return free_guidance(guidance);
+
+    guidance->acceleration_z = guidance->acceleration_x + steps;
+    guidance->sigma = guidance->acceleration_x + 2*steps;
+
+    return guidance;
+}
+
+// Allocate a planner with a number of command intervals
+struct guidance_t* create_guidance(size_t steps)
+{
+    struct guidance_t *guidance = create_plan(steps);
+    if (guidance == NULL) return NULL;
+
+    // u_x, u_z, sigma per interval then the landing error bound
+    size_t variables = 3*steps + 1;
+
+    // Thrust bounds, fuel, glide slope and landing error rows
+    size_t linear = 2*steps + 1 + 2*(steps-1) + 2;
+
+    size_t *cone_dims = malloc(steps*sizeof(size_t));
+    if (cone_dims == NULL) return free_guidance(guidance);
+
+    for (size_t k = 0; k < steps; k++) cone_dims[k] = 3;
+
+    guidance->problem = create_socp(variables,3,linear,steps,cone_dims);
+    free(cone_dims);
+
+    if (guidance->problem == NULL) return free_guidance(guidance);
+
+    guidance->problem->max_iterations = GUIDANCE_SOLVE_ITERATIONS;
+
+    return guidance;
+}
+
+// Free memory for a planner
+struct guidance_t* free_guidance(struct guidance_t *guidance)
+{
+    if (guidance == NULL) return NULL;
+
+    free_socp(guidance->problem);
+    free(guidance->acceleration_x);
+    free(guidance);
+
+    return NULL;
+}
+
+// Copy the plan and statistics of a planner, both with the same number of steps
+void copy_plan(struct guidance_t *to, const struct guidance_t *from)
+{
+    to->valid = from->valid;
+    to->start_time = from->start_time;
+    to->final_time = from->final_time;
+    to->landing_error = from->landing_error;
+    to->fuel = from->fuel;
+    to->stats = from->stats;
+
+    for (size_t k = 0; k < 3*from->steps; k++) to->acceleration_x[k] = from->acceleration_x[k];
+}
+
+// Condensed problem for a final time, states are eliminated with the zero order hold dynamics
+//   v_N = v_0 + t_f g + dt sum(u_k)
+//   r_N = r_0 + t_f v_0 + t_f^2 g/2 + dt^2 sum((N-k-1/2) u_k)
+//   z_k = z_0 - alpha dt sum(sigma_j, j < k)
+static void build_problem(struct guidance_t *guidance, const struct lander_t *lander, double final_time)
+{
+    struct socp_t *problem = guidance->problem;
+    const struct vehicle_t *vehicle = &lander->vehicle;
+    const double *state = lander->state;
+
+    size_t N = guidance->steps, n = problem->n;
+    size_t UX = 0, UZ = N, SIGMA = 2*N, ERROR = 3*N;
+
+    double dt = final_time/N;
+    double g = MARS_GRAVITY;
+    double alpha = vehicle->alpha;
+    double z0 = log(state[M]);
+
+    double *A = problem->A, *b = problem->b;
+    double *G = problem->G, *h = problem->h;
+
+    clear_socp(problem);
+
+    // Delta-v, proportional to fuel, plus the weighted landing error
+    for (size_t k = 0; k < N; k++) problem->c[SIGMA+k] = dt;
+    problem->c[ERROR] = LANDING_ERROR_WEIGHT;
+
+    // Touchdown at rest on the ground
+    for (size_t k = 0; k < N; k++)
+    {
+        double lever = dt*dt*(N-k-0.5);
+
+        A[0*n+UX+k] = dt;
+        A[1*n+UZ+k] = dt;
+        A[2*n+UZ+k] = lever;
+    }
+
+    b[0] = -state[VX];
+    b[1] = -state[VZ] + g*final_time;
+    b[2] = -(state[PZ] + final_time*state[VZ] - 0.5*g*final_time*final_time);
+
+    size_t row = 0;
+
+    // rho_1 e^-z <= sigma <= rho_2 e^-z, linearized around the maximum thrust mass profile
+    for (size_t k = 0; k < N; k++)
+    {
+        double reference = log(fmax(state[M] - alpha*vehicle->rho_2*k*dt,vehicle->dry_mass));
+        double mu_1 = vehicle->rho_1*exp(-reference);
+        double mu_2 = vehicle->rho_2*exp(-reference);
+
+        G[row*n+SIGMA+k] = 1.0;
+        for (size_t j = 0; j < k; j++) G[row*n+SIGMA+j] = -mu_2*alpha*dt;
+        h[row++] = mu_2*(1.0 + reference - z0);
+
+        G[row*n+SIGMA+k] = -1.0;
+        for (size_t j = 0; j < k; j++) G[row*n+SIGMA+j] = mu_1*alpha*dt;
+        h[row++] = -mu_1*(1.0 + reference - z0);
+    }
+
+    // Reserve left at touchdown
+    for (size_t j = 0; j < N; j++) G[row*n+SIGMA+j] = alpha*dt;
+    h[row++] = z0 - log(vehicle->dry_mass + GUIDANCE_FUEL_RESERVE);
+
+    // Glide slope cone above the landing point at every interval boundary,
+    // tan(gs)|x_j - x_N| <= z_j with x_j - x_N linear in the commands
+    double slope = tan(GLIDE_SLOPE*M_PI/180.0);
+
+    for (size_t j = 1; j < N; j++)
+    {
+        double time = j*dt;
+        double height = state[PZ] + time*state[VZ] - 0.5*g*time*time;
+        double offset = slope*(time-final_time)*state[VX];
+
+        for (size_t k = 0; k < N; k++)
+        {
+            double lever = (k < j) ? dt*dt*(j-k-0.5) : 0.0;
+            double relative = slope*(lever - dt*dt*(N-k-0.5));
+
+            G[row*n+UX+k] = relative;
+            G[(row+1)*n+UX+k] = -relative;
+            G[row*n+UZ+k] = -lever;
+            G[(row+1)*n+UZ+k] = -lever;
+        }
+
+        h[row] = height - offset;
+        h[row+1] = height + offset;
+        row += 2;
+    }
+
+    // |x_N| <= error, the objective is at x = 0
+    double drift = state[PX] + final_time*state[VX];
+
+    for (size_t k = 0; k < N; k++)
+    {
+        double lever = dt*dt*(N-k-0.5);
+
+        G[row*n+UX+k] = lever;
+        G[(row+1)*n+UX+k] = -lever;
+    }
+
+    G[row*n+ERROR] = -1.0;
+    G[(row+1)*n+ERROR] = -1.0;
+    h[row] = -drift;
+    h[row+1] = drift;
+    row += 2;
+
+    // |u_k| <= sigma_k
+    for (size_t k = 0; k < N; k++)
+    {
+        G[row*n+SIGMA+k] = -1.0;
+        G[(row+1)*n+UX+k] = -1.0;
+        G[(row+2)*n+UZ+k] = -1.0;
+        row += 3;
+    }
+}
+
+// Cost of the optimal descent of a given duration, INFINITY when infeasible, keeps the best plan
+static double solve_final_time(struct guidance_t *guidance, const struct lander_t *lander,
+    double final_time, double *best_cost)
+{
+    struct socp_t *problem = guidance->problem;
+
+    // Out of time, the rest of the search is skipped
+    if (socp_clock() >= problem->deadline) return INFINITY;
+
+    build_problem(guidance,lander,final_time);
+
+    enum socp_status_t status = solve_socp(problem);
+
+    guidance->stats.solves++;
+    guidance->stats.iterations += problem->iterations;
+
+    if (status != SOCP_OPTIMAL) return INFINITY;
+
+    double cost = 0.0;
+    for (size_t i = 0; i < problem->n; i++) cost += problem->c[i]*problem->x[i];
+
+    if (cost >= *best_cost) return cost;
+
+    *best_cost = cost;
+
+    size_t N = guidance->steps;
+    double dt = final_time/N;
+    double burnt = 0.0;
+
+    for (size_t k = 0; k < N; k++)
+    {
+        guidance->acceleration_x[k] = problem->x[k];
+        guidance->acceleration_z[k] = problem->x[N+k];
+        guidance->sigma[k] = problem->x[2*N+k];
+        burnt += lander->vehicle.alpha*dt*guidance->sigma[k];
+    }
+
+    guidance->valid = true;
+    guidance->start_time = lander->time;
+    guidance->final_time = final_time;
+    guidance->landing_error = problem->x[3*N];
+    guidance->fuel = lander->state[M]*(1.0 - exp(-burnt));
+
+    return cost;
+}
+
+// Golden section search of the final time over [a,b], true when a feasible plan was found
+static bool golden_search(struct guidance_t *guidance, const struct lander_t *lander,
+    double a, double b, int iterations, double *best_cost)
+{
+    const double ratio = 0.5*(sqrt(5.0)-1.0);
+
+    double c = b - ratio*(b-a), d = a + ratio*(b-a);
+    double fc = solve_final_time(guidance,lander,c,best_cost);
+    double fd = solve_final_time(guidance,lander,d,best_cost);
+
+    for (int i = 0; i < iterations; i++)
+    {
+        // Ties, including two infeasible descents, move towards longer descents
+        if (fc < fd)
+        {
+            b = d;
+            d = c;
+            fd = fc;
+            c = b - ratio*(b-a);
+            fc = solve_final_time(guidance,lander,c,best_cost);
+        }
+        else
+        {
+            a = c;
+            c = d;
+            fc = fd;
+            d = a + ratio*(b-a);
+            fd = solve_final_time(guidance,lander,d,best_cost);
+        }
+    }
+
+    return *best_cost < INFINITY;
+}
+
+// Plan a descent from the lander state, searching the final time around the previous plan.
+// Returns false when no soft landing is feasible, the previous plan is then kept until it ends.
+bool plan_descent(struct guidance_t *guidance, const struct lander_t *lander)
+{
+    double start = socp_clock();
+    guidance->problem->deadline = start + GUIDANCE_TIME_BUDGET;
+
+    const struct vehicle_t *vehicle = &lander->vehicle;
+    const double *state = lander->state;
+
+    bool was_valid = guidance->valid;
+    double previous = was_valid ? guidance->start_time + guidance->final_time - lander->time : 0.0;
+    guidance->valid = false;
+
+    double best_cost = INFINITY;
+
+    // Minimum thrust burns all the fuel after this time
+    double fuel = state[M] - vehicle->dry_mass - GUIDANCE_FUEL_RESERVE;
+    double longest = fmin(GUIDANCE_MAX_TIME,fuel/(vehicle->alpha*vehicle->rho_1));
+
+    if (!lander->is_grounded && state[PZ] > 0.0 && longest > GUIDANCE_MIN_TIME)
+    {
+        if (previous > GUIDANCE_MIN_TIME && previous < longest)
+        {
+            double window = fmax(GUIDANCE_REFINE_WINDOW*previous,1.0);
+
+            golden_search(guidance,lander,fmax(GUIDANCE_MIN_TIME,previous-window),
+                fmin(longest,previous+window),GUIDANCE_REFINE_ITERATIONS,&best_cost);
+        }
+
+        if (best_cost == INFINITY)
+        {
+            // Coarse scan, then refine around the best final time
+            double spacing = (longest-GUIDANCE_MIN_TIME)/(GUIDANCE_SCAN_POINTS-1);
+            double best_time = 0.0, best_scan = INFINITY;
+
+            for (int i = 0; i < GUIDANCE_SCAN_POINTS; i++)
+            {
+                double final_time = GUIDANCE_MIN_TIME + i*spacing;
+                double cost = solve_final_time(guidance,lander,final_time,&best_cost);
+
+                if (cost < best_scan)
+                {
+                    best_scan = cost;
+                    best_time = final_time;
+                }
+            }
+
+            if (best_scan < INFINITY)
+            {
+                golden_search(guidance,lander,fmax(GUIDANCE_MIN_TIME,best_time-spacing),
+                    fmin(longest,best_time+spacing),GUIDANCE_GOLDEN_ITERATIONS,&best_cost);
+            }
+        }
+    }
+
+    struct guidance_stats_t *stats = &guidance->stats;
+
+    stats->plans++;
+
+    bool found = guidance->valid;
+
+    // Keep flying the previous plan, it is left untouched when no final time is feasible
+    if (!found)
+    {
+        stats->failures++;
+        guidance->valid = was_valid;
+    }
+
+    double end = socp_clock();
+    if (end >= guidance->problem->deadline) stats->late++;
+
+    stats->last_time = end - start;
+    stats->total_time += stats->last_time;
+    stats->max_time = fmax(stats->max_time,stats->last_time);
+    add_duration(&stats->times,(uint64_t)(1e9*stats->last_time));
+
+    return found;
+}
+
+// Joystick command following the plan at the lander time, false when no plan covers it
+bool guidance_command(const struct guidance_t *guidance, const struct lander_t *lander,
+    double *joy_x, double *joy_z, double *joy_n)
+{
+    if (!guidance->valid) return false;
+
+    double elapsed = lander->time - guidance->start_time;
+    if (elapsed < 0.0 || elapsed >= guidance->final_time) return false;
+
+    size_t k = (size_t)(elapsed/guidance->final_time*guidance->steps);
+    if (k >= guidance->steps) k = guidance->steps-1;
+
+    double ax = guidance->acceleration_x[k];
+    double az = guidance->acceleration_z[k];
+    double magnitude = sqrt(ax*ax + az*az);
+
+    if (magnitude == 0.0) return false;
+
+    const struct vehicle_t *vehicle = &lander->vehicle;
+    double thrust = magnitude*lander->state[M];
+
+    *joy_x = ax/magnitude;
+    *joy_z = az/magnitude;
+    *joy_n = (thrust - vehicle->rho_1)/(vehicle->rho_2 - vehicle->rho_1);
+
+    if (*joy_n < 0.0) *joy_n = 0.0;
+    if (*joy_n > 1.0) *joy_n = 1.0;
+
+    return true;
+}
+
+// 99th percentile of the plan times, in s
+double guidance_p99(const struct guidance_t *guidance)
+{
+    struct profile_summary_t summary;
+    summarize_histogram(&guidance->stats.times,&summary);
+
+    return summary.p99;
+}
+
+void print_guidance_stats(const struct guidance_t *guidance)
+{
+    if (guidance == NULL) return;
+
+    const struct guidance_stats_t *stats = &guidance->stats;
+
+    if (stats->plans == 0) return;
+
+    printf("Guidance : %zu plans (%zu infeasible, %zu over budget), %zu solves, %.1f iterations per solve\n",
+        stats->plans,stats->failures,stats->late,stats->solves,
+        stats->solves > 0 ? (double)stats->iterations/stats->solves : 0.0);
+    printf("  plan time last = %.2f ms, mean = %.2f ms, p99 = %.2f ms, max = %.2f ms\n",
+        1e3*stats->last_time,1e3*stats->total_time/stats->plans,1e3*guidance_p99(guidance),1e3*stats->max_time);
+}
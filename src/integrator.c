@@ -0,0 +1,315 @@
+#include "marslanding/integrator.h"
+
+#include "marslanding/dynamics.h"
+#include "marslanding/propagator.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+const double INTEGRATOR_ABSOLUTE_TOLERANCE = 1e-6;
+const double INTEGRATOR_RELATIVE_TOLERANCE = 1e-9;
+const double EVENT_TOLERANCE = 1e-9; // in m or kg
+
+const int EVENT_MAX_ITERATIONS = 60;
+const double MIN_ADAPTIVE_STEP = 1e-6; // in s
+
+static bool euler_step(const struct lander_t *lander, const double *state, double step,
+    double *new_state, double *error)
+{
+    if (error != NULL) *error = 0.0;
+
+    return euler(lander,state,step,new_state);
+}
+
+static bool rk4_step(const struct lander_t *lander, const double *state, double step,
+    double *new_state, double *error)
+{
+    if (error != NULL) *error = 0.0;
+
+    return rk4(lander,state,step,new_state);
+}
+
+const struct integrator_t EULER_INTEGRATOR = {"euler", false, 0.01, euler_step};
+const struct integrator_t RK4_INTEGRATOR = {"rk4", false, 0.05, rk4_step};
+const struct integrator_t RK45_INTEGRATOR = {"rk45", true, 0.05, dormand_prince};
+const struct integrator_t ANALYTIC_INTEGRATOR = {"analytic", false, 0.05, arc_step};
+
+const struct integrator_t *INTEGRATORS[] = {&EULER_INTEGRATOR, &RK4_INTEGRATOR, &RK45_INTEGRATOR,
+    &ANALYTIC_INTEGRATOR, NULL};
+
+// Integrator by name, NULL if unknown
+const struct integrator_t* find_integrator(const char *name)
+{
+    for (int i = 0; INTEGRATORS[i] != NULL; i++)
+    {
+        if (strcmp(INTEGRATORS[i]->name,name) == 0) return INTEGRATORS[i];
+    }
+
+    return NULL;
+}
+
+// Next integrator in INTEGRATORS, wrapping around
+const struct integrator_t* next_integrator(const struct integrator_t *integrator)
+{
+    for (int i = 0; INTEGRATORS[i] != NULL; i++)
+    {
+        if (INTEGRATORS[i] != integrator) continue;
+
+        return (INTEGRATORS[i+1] != NULL) ? INTEGRATORS[i+1] : INTEGRATORS[0];
+    }
+
+    return INTEGRATORS[0];
+}
+
+// Integrator of a lander, explicit Euler by default
+const struct integrator_t* lander_integrator(const struct lander_t *lander)
+{
+    return (lander->integrator != NULL) ? lander->integrator : &EULER_INTEGRATOR;
+}
+
+// new = state + step*sum(b[j]*k[j])
+static void combine(const double *state, double step, int stages, const double *b,
+    double k[][TRAJECTORY_DIM], double *new_state)
+{
+    for (int i = 0; i < STATE_DIM; i++)
+    {
+        double sum = 0.0;
+        for (int j = 0; j < stages; j++) sum += b[j]*k[j][i];
+
+        new_state[i] = state[i] + step*sum;
+    }
+}
+
+// Classic fourth order Runge-Kutta step
+bool rk4(const struct lander_t *lander, const double *state, double step, double *new_state)
+{
+    double k[4][TRAJECTORY_DIM];
+    double stage[TRAJECTORY_DIM];
+
+    if (!system_dynamics(lander,state,k[0])) return false;
+
+    for (int i = 0; i < STATE_DIM; i++) stage[i] = state[i] + 0.5*step*k[0][i];
+    if (!system_dynamics(lander,stage,k[1])) return false;
+
+    for (int i = 0; i < STATE_DIM; i++) stage[i] = state[i] + 0.5*step*k[1][i];
+    if (!system_dynamics(lander,stage,k[2])) return false;
+
+    for (int i = 0; i < STATE_DIM; i++) stage[i] = state[i] + step*k[2][i];
+    if (!system_dynamics(lander,stage,k[3])) return false;
+
+    const double b[4] = {1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0};
+    combine(state,step,4,b,k,new_state);
+
+    return true;
+}
+
+// Dormand-Prince 5(4) step with embedded error estimate
+bool dormand_prince(const struct lander_t *lander, const double *state, double step,
+    double *new_state, double *error)
+{
+    static const double a[6][6] = {
+        {1.0/5.0},
+        {3.0/40.0, 9.0/40.0},
+        {44.0/45.0, -56.0/15.0, 32.0/9.0},
+        {19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0},
+        {9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0},
+        {35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0}
+    };
+
+    // Difference between the fifth and fourth order weights
+    static const double e[7] = {71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0,
+        -17253.0/339200.0, 22.0/525.0, -1.0/40.0};
+
+    double k[7][TRAJECTORY_DIM];
+    double stage[TRAJECTORY_DIM];
+
+    if (!system_dynamics(lander,state,k[0])) return false;
+
+    for (int s = 1; s < 7; s++)
+    {
+        combine(state,step,s,a[s-1],k,stage);
+        if (!system_dynamics(lander,stage,k[s])) return false;
+    }
+
+    // Last stage is evaluated at the fifth order solution
+    for (int i = 0; i < STATE_DIM; i++) new_state[i] = stage[i];
+
+    if (error == NULL) return true;
+
+    // Largest component error relative to the tolerance
+    *error = 0.0;
+    for (int i = 0; i < STATE_DIM; i++)
+    {
+        double sum = 0.0;
+        for (int j = 0; j < 7; j++) sum += e[j]*k[j][i];
+
+        double scale = INTEGRATOR_ABSOLUTE_TOLERANCE
+            + INTEGRATOR_RELATIVE_TOLERANCE*fmax(fabs(state[i]),fabs(new_state[i]));
+
+        *error = fmax(*error,fabs(step*sum)/scale);
+    }
+
+    return true;
+}
+
+// Event function, positive before the event
+static double event_value(const struct lander_t *lander, const double *state, int event)
+{
+    if (event == EVENT_TOUCHDOWN) return state[PZ];
+
+    return state[M] - lander->vehicle.dry_mass;
+}
+
+// Time within (0,step] at which an event function crosses zero, Illinois method
+static double event_time(const struct lander_t *lander, const struct integrator_t *integrator,
+    const double *state, double step, int event, double end_value)
+{
+    double a = 0.0, value_a = event_value(lander,state,event);
+    double b = step, value_b = end_value;
+    double c = b;
+    int side = 0;
+
+    for (int i = 0; i < EVENT_MAX_ITERATIONS; i++)
+    {
+        c = (a*value_b - b*value_a)/(value_b - value_a);
+
+        double crossed[TRAJECTORY_DIM];
+        integrator->step(lander,state,c,crossed,NULL);
+
+        double value_c = event_value(lander,crossed,event);
+
+        if (fabs(value_c) < EVENT_TOLERANCE) break;
+
+        if (value_c > 0.0)
+        {
+            a = c;
+            value_a = value_c;
+            if (side == 1) value_b /= 2.0;
+            side = 1;
+        }
+        else
+        {
+            b = c;
+            value_b = value_c;
+            if (side == -1) value_a /= 2.0;
+            side = -1;
+        }
+
+        if (b - a < 1e-12*step) break;
+    }
+
+    return c;
+}
+
+// Shorten a step to its first event, new_state is replaced by the state at the event
+static double locate_events(const struct lander_t *lander, const struct integrator_t *integrator,
+    const double *state, double step, double *new_state, int *events)
+{
+    const int candidates[2] = {EVENT_TOUCHDOWN, EVENT_DRY};
+
+    double first = step;
+    int located = EVENT_NONE;
+
+    for (int i = 0; i < 2; i++)
+    {
+        int event = candidates[i];
+
+        double before = event_value(lander,state,event);
+        double after = event_value(lander,new_state,event);
+
+        if (!(before > 0.0 && after <= 0.0)) continue;
+
+        double time = event_time(lander,integrator,state,step,event,after);
+
+        if (time < first - 1e-12*step) located = event;
+        else if (time <= first + 1e-12*step) located |= event;
+        else continue;
+
+        first = fmin(first,time);
+    }
+
+    if (located == EVENT_NONE) return step;
+
+    integrator->step(lander,state,first,new_state,NULL);
+
+    // Remove the residual of the root finding
+    if (located & EVENT_TOUCHDOWN) new_state[PZ] = 0.0;
+    if (located & EVENT_DRY) new_state[M] = lander->vehicle.dry_mass;
+
+    *events |= located;
+
+    return first;
+}
+
+// Integrate a state in place for a duration with the lander integrator, stopping at touchdown
+// when events are located. adaptive_step carries the step size between calls (may be NULL),
+// events receives the located events. Returns the time advanced, negative on failure.
+double integrate(const struct lander_t *lander, double *state, double duration,
+    double *adaptive_step, int *events)
+{
+    const struct integrator_t *integrator = lander_integrator(lander);
+
+    int located = EVENT_NONE;
+    double advanced = 0.0;
+    double next_step = duration;
+
+    if (integrator->adaptive && adaptive_step != NULL && *adaptive_step > 0.0)
+        next_step = *adaptive_step;
+
+    bool done = (duration <= 0.0);
+
+    while (!done)
+    {
+        double remaining = duration - advanced;
+        double step = remaining;
+
+        if (integrator->adaptive && next_step < remaining) step = next_step;
+
+        double new_state[TRAJECTORY_DIM];
+        double error = 0.0;
+
+        if (!integrator->step(lander,state,step,new_state,&error)) return -1.0;
+
+        if (integrator->adaptive)
+        {
+            double factor = (error > 0.0) ? 0.9*pow(error,-0.2) : 5.0;
+            factor = fmin(5.0,fmax(0.2,factor));
+
+            // Reject and retry with a smaller step
+            if (error > 1.0 && step > MIN_ADAPTIVE_STEP)
+            {
+                next_step = fmax(step*factor,MIN_ADAPTIVE_STEP);
+                continue;
+            }
+
+            // Keep the controller step when the remaining time cut this one short
+            if (!(step < next_step && step == remaining)) next_step = step*factor;
+        }
+
+        int stepped = EVENT_NONE;
+        if (lander->locate_events)
+            step = locate_events(lander,integrator,state,step,new_state,&stepped);
+
+        for (int i = 0; i < STATE_DIM; i++) state[i] = new_state[i];
+
+        located |= stepped;
+
+        if (step == remaining)
+        {
+            advanced = duration;
+            done = true;
+        }
+        else
+        {
+            advanced += step;
+        }
+
+        if (stepped & EVENT_TOUCHDOWN) done = true;
+    }
+
+    if (adaptive_step != NULL && integrator->adaptive) *adaptive_step = next_step;
+    if (events != NULL) *events = located;
+
+    return advanced;
+}
@@ -2,7 +2,7 @@
 
 int main(int argc, char** argv)
 {
-    if (init_game()) return -1;
+    if (init_game(argc,argv)) return -1;
 
     loop_game();
 
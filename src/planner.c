@@ -0,0 +1,177 @@
+#include "marslanding/planner.h"
+
+#include "marslanding/dynamics.h"
+#include "marslanding/guidance.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+const unsigned int TRIPLE_BUFFER_FRESH = 4;
+
+void init_triple_buffer(struct triple_buffer_t *buffer)
+{
+    buffer->back = 0;
+    atomic_init(&buffer->middle,1);
+    buffer->front = 2;
+}
+
+// Publish the back slot, the writer then fills the returned one
+unsigned int publish_back(struct triple_buffer_t *buffer)
+{
+    unsigned int previous = atomic_exchange_explicit(&buffer->middle,
+        buffer->back | TRIPLE_BUFFER_FRESH,memory_order_acq_rel);
+
+    buffer->back = previous & ~TRIPLE_BUFFER_FRESH;
+
+    return buffer->back;
+}
+
+// Take the latest published slot as front, false when nothing new was published
+bool acquire_front(struct triple_buffer_t *buffer)
+{
+    if(!(atomic_load_explicit(&buffer->middle,memory_order_acquire) & TRIPLE_BUFFER_FRESH)) return false;
+
+    unsigned int previous = atomic_exchange_explicit(&buffer->middle,buffer->front,memory_order_acq_rel);
+
+    buffer->front = previous & ~TRIPLE_BUFFER_FRESH;
+
+    return true;
+}
+
+static void* planner_main(void *arg)
+{
+    struct planner_t *planner = arg;
+    struct guidance_t *guidance = planner->guidance;
+
+    unsigned long epoch = 0;
+
+    while(true)
+    {
+        while(sem_wait(&planner->wake) != 0 && errno == EINTR);
+
+        if(atomic_load(&planner->quit)) break;
+
+        // Several requests may have been posted during the last solve, only the latest is planned
+        if(!acquire_front(&planner->requests)) continue;
+
+        const struct planner_request_t *request = &planner->request[planner->requests.front];
+
+        // The previous plan does not warm start a descent after a reset
+        if(request->epoch != epoch)
+        {
+            guidance->valid = false;
+            epoch = request->epoch;
+        }
+
+        plan_descent(guidance,&request->lander);
+
+        unsigned int slot = planner->plans.back;
+
+        copy_plan(planner->plan[slot],guidance);
+        planner->plan_epoch[slot] = epoch;
+
+        publish_back(&planner->plans);
+    }
+
+    return NULL;
+}
+
+// Start the planning thread for plans with a number of command intervals
+struct planner_t* create_planner(size_t steps)
+{
+    struct planner_t *planner = calloc(1,sizeof(struct planner_t));
+    if(planner == NULL) return NULL;
+
+    planner->guidance = create_guidance(steps);
+    bool allocated = planner->guidance != NULL;
+
+    for(int i = 0; i < 3; i++)
+    {
+        planner->plan[i] = create_plan(steps);
+        allocated = allocated && planner->plan[i] != NULL;
+    }
+
+    if(!allocated || sem_init(&planner->wake,0,0) != 0)
+    {
+        for(int i = 0; i < 3; i++) free_guidance(planner->plan[i]);
+        free_guidance(planner->guidance);
+        free(planner);
+        return NULL;
+    }
+
+    atomic_init(&planner->quit,false);
+    atomic_init(&planner->epoch,0);
+    init_triple_buffer(&planner->requests);
+    init_triple_buffer(&planner->plans);
+
+    if(pthread_create(&planner->thread,NULL,planner_main,planner) != 0)
+    {
+        sem_destroy(&planner->wake);
+        for(int i = 0; i < 3; i++) free_guidance(planner->plan[i]);
+        free_guidance(planner->guidance);
+        free(planner);
+        return NULL;
+    }
+
+    return planner;
+}
+
+// Stop the planning thread and free memory for a planner
+struct planner_t* free_planner(struct planner_t *planner)
+{
+    if(planner == NULL) return NULL;
+
+    atomic_store(&planner->quit,true);
+    sem_post(&planner->wake);
+    pthread_join(planner->thread,NULL);
+
+    sem_destroy(&planner->wake);
+
+    for(int i = 0; i < 3; i++) free_guidance(planner->plan[i]);
+    free_guidance(planner->guidance);
+    free(planner);
+
+    return NULL;
+}
+
+// Queue a plan from the lander state, replacing any request not started yet
+void request_plan(struct planner_t *planner, const struct lander_t *lander)
+{
+    struct planner_request_t *request = &planner->request[planner->requests.back];
+    struct lander_t *snapshot = &request->lander;
+
+    snapshot->vehicle = lander->vehicle;
+    snapshot->time = lander->time;
+    for(int i = 0; i < TRAJECTORY_DIM; i++) snapshot->state[i] = lander->state[i];
+    snapshot->thrust = lander->thrust;
+    snapshot->is_dry = lander->is_dry;
+    snapshot->is_grounded = lander->is_grounded;
+
+    request->epoch = atomic_load(&planner->epoch);
+
+    publish_back(&planner->requests);
+    sem_post(&planner->wake);
+}
+
+// Drop the plans of states before a reset
+void reset_planner(struct planner_t *planner)
+{
+    atomic_fetch_add(&planner->epoch,1);
+
+    planner->plan[planner->plans.front]->valid = false;
+}
+
+// Most recent plan, NULL before the first one, invalid when it predates a reset
+const struct guidance_t* latest_plan(struct planner_t *planner)
+{
+    if(acquire_front(&planner->plans)) planner->published = true;
+
+    if(!planner->published) return NULL;
+
+    unsigned int slot = planner->plans.front;
+
+    // The front slot belongs to this thread, a stale plan is invalidated in place
+    if(planner->plan_epoch[slot] != atomic_load(&planner->epoch)) planner->plan[slot]->valid = false;
+
+    return planner->plan[slot];
+}
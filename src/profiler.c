@@ -0,0 +1,144 @@
+#include "marslanding/profiler.h"
+
+#include <string.h>
+#include <time.h>
+
+const char *PROFILE_ZONE_NAMES[] = {"FRAME", "EVENTS", "PHYSICS", "COMMAND", "DRAW", "PREDICT", "PRESENT"};
+const double PROFILE_WINDOW = 1.0; // in s of wall time between overlay updates
+
+struct profiler_t profiler;
+
+// Monotonic clock in ns
+uint64_t profile_clock()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return (uint64_t)now.tv_sec*1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+// Start a timed scope, pass the result to profile_end
+uint64_t profile_begin()
+{
+    return profile_clock();
+}
+
+// Exact below PROFILE_SUBBUCKETS ns, then PROFILE_SUBBUCKETS buckets per power of two
+static int bucket_index(uint64_t ns)
+{
+    if (ns < PROFILE_SUBBUCKETS) return (int)ns;
+
+    int msb = 63 - __builtin_clzll(ns);
+    int sub = (int)(ns >> (msb-3)) & (PROFILE_SUBBUCKETS-1);
+
+    return (msb-2)*PROFILE_SUBBUCKETS + sub;
+}
+
+// Middle of a bucket, in ns
+static double bucket_value(int bucket)
+{
+    if (bucket < PROFILE_SUBBUCKETS) return bucket;
+
+    int msb = bucket/PROFILE_SUBBUCKETS + 2;
+    int sub = bucket % PROFILE_SUBBUCKETS;
+    double width = (double)(1ull << (msb-3));
+
+    return (PROFILE_SUBBUCKETS + sub)*width + 0.5*width;
+}
+
+// Count a duration in a histogram
+void add_duration(struct profile_histogram_t *histogram, uint64_t ns)
+{
+    histogram->counts[bucket_index(ns)]++;
+    histogram->count++;
+    histogram->total += ns;
+    if (ns > histogram->max) histogram->max = ns;
+}
+
+void profile_end(enum profile_zone_t zone, uint64_t start)
+{
+    uint64_t ns = profile_clock() - start;
+
+    add_duration(&profiler.zones[zone].total,ns);
+    add_duration(&profiler.zones[zone].window,ns);
+}
+
+// Once per frame, publishes the summaries of a window every PROFILE_WINDOW
+void profile_frame()
+{
+    uint64_t now = profile_clock();
+
+    if (profiler.window_start == 0) profiler.window_start = now;
+
+    if ((double)(now - profiler.window_start) < 1e9*PROFILE_WINDOW) return;
+
+    for (int i = 0; i < PROFILE_ZONES; i++)
+    {
+        struct profile_zone_stats_t *zone = &profiler.zones[i];
+
+        summarize_histogram(&zone->window,&zone->shown);
+        memset(&zone->window,0,sizeof(zone->window));
+    }
+
+    profiler.window_start = now;
+}
+
+static double percentile(const struct profile_histogram_t *histogram, double p)
+{
+    uint64_t rank = (uint64_t)(p*(double)(histogram->count-1));
+    uint64_t seen = 0;
+
+    for (int b = 0; b < PROFILE_BUCKETS; b++)
+    {
+        seen += histogram->counts[b];
+        if (seen > rank)
+        {
+            double value = bucket_value(b);
+            return (value < histogram->max) ? value : (double)histogram->max;
+        }
+    }
+
+    return (double)histogram->max;
+}
+
+void summarize_histogram(const struct profile_histogram_t *histogram, struct profile_summary_t *summary)
+{
+    memset(summary,0,sizeof(struct profile_summary_t));
+
+    summary->count = histogram->count;
+    if (histogram->count == 0) return;
+
+    summary->mean = 1e-9*(double)histogram->total/(double)histogram->count;
+    summary->p50 = 1e-9*percentile(histogram,0.50);
+    summary->p99 = 1e-9*percentile(histogram,0.99);
+    summary->max = 1e-9*(double)histogram->max;
+}
+
+// Table of the zones since start, in ms
+void print_profile(FILE *file)
+{
+    fprintf(file,"%-8s %10s %10s %10s %10s %10s %12s\n","zone","count","mean","p50","p99","max","total");
+
+    for (int i = 0; i < PROFILE_ZONES; i++)
+    {
+        struct profile_summary_t summary;
+        const struct profile_histogram_t *total = &profiler.zones[i].total;
+
+        summarize_histogram(total,&summary);
+
+        fprintf(file,"%-8s %10llu %10.3f %10.3f %10.3f %10.3f %12.1f\n",PROFILE_ZONE_NAMES[i],
+            (unsigned long long)summary.count,1e3*summary.mean,1e3*summary.p50,1e3*summary.p99,
+            1e3*summary.max,1e-6*(double)total->total);
+    }
+}
+
+bool write_profile(const char *path)
+{
+    FILE *file = fopen(path,"w");
+    if (file == NULL) return false;
+
+    fprintf(file,"# Frame profile in ms, percentiles within 7%%\n");
+    print_profile(file);
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,313 @@
+#include "marslanding/propagator.h"
+
+#include "marslanding/dynamics.h"
+#include "marslanding/trajectory.h"
+
+#include <math.h>
+#include <stddef.h>
+
+const double PREDICTION_RESOLUTION = 5.0; // in m, about a pixel of the default scene
+const double PREDICTION_MAX_INTERVAL = 0.25; // in s, keeps slow arcs smooth
+
+const double ARC_SERIES_THRESHOLD = 1e-3; // burnt mass fraction below which series are used
+const int ARC_ROOT_ITERATIONS = 100;
+
+// Velocity and position shape factors of the wet phase for a burnt mass fraction u,
+// s1 = -ln(1-u)/u and s2 = (u + (1-u)ln(1-u))/u^2, both tending to 1 and 1/2 at u = 0
+static void shape_factors(double u, double *s1, double *s2)
+{
+    if (fabs(u) < ARC_SERIES_THRESHOLD)
+    {
+        // Sums of u^(n-1)/n and u^(n-2)/(n(n-1)), Horner form
+        *s1 = 0.0;
+        *s2 = 0.0;
+        for (int n = 8; n >= 1; n--) *s1 = *s1*u + 1.0/n;
+        for (int n = 9; n >= 2; n--) *s2 = *s2*u + 1.0/(n*(n-1));
+        return;
+    }
+
+    double log_mass = log1p(-u);
+
+    *s1 = -log_mass/u;
+    *s2 = (u + (1.0-u)*log_mass)/(u*u);
+}
+
+// Wet phase, s seconds after the start
+static void wet_state(const struct arc_t *arc, double s, double *state)
+{
+    const double *initial = arc->state;
+    double mass = initial[M];
+
+    double s1, s2;
+    shape_factors(arc->flow*s/mass,&s1,&s2);
+
+    double ax = arc->thrust.x/mass, az = arc->thrust.z/mass;
+
+    state[PX] = initial[PX] + initial[VX]*s + ax*s*s*s2;
+    state[PZ] = initial[PZ] + initial[VZ]*s - 0.5*MARS_GRAVITY*s*s + az*s*s*s2;
+    state[VX] = initial[VX] + ax*s*s1;
+    state[VZ] = initial[VZ] - MARS_GRAVITY*s + az*s*s1;
+    state[M] = mass - arc->flow*s;
+}
+
+// Closed-form arc of a vehicle with a constant thrust, starting at a time and state
+void init_arc(struct arc_t *arc, const struct vehicle_t *vehicle, const struct thrust_t *thrust,
+    double time, const double *state)
+{
+    arc->start_time = time;
+    for (int i = 0; i < STATE_DIM; i++) arc->state[i] = state[i];
+
+    arc->thrust = *thrust;
+    arc->dry_mass = vehicle->dry_mass;
+    arc->flow = vehicle->alpha*thrust->norm;
+
+    if (state[M] <= vehicle->dry_mass)
+    {
+        arc->dry_time = time;
+        for (int i = 0; i < STATE_DIM; i++) arc->dry_state[i] = state[i];
+    }
+    else if (arc->flow > 0.0)
+    {
+        double duration = (state[M] - vehicle->dry_mass)/arc->flow;
+
+        arc->dry_time = time + duration;
+        wet_state(arc,duration,arc->dry_state);
+        arc->dry_state[M] = vehicle->dry_mass;
+    }
+    else
+    {
+        arc->dry_time = INFINITY;
+    }
+}
+
+// State at any time after the start, ignoring the ground
+void arc_state(const struct arc_t *arc, double time, double *state)
+{
+    if (time <= arc->dry_time && arc->state[M] > arc->dry_mass)
+    {
+        wet_state(arc,time-arc->start_time,state);
+        return;
+    }
+
+    // Ballistic
+    const double *dry = arc->dry_state;
+    double s = time - arc->dry_time;
+
+    state[PX] = dry[PX] + dry[VX]*s;
+    state[PZ] = dry[PZ] + dry[VZ]*s - 0.5*MARS_GRAVITY*s*s;
+    state[VX] = dry[VX];
+    state[VZ] = dry[VZ] - MARS_GRAVITY*s;
+    state[M] = dry[M];
+}
+
+// Height or vertical velocity at a time, with its time derivative
+static double arc_variable(const struct arc_t *arc, int variable, double time, double *derivative)
+{
+    double state[TRAJECTORY_DIM];
+    arc_state(arc,time,state);
+
+    if (variable == PZ)
+    {
+        *derivative = state[VZ];
+    }
+    else
+    {
+        bool wet = (time <= arc->dry_time && arc->state[M] > arc->dry_mass);
+        *derivative = -MARS_GRAVITY + (wet ? arc->thrust.z/state[M] : 0.0);
+    }
+
+    return state[variable];
+}
+
+// Zero of a variable monotonic over [a,b] and changing sign, safeguarded Newton
+static double arc_root(const struct arc_t *arc, int variable, double a, double b)
+{
+    double derivative;
+    bool positive_a = (arc_variable(arc,variable,a,&derivative) > 0.0);
+
+    double time = 0.5*(a+b);
+
+    for (int i = 0; i < ARC_ROOT_ITERATIONS; i++)
+    {
+        double value = arc_variable(arc,variable,time,&derivative);
+
+        if (value == 0.0) return time;
+
+        if ((value > 0.0) == positive_a) a = time;
+        else b = time;
+
+        double next = (derivative != 0.0) ? time - value/derivative : a;
+        if (!(next > a && next < b)) next = 0.5*(a+b); // bisect when Newton leaves the bracket
+
+        if (fabs(next-time) <= 1e-12*fmax(1.0,fabs(time))) return next;
+
+        time = next;
+    }
+
+    return time;
+}
+
+// Ground impact of a constant acceleration fall, relative to its start, INFINITY if none
+static double quadratic_touchdown(double pz, double vz, double az)
+{
+    if (pz <= 0.0) return 0.0;
+
+    if (az == 0.0) return (vz < 0.0) ? -pz/vz : INFINITY;
+
+    double discriminant = vz*vz - 2.0*az*pz;
+    if (discriminant < 0.0) return INFINITY;
+
+    // Smallest positive root of pz + vz*s + az*s^2/2, stable form
+    double q = -0.5*(vz + copysign(sqrt(discriminant),vz));
+    double roots[2] = {2.0*q/az, pz/q};
+    double first = INFINITY;
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (roots[i] > 0.0 && roots[i] < first) first = roots[i];
+    }
+
+    return first;
+}
+
+// Time of the first ground impact, the start time when already grounded
+double arc_touchdown_time(const struct arc_t *arc)
+{
+    const double *state = arc->state;
+
+    if (state[PZ] <= 0.0) return arc->start_time;
+
+    if (arc->dry_time == INFINITY)
+    {
+        // Constant mass, so constant acceleration
+        double az = -MARS_GRAVITY + arc->thrust.z/state[M];
+        return arc->start_time + quadratic_touchdown(state[PZ],state[VZ],az);
+    }
+
+    // Split the wet phase where the vertical acceleration then velocity change sign, the
+    // acceleration is monotonic in time so the height is monotonic on each piece
+    double breaks[4] = {arc->start_time, arc->dry_time, arc->dry_time, arc->dry_time};
+    int count = 2;
+
+    if (arc->dry_time > arc->start_time && arc->thrust.z > 0.0)
+    {
+        double balance = arc->start_time + (state[M] - arc->thrust.z/MARS_GRAVITY)/arc->flow;
+
+        if (balance > arc->start_time && balance < arc->dry_time)
+        {
+            breaks[2] = breaks[1];
+            breaks[1] = balance;
+            count = 3;
+        }
+    }
+
+    double times[7];
+    int pieces = 0;
+    times[pieces++] = breaks[0];
+
+    for (int i = 1; i < count; i++)
+    {
+        double a = breaks[i-1], b = breaks[i], derivative;
+
+        double va = arc_variable(arc,VZ,a,&derivative);
+        double vb = arc_variable(arc,VZ,b,&derivative);
+
+        if ((va > 0.0 && vb < 0.0) || (va < 0.0 && vb > 0.0))
+            times[pieces++] = arc_root(arc,VZ,a,b);
+
+        times[pieces++] = b;
+    }
+
+    for (int i = 1; i < pieces; i++)
+    {
+        double derivative;
+        if (arc_variable(arc,PZ,times[i],&derivative) <= 0.0)
+            return arc_root(arc,PZ,times[i-1],times[i]);
+    }
+
+    // Ballistic after dry-out
+    const double *dry = arc->dry_state;
+    return arc->dry_time + quadratic_touchdown(dry[PZ],dry[VZ],-MARS_GRAVITY);
+}
+
+// Exact step stopping at touchdown, integrator interface
+bool arc_step(const struct lander_t *lander, const double *state, double step,
+    double *new_state, double *error)
+{
+    if (error != NULL) *error = 0.0;
+
+    if (state[PZ] <= 0.0)
+    {
+        for (int i = 0; i < STATE_DIM; i++) new_state[i] = state[i];
+        return true;
+    }
+
+    struct arc_t arc;
+    init_arc(&arc,&lander->vehicle,&lander->thrust,0.0,state);
+
+    arc_state(&arc,step,new_state);
+
+    if (new_state[PZ] <= 0.0)
+    {
+        arc_state(&arc,fmin(arc_touchdown_time(&arc),step),new_state);
+        new_state[PZ] = 0.0;
+    }
+
+    return true;
+}
+
+// Jump the lander a duration ahead with its current thrust, stopping at touchdown
+bool forward_arc(struct lander_t *lander, double duration)
+{
+    if (lander->is_grounded || duration <= 0.0) return true;
+
+    struct arc_t arc;
+    init_arc(&arc,&lander->vehicle,&lander->thrust,lander->time,lander->state);
+
+    double time = lander->time + duration;
+    double touchdown = arc_touchdown_time(&arc);
+
+    if (touchdown <= time)
+    {
+        time = touchdown;
+        lander->is_grounded = true;
+    }
+
+    arc_state(&arc,time,lander->state);
+    if (lander->is_grounded) lander->state[PZ] = 0.0;
+
+    lander->time = time;
+
+    if (lander->state[M] <= lander->vehicle.dry_mass) lander->is_dry = true;
+
+    append_state(lander->history,lander->time,lander->state);
+
+    return true;
+}
+
+// Append samples every resolution meters along the arc until end_time, returns false when full
+bool sample_arc(const struct arc_t *arc, double end_time, double resolution, struct trajectory_t *samples)
+{
+    double state[TRAJECTORY_DIM];
+    double time = arc->start_time;
+
+    while (time < end_time)
+    {
+        if (samples->length == samples->capacity) return false;
+
+        arc_state(arc,time,state);
+        append_state(samples,time,state);
+
+        double speed = sqrt(state[VX]*state[VX] + state[VZ]*state[VZ]);
+
+        if (speed*PREDICTION_MAX_INTERVAL > resolution) time += resolution/speed;
+        else time += PREDICTION_MAX_INTERVAL;
+    }
+
+    if (samples->length == samples->capacity) return false;
+
+    arc_state(arc,end_time,state);
+    append_state(samples,end_time,state);
+
+    return true;
+}
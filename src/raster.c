@@ -0,0 +1,532 @@
+#include "marslanding/raster.h"
+
+#include "marslanding/render.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTER_SSE2
+#endif
+
+static uint32_t pack_color(int r, int g, int b, int a)
+{
+    unsigned char bytes[4] = {(unsigned char)r, (unsigned char)g, (unsigned char)b, (unsigned char)a};
+
+    uint32_t color;
+    memcpy(&color,bytes,4);
+
+    return color;
+}
+
+// Opaque span, four pixels per store
+static void fill_span(uint32_t *row, int count, uint32_t color)
+{
+    int i = 0;
+
+#ifdef RASTER_SSE2
+    __m128i value = _mm_set1_epi32((int)color);
+    for (; i+4 <= count; i += 4) _mm_storeu_si128((__m128i*)(row+i),value);
+#endif
+
+    for (; i < count; i++) row[i] = color;
+}
+
+// Translucent span, source over destination
+static void blend_span(uint32_t *row, int count, uint32_t color, int alpha)
+{
+    unsigned char source[4];
+    memcpy(source,&color,4);
+
+    for (int i = 0; i < count; i++)
+    {
+        unsigned char pixel[4];
+        memcpy(pixel,row+i,4);
+
+        for (int c = 0; c < 3; c++)
+            pixel[c] = (unsigned char)((source[c]*alpha + pixel[c]*(255-alpha) + 127)/255);
+        pixel[3] = 0xFF;
+
+        memcpy(row+i,pixel,4);
+    }
+}
+
+static void raster_span(struct framebuffer_t *framebuffer, int x, int y, int count)
+{
+    uint32_t *row = framebuffer->target + (size_t)y*framebuffer->width + x;
+
+    if (framebuffer->alpha == 0xFF) fill_span(row,count,framebuffer->color);
+    else blend_span(row,count,framebuffer->color,framebuffer->alpha);
+}
+
+static void raster_pixel(struct framebuffer_t *framebuffer, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= framebuffer->width || y >= framebuffer->height) return;
+
+    raster_span(framebuffer,x,y,1);
+}
+
+static void raster_set_color(void *context, int r, int g, int b, int a)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    framebuffer->color = pack_color(r,g,b,0xFF);
+    framebuffer->alpha = a;
+}
+
+// Whole target with the color, ignoring its alpha like SDL_RenderClear
+static void raster_clear(void *context)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    fill_span(framebuffer->target,framebuffer->width*framebuffer->height,framebuffer->color);
+}
+
+static void raster_fill_rects(void *context, const struct render_rect_t *rects, int count)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    for (int i = 0; i < count; i++)
+    {
+        int x0 = rects[i].x, y0 = rects[i].y;
+        int x1 = x0 + rects[i].w, y1 = y0 + rects[i].h;
+
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x1 > framebuffer->width) x1 = framebuffer->width;
+        if (y1 > framebuffer->height) y1 = framebuffer->height;
+
+        for (int y = y0; y < y1; y++)
+            if (x1 > x0) raster_span(framebuffer,x0,y,x1-x0);
+    }
+}
+
+// Bresenham segment, both ends included
+static void raster_line(struct framebuffer_t *framebuffer, int x0, int y0, int x1, int y1)
+{
+    // Horizontal segments are spans
+    if (y0 == y1 && y0 >= 0 && y0 < framebuffer->height)
+    {
+        int left = (x0 < x1) ? x0 : x1, right = (x0 < x1) ? x1 : x0;
+
+        if (left < 0) left = 0;
+        if (right >= framebuffer->width) right = framebuffer->width-1;
+        if (right >= left) raster_span(framebuffer,left,y0,right-left+1);
+
+        return;
+    }
+
+    int dx = abs(x1-x0), sx = (x0 < x1) ? 1 : -1;
+    int dy = -abs(y1-y0), sy = (y0 < y1) ? 1 : -1;
+    int error = dx + dy;
+
+    while (true)
+    {
+        raster_pixel(framebuffer,x0,y0);
+
+        if (x0 == x1 && y0 == y1) return;
+
+        int twice = 2*error;
+        if (twice >= dy)
+        {
+            error += dy;
+            x0 += sx;
+        }
+        if (twice <= dx)
+        {
+            error += dx;
+            y0 += sy;
+        }
+    }
+}
+
+static void raster_draw_lines(void *context, const struct render_point_t *points, int count)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    for (int i = 0; i+1 < count; i++)
+        raster_line(framebuffer,points[i].x,points[i].y,points[i+1].x,points[i+1].y);
+}
+
+static void raster_draw_points(void *context, const struct render_point_t *points, int count)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    for (int i = 0; i < count; i++) raster_pixel(framebuffer,points[i].x,points[i].y);
+}
+
+static bool raster_begin_layer(void *context)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    if (framebuffer->layer == NULL)
+    {
+        framebuffer->layer = malloc((size_t)framebuffer->width*framebuffer->height*sizeof(uint32_t));
+        if (framebuffer->layer == NULL) return false;
+    }
+
+    framebuffer->target = framebuffer->layer;
+
+    return true;
+}
+
+static void raster_end_layer(void *context)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    framebuffer->target = framebuffer->pixels;
+    framebuffer->has_layer = true;
+}
+
+static bool raster_draw_layer(void *context)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    if (!framebuffer->has_layer) return false;
+
+    memcpy(framebuffer->pixels,framebuffer->layer,(size_t)framebuffer->width*framebuffer->height*sizeof(uint32_t));
+
+    return true;
+}
+
+static void raster_drop_layer(void *context)
+{
+    struct framebuffer_t *framebuffer = context;
+
+    framebuffer->has_layer = false;
+}
+
+// Allocate a white framebuffer
+struct framebuffer_t* create_framebuffer(int width, int height)
+{
+    if (width <= 0 || height <= 0) return NULL;
+
+    struct framebuffer_t *framebuffer = calloc(1,sizeof(struct framebuffer_t));
+    if (framebuffer == NULL) return NULL;
+
+    framebuffer->pixels = malloc((size_t)width*height*sizeof(uint32_t));
+    if (framebuffer->pixels == NULL)
+    {
+        free(framebuffer);
+        return NULL;
+    }
+
+    framebuffer->width = width;
+    framebuffer->height = height;
+    framebuffer->target = framebuffer->pixels;
+
+    struct render_backend_t *backend = &framebuffer->backend;
+    backend->name = "software";
+    backend->context = framebuffer;
+    backend->set_color = raster_set_color;
+    backend->clear = raster_clear;
+    backend->fill_rects = raster_fill_rects;
+    backend->draw_lines = raster_draw_lines;
+    backend->draw_points = raster_draw_points;
+    backend->begin_layer = raster_begin_layer;
+    backend->end_layer = raster_end_layer;
+    backend->draw_layer = raster_draw_layer;
+    backend->drop_layer = raster_drop_layer;
+
+    raster_set_color(framebuffer,0xFF,0xFF,0xFF,0xFF);
+    raster_clear(framebuffer);
+
+    return framebuffer;
+}
+
+// Free memory for a framebuffer
+struct framebuffer_t* free_framebuffer(struct framebuffer_t *framebuffer)
+{
+    if (framebuffer == NULL) return NULL;
+
+    free(framebuffer->layer);
+    free(framebuffer->pixels);
+    free(framebuffer);
+
+    return NULL;
+}
+
+// Pixel at a position, as r, g, b and a bytes
+void get_pixel(const struct framebuffer_t *framebuffer, int x, int y, unsigned char *rgba)
+{
+    memcpy(rgba,framebuffer->pixels + (size_t)y*framebuffer->width + x,4);
+}
+
+// Binary PPM of the pixels, alpha dropped
+bool write_ppm(const struct framebuffer_t *framebuffer, const char *path)
+{
+    FILE *file = fopen(path,"wb");
+    if (file == NULL) return false;
+
+    size_t row_size = 3*(size_t)framebuffer->width;
+    unsigned char *row = malloc(row_size);
+    if (row == NULL)
+    {
+        fclose(file);
+        return false;
+    }
+
+    fprintf(file,"P6\n%d %d\n255\n",framebuffer->width,framebuffer->height);
+
+    bool written = true;
+
+    for (int y = 0; y < framebuffer->height && written; y++)
+    {
+        for (int x = 0; x < framebuffer->width; x++)
+        {
+            unsigned char rgba[4];
+            get_pixel(framebuffer,x,y,rgba);
+            memcpy(row+3*x,rgba,3);
+        }
+
+        written = fwrite(row,1,row_size,file) == row_size;
+    }
+
+    free(row);
+
+    return fclose(file) == 0 && written;
+}
+
+// Deflate stream written least significant bit first
+struct bit_writer_t
+{
+    unsigned char *bytes;
+    size_t length;
+    uint64_t buffer;
+    int count;
+};
+
+static void put_bits(struct bit_writer_t *writer, uint32_t bits, int count)
+{
+    writer->buffer |= (uint64_t)bits << writer->count;
+    writer->count += count;
+
+    while (writer->count >= 8)
+    {
+        writer->bytes[writer->length++] = writer->buffer & 0xFF;
+        writer->buffer >>= 8;
+        writer->count -= 8;
+    }
+}
+
+// Huffman codes go out most significant bit first
+static void put_code(struct bit_writer_t *writer, uint32_t code, int count)
+{
+    uint32_t reversed = 0;
+    for (int i = 0; i < count; i++) reversed |= ((code >> i) & 1) << (count-1-i);
+
+    put_bits(writer,reversed,count);
+}
+
+// Fixed Huffman code of a literal or length symbol
+static void put_symbol(struct bit_writer_t *writer, int symbol)
+{
+    if (symbol < 144) put_code(writer,0x30 + symbol,8);
+    else if (symbol < 256) put_code(writer,0x190 + symbol - 144,9);
+    else if (symbol < 280) put_code(writer,symbol - 256,7);
+    else put_code(writer,0xC0 + symbol - 280,8);
+}
+
+static void put_match(struct bit_writer_t *writer, int length, int distance)
+{
+    static const int length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const int distance_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const int distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    int l = 28;
+    while (length_base[l] > length) l--;
+
+    put_symbol(writer,257 + l);
+    put_bits(writer,length - length_base[l],length_extra[l]);
+
+    int d = 29;
+    while (distance_base[d] > distance) d--;
+
+    put_code(writer,d,5);
+    put_bits(writer,distance - distance_base[d],distance_extra[d]);
+}
+
+static size_t match_length(const unsigned char *data, size_t size, size_t i, size_t distance)
+{
+    if (distance > i) return 0;
+
+    size_t length = 0;
+    while (length < 258 && i + length < size && data[i+length] == data[i+length-distance]) length++;
+
+    return length;
+}
+
+// Single fixed Huffman block, repeats of the previous pixel or the previous row are matches
+static size_t deflate_image(const unsigned char *data, size_t size, size_t row_size, unsigned char *out)
+{
+    struct bit_writer_t writer = {out, 0, 0, 0};
+
+    put_bits(&writer,1,1); // final block
+    put_bits(&writer,1,2); // fixed codes
+
+    for (size_t i = 0; i < size;)
+    {
+        size_t pixel = match_length(data,size,i,3);
+        size_t row = (row_size <= 32768) ? match_length(data,size,i,row_size) : 0;
+
+        size_t length = (row > pixel) ? row : pixel;
+
+        if (length < 3)
+        {
+            put_symbol(&writer,data[i]);
+            i++;
+            continue;
+        }
+
+        put_match(&writer,(int)length,(int)((row > pixel) ? row_size : 3));
+        i += length;
+    }
+
+    put_symbol(&writer,256); // end of block
+    put_bits(&writer,0,7); // flush
+
+    return writer.length;
+}
+
+static uint32_t crc_table[256];
+static bool crc_table_ready = false;
+
+static void init_crc_table()
+{
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+
+    crc_table_ready = true;
+}
+
+static uint32_t update_crc(uint32_t crc, const unsigned char *bytes, size_t count)
+{
+    for (size_t i = 0; i < count; i++) crc = crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+
+    return crc;
+}
+
+static uint32_t adler32(const unsigned char *bytes, size_t count)
+{
+    const size_t deferred = 5552; // bytes summed before the sums can overflow
+
+    uint32_t a = 1, b = 0;
+
+    for (size_t begin = 0; begin < count; begin += deferred)
+    {
+        size_t end = (begin + deferred < count) ? begin + deferred : count;
+
+        for (size_t i = begin; i < end; i++)
+        {
+            a += bytes[i];
+            b += a;
+        }
+
+        a %= 65521;
+        b %= 65521;
+    }
+
+    return (b << 16) | a;
+}
+
+static void store_u32(unsigned char *bytes, uint32_t value)
+{
+    bytes[0] = value >> 24;
+    bytes[1] = (value >> 16) & 0xFF;
+    bytes[2] = (value >> 8) & 0xFF;
+    bytes[3] = value & 0xFF;
+}
+
+// Length, type, data and CRC of a chunk, type and data contiguous in chunk
+static bool write_chunk(FILE *file, unsigned char *chunk, size_t length)
+{
+    unsigned char header[4], crc[4];
+
+    store_u32(header,(uint32_t)length);
+    store_u32(crc,update_crc(0xFFFFFFFFu,chunk,length+4) ^ 0xFFFFFFFFu);
+
+    return fwrite(header,1,4,file) == 4 && fwrite(chunk,1,length+4,file) == length+4 && fwrite(crc,1,4,file) == 4;
+}
+
+// RGB PNG of the pixels, compressed with runs of pixels and rows only
+bool write_png(const struct framebuffer_t *framebuffer, const char *path)
+{
+    if (!crc_table_ready) init_crc_table();
+
+    size_t row_size = 1 + 3*(size_t)framebuffer->width; // filter byte first
+    size_t raw_size = row_size*framebuffer->height;
+
+    // Literals take at most 9 bits
+    size_t chunk_size = 4 + 2 + raw_size + raw_size/8 + 16 + 4;
+
+    unsigned char *raw = malloc(raw_size + chunk_size);
+    if (raw == NULL) return false;
+
+    unsigned char *chunk = raw + raw_size;
+
+    for (int y = 0; y < framebuffer->height; y++)
+    {
+        unsigned char *row = raw + y*row_size;
+        row[0] = 0;
+
+        for (int x = 0; x < framebuffer->width; x++)
+        {
+            unsigned char rgba[4];
+            get_pixel(framebuffer,x,y,rgba);
+            memcpy(row+1+3*x,rgba,3);
+        }
+    }
+
+    FILE *file = fopen(path,"wb");
+    if (file == NULL)
+    {
+        free(raw);
+        return false;
+    }
+
+    const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    bool written = fwrite(signature,1,8,file) == 8;
+
+    // 8 bit RGB, no interlace
+    memcpy(chunk,"IHDR",4);
+    store_u32(chunk+4,framebuffer->width);
+    store_u32(chunk+8,framebuffer->height);
+    const unsigned char header[5] = {8, 2, 0, 0, 0};
+    memcpy(chunk+12,header,5);
+    written = written && write_chunk(file,chunk,13);
+
+    memcpy(chunk,"IDAT",4);
+    chunk[4] = 0x78;
+    chunk[5] = 0x01;
+    size_t length = 2 + deflate_image(raw,raw_size,row_size,chunk+6);
+    store_u32(chunk+4+length,adler32(raw,raw_size));
+    written = written && write_chunk(file,chunk,length+4);
+
+    memcpy(chunk,"IEND",4);
+    written = written && write_chunk(file,chunk,0);
+
+    free(raw);
+
+    return fclose(file) == 0 && written;
+}
+
+// PNG when the path ends with .png, PPM otherwise
+bool write_frame(const struct framebuffer_t *framebuffer, const char *path)
+{
+    size_t length = strlen(path);
+
+    if (length >= 4 && strcmp(path+length-4,".png") == 0) return write_png(framebuffer,path);
+
+    return write_ppm(framebuffer,path);
+}
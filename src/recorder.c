@@ -0,0 +1,190 @@
+#include "marslanding/recorder.h"
+
+#include "marslanding/dynamics.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char RECORDER_MAGIC[8] = {'M', 'A', 'R', 'S', 'L', 'O', 'G', '\0'};
+const uint32_t RECORDER_VERSION = 1;
+const size_t RECORDER_INITIAL_CAPACITY = 1 << 14; // ~2.7 min of ticks
+
+static size_t mapping_size(size_t capacity)
+{
+    return sizeof(struct recorder_header_t) + capacity*sizeof(struct flight_record_t);
+}
+
+// Map the file over its current size
+static bool map_recorder(struct recorder_t *recorder, size_t size)
+{
+    int protection = recorder->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+
+    void *map = mmap(NULL,size,protection,MAP_SHARED,recorder->file,0);
+    if (map == MAP_FAILED) return false;
+
+    recorder->map = map;
+    recorder->size = size;
+    recorder->header = map;
+    recorder->records = (struct flight_record_t*)((char*)map + sizeof(struct recorder_header_t));
+    recorder->capacity = (size - sizeof(struct recorder_header_t))/sizeof(struct flight_record_t);
+
+    return true;
+}
+
+// Double the file and map it again, the records already written stay in the page cache
+static bool grow_recorder(struct recorder_t *recorder)
+{
+    size_t size = mapping_size(2*recorder->capacity);
+
+    if (ftruncate(recorder->file,(off_t)size) != 0) return false;
+
+    munmap(recorder->map,recorder->size);
+    recorder->map = NULL;
+
+    if (map_recorder(recorder,size)) return true;
+
+    // The file keeps its header and records, only this recorder stops
+    recorder->header = NULL;
+    recorder->records = NULL;
+    recorder->writable = false;
+
+    return false;
+}
+
+// Create a log for a vehicle, replacing any file at path
+struct recorder_t* create_recorder(const char *path, const struct vehicle_t *vehicle)
+{
+    struct recorder_t *recorder = calloc(1,sizeof(struct recorder_t));
+    if (recorder == NULL) return NULL;
+
+    recorder->writable = true;
+    recorder->file = open(path,O_RDWR | O_CREAT | O_TRUNC,0644);
+
+    size_t size = mapping_size(RECORDER_INITIAL_CAPACITY);
+
+    if (recorder->file < 0 || ftruncate(recorder->file,(off_t)size) != 0 || !map_recorder(recorder,size))
+        return close_recorder(recorder);
+
+    struct recorder_header_t *header = recorder->header;
+
+    memcpy(header->magic,RECORDER_MAGIC,sizeof(RECORDER_MAGIC));
+    header->version = RECORDER_VERSION;
+    header->header_size = sizeof(struct recorder_header_t);
+    header->record_size = sizeof(struct flight_record_t);
+    header->count = 0;
+    header->time_step = FORWARD_TIME_STEP;
+    header->dry_mass = vehicle->dry_mass;
+
+    return recorder;
+}
+
+// Open an existing log read only, NULL when the header does not match this version
+struct recorder_t* open_recorder(const char *path)
+{
+    struct recorder_t *recorder = calloc(1,sizeof(struct recorder_t));
+    if (recorder == NULL) return NULL;
+
+    recorder->file = open(path,O_RDONLY);
+
+    struct stat status;
+    if (recorder->file < 0 || fstat(recorder->file,&status) != 0) return close_recorder(recorder);
+
+    size_t size = (size_t)status.st_size;
+    if (size < sizeof(struct recorder_header_t) || !map_recorder(recorder,size)) return close_recorder(recorder);
+
+    const struct recorder_header_t *header = recorder->header;
+
+    bool valid = memcmp(header->magic,RECORDER_MAGIC,sizeof(RECORDER_MAGIC)) == 0
+        && header->version == RECORDER_VERSION
+        && header->header_size == sizeof(struct recorder_header_t)
+        && header->record_size == sizeof(struct flight_record_t)
+        && header->count <= recorder->capacity;
+
+    if (!valid) return close_recorder(recorder);
+
+    return recorder;
+}
+
+// Trim the file to its records and free memory for a log
+struct recorder_t* close_recorder(struct recorder_t *recorder)
+{
+    if (recorder == NULL) return NULL;
+
+    size_t count = (recorder->header != NULL) ? recorder->header->count : 0;
+
+    if (recorder->map != NULL) munmap(recorder->map,recorder->size);
+
+    if (recorder->file >= 0)
+    {
+        // A failed trim only leaves unused records past count
+        if (recorder->writable && recorder->header != NULL)
+        {
+            int trimmed = ftruncate(recorder->file,(off_t)mapping_size(count));
+            (void)trimmed;
+        }
+
+        close(recorder->file);
+    }
+
+    free(recorder);
+
+    return NULL;
+}
+
+// Append the lander state and command of a tick
+bool record_tick(struct recorder_t *recorder, const struct lander_t *lander,
+    double joy_x, double joy_z, double joy_n)
+{
+    if (recorder == NULL || !recorder->writable || recorder->header == NULL) return false;
+
+    size_t count = recorder->header->count;
+    if (count == recorder->capacity && !grow_recorder(recorder)) return false;
+
+    struct flight_record_t *record = recorder->records + count;
+
+    record->time = lander->time;
+    for (int i = 0; i < TRAJECTORY_DIM; i++) record->state[i] = lander->state[i];
+    record->thrust_x = lander->thrust.x;
+    record->thrust_z = lander->thrust.z;
+    record->thrust_norm = lander->thrust.norm;
+    record->joy_x = joy_x;
+    record->joy_z = joy_z;
+    record->joy_n = joy_n;
+
+    // Readers of a live log only see complete records
+    recorder->header->count = count + 1;
+
+    return true;
+}
+
+size_t record_count(const struct recorder_t *recorder)
+{
+    return (recorder != NULL && recorder->header != NULL) ? (size_t)recorder->header->count : 0;
+}
+
+const struct flight_record_t* get_record(const struct recorder_t *recorder, size_t i)
+{
+    if (i >= record_count(recorder)) return NULL;
+
+    return recorder->records + i;
+}
+
+// Header line and one CSV row per record
+void print_records_csv(FILE *file, const struct recorder_t *recorder)
+{
+    fprintf(file,"time,px,pz,vx,vz,m,thrust_x,thrust_z,thrust_norm,joy_x,joy_z,joy_n\n");
+
+    for (size_t i = 0; i < record_count(recorder); i++)
+    {
+        const struct flight_record_t *r = get_record(recorder,i);
+
+        fprintf(file,"%.17g",r->time);
+        for (int k = 0; k < TRAJECTORY_DIM; k++) fprintf(file,",%.17g",r->state[k]);
+        fprintf(file,",%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n",
+            r->thrust_x,r->thrust_z,r->thrust_norm,r->joy_x,r->joy_z,r->joy_n);
+    }
+}
@@ -0,0 +1,42 @@
+#include "marslanding/recorder.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void print_usage()
+{
+    printf("Usage: marslanding_log LOG [CSV]\n");
+    printf("  Convert a flight log recorded with marslanding -l to CSV, on stdout without CSV\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3 || strcmp(argv[1],"-h") == 0)
+    {
+        print_usage();
+        return (argc == 2) ? 0 : -1;
+    }
+
+    struct recorder_t *recorder = open_recorder(argv[1]);
+    if (recorder == NULL)
+    {
+        printf("Failed to open flight log %s (version %u expected)\n",argv[1],RECORDER_VERSION);
+        return -1;
+    }
+
+    FILE *file = (argc == 3) ? fopen(argv[2],"w") : stdout;
+    if (file == NULL)
+    {
+        printf("Failed to open %s\n",argv[2]);
+        close_recorder(recorder);
+        return -1;
+    }
+
+    print_records_csv(file,recorder);
+
+    if (file != stdout) fclose(file);
+
+    close_recorder(recorder);
+
+    return 0;
+}
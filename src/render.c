@@ -0,0 +1,62 @@
+#include "marslanding/render.h"
+
+#include <stddef.h>
+
+struct render_backend_t *renderer = NULL;
+
+void render_color(int r, int g, int b, int a)
+{
+    renderer->set_color(renderer->context,r,g,b,a);
+}
+
+void render_clear()
+{
+    renderer->clear(renderer->context);
+}
+
+void render_fill_rect(const struct render_rect_t *rect)
+{
+    renderer->fill_rects(renderer->context,rect,1);
+}
+
+void render_fill_rects(const struct render_rect_t *rects, int count)
+{
+    if (count > 0) renderer->fill_rects(renderer->context,rects,count);
+}
+
+void render_lines(const struct render_point_t *points, int count)
+{
+    if (count > 1) renderer->draw_lines(renderer->context,points,count);
+}
+
+void render_points(const struct render_point_t *points, int count)
+{
+    if (count > 0) renderer->draw_points(renderer->context,points,count);
+}
+
+// Start drawing into the cached layer, false when the backend has none
+bool render_begin_layer()
+{
+    if (renderer->begin_layer == NULL) return false;
+
+    return renderer->begin_layer(renderer->context);
+}
+
+void render_end_layer()
+{
+    if (renderer->end_layer != NULL) renderer->end_layer(renderer->context);
+}
+
+// Cover the target with the cached layer, false when it must be drawn again
+bool render_layer()
+{
+    if (renderer->draw_layer == NULL) return false;
+
+    return renderer->draw_layer(renderer->context);
+}
+
+// Release the cached layer, after a size change
+void render_drop_layer()
+{
+    if (renderer->drop_layer != NULL) renderer->drop_layer(renderer->context);
+}
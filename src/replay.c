@@ -0,0 +1,383 @@
+#include "marslanding/replay.h"
+
+#include "marslanding/dynamics.h"
+#include "marslanding/integrator.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+const int REPLAY_VERSION = 1;
+const uint64_t REPLAY_SNAPSHOT_PERIOD = 1000; // 10 s of ticks
+
+// Start the input log of a session from the current lander state and integrator
+struct input_log_t* create_input_log(const char *path, const struct lander_t *lander)
+{
+    struct input_log_t *log = calloc(1,sizeof(struct input_log_t));
+    if (log == NULL) return NULL;
+
+    log->file = fopen(path,"w");
+    if (log->file == NULL)
+    {
+        free(log);
+        return NULL;
+    }
+
+    // Shortest decimal forms that read back to the same doubles
+    fprintf(log->file,"MARSINPUT %d\n",REPLAY_VERSION);
+    fprintf(log->file,"state");
+    for (int i = 0; i < TRAJECTORY_DIM; i++) fprintf(log->file," %.17g",lander->state[i]);
+    fprintf(log->file,"\n");
+    fprintf(log->file,"integrator %s\n",lander_integrator(lander)->name);
+    fprintf(log->file,"locate_events %d\n",lander->locate_events ? 1 : 0);
+
+    return log;
+}
+
+// Write the last tick of the session and free memory for a log
+struct input_log_t* close_input_log(struct input_log_t *log, uint64_t tick)
+{
+    if (log == NULL) return NULL;
+
+    fprintf(log->file,"%" PRIu64 " end\n",tick);
+    fclose(log->file);
+
+    free(log);
+
+    return NULL;
+}
+
+// Log the command of a tick, only when it differs from the previous one
+void log_command(struct input_log_t *log, uint64_t tick, double joy_x, double joy_z, double joy_n)
+{
+    if (log == NULL) return;
+
+    if (log->has_command && joy_x == log->joy_x && joy_z == log->joy_z && joy_n == log->joy_n) return;
+
+    fprintf(log->file,"%" PRIu64 " command %.17g %.17g %.17g\n",tick,joy_x,joy_z,joy_n);
+
+    log->has_command = true;
+    log->joy_x = joy_x;
+    log->joy_z = joy_z;
+    log->joy_n = joy_n;
+}
+
+void log_integrator(struct input_log_t *log, uint64_t tick, const struct integrator_t *integrator)
+{
+    if (log == NULL) return;
+
+    fprintf(log->file,"%" PRIu64 " integrator %s\n",tick,integrator->name);
+}
+
+void log_reset(struct input_log_t *log, uint64_t tick)
+{
+    if (log == NULL) return;
+
+    fprintf(log->file,"%" PRIu64 " reset\n",tick);
+}
+
+// Log a scenario change, the vehicle parameters and initial state
+void log_scenario(struct input_log_t *log, uint64_t tick, const struct vehicle_t *vehicle,
+    const double *initial_state)
+{
+    if (log == NULL) return;
+
+    fprintf(log->file,"%" PRIu64 " scenario %.17g %.17g %.17g %d %.17g %.17g %.17g %.17g",tick,
+        vehicle->dry_mass,vehicle->wet_mass,vehicle->isp,vehicle->nb_thrusters,
+        vehicle->t_1,vehicle->t_2,vehicle->t_bar,vehicle->phi);
+    for (int i = 0; i < TRAJECTORY_DIM; i++) fprintf(log->file," %.17g",initial_state[i]);
+    fprintf(log->file,"\n");
+}
+
+static bool append_event(struct replay_t *replay, size_t *capacity, const struct input_event_t *event)
+{
+    if (replay->event_count == *capacity)
+    {
+        size_t grown = (*capacity == 0) ? 256 : 2*(*capacity);
+
+        struct input_event_t *events = realloc(replay->events,grown*sizeof(struct input_event_t));
+        if (events == NULL) return false;
+
+        replay->events = events;
+        *capacity = grown;
+    }
+
+    replay->events[replay->event_count++] = *event;
+
+    return true;
+}
+
+// Parse the header and the events of a log, false on a malformed line
+static bool parse_replay(struct replay_t *replay, FILE *file)
+{
+    char line[512], name[64];
+    int version, flag;
+    double *s = replay->initial_state;
+
+    if (fgets(line,sizeof(line),file) == NULL) return false;
+    if (sscanf(line,"MARSINPUT %d",&version) != 1 || version != REPLAY_VERSION) return false;
+
+    if (fgets(line,sizeof(line),file) == NULL) return false;
+    if (sscanf(line,"state %lf %lf %lf %lf %lf",&s[0],&s[1],&s[2],&s[3],&s[4]) != TRAJECTORY_DIM) return false;
+
+    if (fgets(line,sizeof(line),file) == NULL) return false;
+    if (sscanf(line,"integrator %63s",name) != 1) return false;
+    replay->initial_integrator = find_integrator(name);
+    if (replay->initial_integrator == NULL) return false;
+
+    if (fgets(line,sizeof(line),file) == NULL) return false;
+    if (sscanf(line,"locate_events %d",&flag) != 1) return false;
+    replay->locate_events = (flag != 0);
+
+    size_t capacity = 0;
+    uint64_t previous = 0;
+
+    while (fgets(line,sizeof(line),file) != NULL)
+    {
+        struct input_event_t event = {0};
+        int offset = 0;
+
+        if (sscanf(line,"%" SCNu64 " %63s %n",&event.tick,name,&offset) != 2) return false;
+
+        // Inputs are written as they happen
+        if (event.tick < previous) return false;
+        previous = event.tick;
+
+        const char *arguments = line + offset;
+
+        if (strcmp(name,"end") == 0)
+        {
+            replay->end_tick = event.tick;
+            break;
+        }
+        else if (strcmp(name,"command") == 0)
+        {
+            event.type = INPUT_COMMAND;
+            if (sscanf(arguments,"%lf %lf %lf",&event.joy_x,&event.joy_z,&event.joy_n) != 3) return false;
+        }
+        else if (strcmp(name,"integrator") == 0)
+        {
+            event.type = INPUT_INTEGRATOR;
+            if (sscanf(arguments,"%63s",name) != 1) return false;
+            event.integrator = find_integrator(name);
+            if (event.integrator == NULL) return false;
+        }
+        else if (strcmp(name,"reset") == 0)
+        {
+            event.type = INPUT_RESET;
+        }
+        else if (strcmp(name,"scenario") == 0)
+        {
+            struct vehicle_t *v = &event.vehicle;
+            double *e = event.state;
+
+            event.type = INPUT_SCENARIO;
+            if (sscanf(arguments,"%lf %lf %lf %d %lf %lf %lf %lf %lf %lf %lf %lf %lf",
+                &v->dry_mass,&v->wet_mass,&v->isp,&v->nb_thrusters,&v->t_1,&v->t_2,&v->t_bar,&v->phi,
+                &e[0],&e[1],&e[2],&e[3],&e[4]) != 8 + TRAJECTORY_DIM) return false;
+            derive_vehicle(v);
+        }
+        else return false;
+
+        if (!append_event(replay,&capacity,&event)) return false;
+    }
+
+    return true;
+}
+
+// Load an input log, positioned at tick 0
+struct replay_t* load_replay(const char *path)
+{
+    FILE *file = fopen(path,"r");
+    if (file == NULL) return NULL;
+
+    struct replay_t *replay = calloc(1,sizeof(struct replay_t));
+    if (replay == NULL)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    replay->end_tick = UINT64_MAX;
+
+    bool parsed = parse_replay(replay,file);
+    fclose(file);
+
+    replay->lander = parsed ? create_lander(0) : NULL;
+    if (replay->lander == NULL) return free_replay(replay);
+
+    rewind_replay(replay);
+
+    return replay;
+}
+
+// Free memory for a replay
+struct replay_t* free_replay(struct replay_t *replay)
+{
+    if (replay == NULL) return NULL;
+
+    free_lander(replay->lander);
+    free(replay->events);
+    free(replay->snapshots);
+    free(replay);
+
+    return NULL;
+}
+
+// Back to tick 0, snapshots are kept
+void rewind_replay(struct replay_t *replay)
+{
+    struct lander_t *lander = replay->lander;
+
+    init_vehicle(&lander->vehicle);
+    memcpy(replay->reset_state,replay->initial_state,sizeof(replay->reset_state));
+
+    reset_lander(lander,replay->initial_state);
+    lander->integrator = replay->initial_integrator;
+    lander->locate_events = replay->locate_events;
+
+    replay->tick = 0;
+    replay->next_event = 0;
+    replay->command[0] = replay->command[1] = replay->command[2] = 0.0;
+}
+
+// Save the position at a multiple of the period reached for the first time
+static void snapshot_replay(struct replay_t *replay)
+{
+    if (replay->tick % REPLAY_SNAPSHOT_PERIOD != 0) return;
+    if (replay->tick/REPLAY_SNAPSHOT_PERIOD != replay->snapshot_count) return;
+
+    if (replay->snapshot_count == replay->snapshot_capacity)
+    {
+        size_t capacity = (replay->snapshot_capacity == 0) ? 64 : 2*replay->snapshot_capacity;
+
+        struct replay_snapshot_t *snapshots = realloc(replay->snapshots,capacity*sizeof(struct replay_snapshot_t));
+        if (snapshots == NULL) return; // seeks only start further back
+
+        replay->snapshots = snapshots;
+        replay->snapshot_capacity = capacity;
+    }
+
+    const struct lander_t *lander = replay->lander;
+    struct replay_snapshot_t *snapshot = replay->snapshots + replay->snapshot_count++;
+
+    snapshot->tick = replay->tick;
+    snapshot->next_event = replay->next_event;
+    memcpy(snapshot->command,replay->command,sizeof(replay->command));
+
+    snapshot->time = lander->time;
+    memcpy(snapshot->state,lander->state,sizeof(lander->state));
+    snapshot->thrust = lander->thrust;
+    snapshot->is_dry = lander->is_dry;
+    snapshot->is_grounded = lander->is_grounded;
+    snapshot->integrator = lander->integrator;
+    snapshot->adaptive_step = lander->adaptive_step;
+    snapshot->vehicle = lander->vehicle;
+    memcpy(snapshot->reset_state,replay->reset_state,sizeof(replay->reset_state));
+}
+
+static void restore_snapshot(struct replay_t *replay, const struct replay_snapshot_t *snapshot)
+{
+    struct lander_t *lander = replay->lander;
+
+    replay->tick = snapshot->tick;
+    replay->next_event = snapshot->next_event;
+    memcpy(replay->command,snapshot->command,sizeof(replay->command));
+
+    lander->time = snapshot->time;
+    memcpy(lander->state,snapshot->state,sizeof(lander->state));
+    lander->thrust = snapshot->thrust;
+    lander->is_dry = snapshot->is_dry;
+    lander->is_grounded = snapshot->is_grounded;
+    lander->integrator = snapshot->integrator;
+    lander->adaptive_step = snapshot->adaptive_step;
+    lander->vehicle = snapshot->vehicle;
+    memcpy(replay->reset_state,snapshot->reset_state,sizeof(replay->reset_state));
+
+    invalidate_prediction(lander);
+}
+
+// Same effects as the game inputs
+static void apply_event(struct replay_t *replay, const struct input_event_t *event)
+{
+    struct lander_t *lander = replay->lander;
+
+    switch (event->type)
+    {
+        case INPUT_COMMAND:
+            replay->command[0] = event->joy_x;
+            replay->command[1] = event->joy_z;
+            replay->command[2] = event->joy_n;
+            break;
+
+        case INPUT_INTEGRATOR:
+            lander->integrator = event->integrator;
+            lander->adaptive_step = 0.0;
+            break;
+
+        case INPUT_RESET:
+            reset_lander(lander,replay->reset_state);
+            break;
+
+        case INPUT_SCENARIO:
+            lander->vehicle = event->vehicle;
+            memcpy(replay->reset_state,event->state,sizeof(replay->reset_state));
+            reset_lander(lander,replay->reset_state);
+            break;
+    }
+}
+
+// Apply the inputs of the current tick and run it, false at the end of the session or on the ground
+bool step_replay(struct replay_t *replay)
+{
+    struct lander_t *lander = replay->lander;
+
+    snapshot_replay(replay);
+
+    while (replay->next_event < replay->event_count && replay->events[replay->next_event].tick == replay->tick)
+    {
+        apply_event(replay,replay->events + replay->next_event);
+        replay->next_event++;
+    }
+
+    // The game only ticks in flight, later inputs are keyed to this tick
+    if (replay->tick >= replay->end_tick || lander->is_grounded) return false;
+
+    compute_thrust(lander,replay->command[0],replay->command[1],replay->command[2]);
+    forward_tick(lander);
+
+    replay->tick++;
+
+    return true;
+}
+
+// Step up to a tick, false when the session stops before
+bool run_replay(struct replay_t *replay, uint64_t tick)
+{
+    while (replay->tick < tick)
+    {
+        if (!step_replay(replay)) return false;
+    }
+
+    return true;
+}
+
+// Jump to a tick from the closest snapshot before it, false when the session stops before
+bool seek_replay(struct replay_t *replay, uint64_t tick)
+{
+    if (replay->snapshot_count == 0)
+    {
+        if (tick < replay->tick) rewind_replay(replay);
+
+        return run_replay(replay,tick);
+    }
+
+    // Snapshots only exist up to the furthest tick reached
+    size_t k = (size_t)(tick/REPLAY_SNAPSHOT_PERIOD);
+    if (k >= replay->snapshot_count) k = replay->snapshot_count - 1;
+
+    if (tick < replay->tick || replay->snapshots[k].tick > replay->tick)
+        restore_snapshot(replay,replay->snapshots + k);
+
+    return run_replay(replay,tick);
+}
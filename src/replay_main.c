@@ -0,0 +1,218 @@
+#include "marslanding/replay.h"
+
+#include "marslanding/dynamics.h"
+#include "marslanding/recorder.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void print_usage()
+{
+    printf("Usage: marslanding_replay [options] INPUTS\n");
+    printf("  Replay a session recorded with marslanding -i INPUTS, headless and as fast as possible\n");
+    printf("  -n REPEAT         replay the session several times to time the physics (default 1)\n");
+    printf("  -l LOG            compare every tick with the flight log recorded alongside, bit for bit\n");
+    printf("  -s TIME           seek to a session time in s, pauses excluded, and print the state\n");
+    printf("  -c                check seeks from snapshots against the straight replay\n");
+}
+
+static double wall_time()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return (double)now.tv_sec + 1e-9*(double)now.tv_nsec;
+}
+
+static bool same_doubles(const double *a, const double *b, size_t n)
+{
+    return memcmp(a,b,n*sizeof(double)) == 0;
+}
+
+// First tick that differs from the flight log, the log holds the state after each tick
+static bool compare_flight_log(struct replay_t *replay, const struct recorder_t *recorder)
+{
+    rewind_replay(replay);
+
+    const struct lander_t *lander = replay->lander;
+    size_t count = record_count(recorder);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!step_replay(replay))
+        {
+            printf("Flight log : replay stopped at tick %" PRIu64 ", %zu ticks logged\n",replay->tick,count);
+            return false;
+        }
+
+        const struct flight_record_t *record = get_record(recorder,i);
+        double thrust[3] = {lander->thrust.x,lander->thrust.z,lander->thrust.norm};
+        double logged[3] = {record->thrust_x,record->thrust_z,record->thrust_norm};
+
+        if (record->time != lander->time || !same_doubles(record->state,lander->state,TRAJECTORY_DIM)
+            || !same_doubles(logged,thrust,3))
+        {
+            printf("Flight log : tick %zu differs, t = %.17g s logged, %.17g s replayed\n",
+                i+1,record->time,lander->time);
+            return false;
+        }
+    }
+
+    printf("Flight log : %zu ticks identical\n",count);
+
+    return true;
+}
+
+// Seek to scattered ticks, backwards and forwards, and compare with the straight replay
+static bool check_seeks(struct replay_t *replay)
+{
+    const int seeks = 200;
+
+    rewind_replay(replay);
+
+    size_t capacity = 1024, ticks = 0;
+    double *states = malloc(capacity*(TRAJECTORY_DIM+1)*sizeof(double));
+    if (states == NULL) return false;
+
+    // State at the start of every tick
+    do
+    {
+        if (ticks == capacity)
+        {
+            capacity *= 2;
+            double *grown = realloc(states,capacity*(TRAJECTORY_DIM+1)*sizeof(double));
+            if (grown == NULL)
+            {
+                free(states);
+                return false;
+            }
+            states = grown;
+        }
+
+        double *s = states + ticks*(TRAJECTORY_DIM+1);
+        s[0] = replay->lander->time;
+        memcpy(s+1,replay->lander->state,TRAJECTORY_DIM*sizeof(double));
+        ticks++;
+    }
+    while (step_replay(replay));
+
+    unsigned long long seed = 1;
+    int mismatches = 0;
+    double start = wall_time();
+
+    for (int k = 0; k < seeks; k++)
+    {
+        seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+        size_t tick = (size_t)((seed >> 33) % ticks);
+
+        seek_replay(replay,tick);
+
+        const double *s = states + tick*(TRAJECTORY_DIM+1);
+
+        if (replay->tick != tick || s[0] != replay->lander->time
+            || !same_doubles(s+1,replay->lander->state,TRAJECTORY_DIM))
+            mismatches++;
+    }
+
+    double elapsed = wall_time() - start;
+
+    printf("Seek check : %d of %d seeks identical, %.3f ms per seek over %zu ticks, %zu snapshots\n",
+        seeks-mismatches,seeks,1e3*elapsed/seeks,ticks,replay->snapshot_count);
+
+    free(states);
+
+    return mismatches == 0;
+}
+
+int main(int argc, char** argv)
+{
+    int repeat = 1;
+    const char *log_path = NULL;
+    double seek_time = -1.0;
+    bool check = false;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i+1 < argc);
+
+        if (strcmp(argv[i],"-h") == 0)
+        {
+            print_usage();
+            return 0;
+        }
+        else if (strcmp(argv[i],"-n") == 0 && has_value) repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i],"-l") == 0 && has_value) log_path = argv[++i];
+        else if (strcmp(argv[i],"-s") == 0 && has_value) seek_time = atof(argv[++i]);
+        else if (strcmp(argv[i],"-c") == 0) check = true;
+        else if (argv[i][0] != '-' && path == NULL) path = argv[i];
+        else
+        {
+            print_usage();
+            return -1;
+        }
+    }
+
+    if (path == NULL || repeat < 1)
+    {
+        print_usage();
+        return -1;
+    }
+
+    struct replay_t *replay = load_replay(path);
+    if (replay == NULL)
+    {
+        printf("Failed to load input log %s (version %d expected)\n",path,REPLAY_VERSION);
+        return -1;
+    }
+
+    bool success = true;
+
+    // Straight replays, the first one takes the snapshots
+    double start = wall_time();
+    for (int k = 0; k < repeat; k++)
+    {
+        rewind_replay(replay);
+        while (step_replay(replay));
+    }
+    double elapsed = wall_time() - start;
+
+    printf("Replay : %" PRIu64 " ticks, %zu inputs, %.3f ms per replay, %.1f Mticks/s\n",
+        replay->tick,replay->event_count,1e3*elapsed/repeat,1e-6*replay->tick*repeat/elapsed);
+    print_current_state(replay->lander);
+
+    if (log_path != NULL)
+    {
+        struct recorder_t *recorder = open_recorder(log_path);
+        if (recorder == NULL)
+        {
+            printf("Failed to open flight log %s\n",log_path);
+            success = false;
+        }
+        else
+        {
+            success = compare_flight_log(replay,recorder) && success;
+            close_recorder(recorder);
+        }
+    }
+
+    if (seek_time >= 0.0)
+    {
+        uint64_t tick = (uint64_t)llround(seek_time/FORWARD_TIME_STEP);
+
+        if (!seek_replay(replay,tick)) printf("Seek : session ends at tick %" PRIu64 "\n",replay->tick);
+        else printf("Seek : tick %" PRIu64 "\n",tick);
+
+        print_current_state(replay->lander);
+    }
+
+    if (check) success = check_seeks(replay) && success;
+
+    free_replay(replay);
+
+    return success ? 0 : -1;
+}
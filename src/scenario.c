@@ -0,0 +1,342 @@
+#include "marslanding/scenario.h"
+
+#include "marslanding/dynamics.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+const double SCENE_MIN_Z = -500.0; // in m
+const double SCENE_MAX_Z = 2000.0; // in m
+const double SCENE_MIN_X = -500.0; // in m
+const double SCENE_MAX_X = 4500.0; // in m
+
+const double SCENARIO_CHECK_PERIOD = 0.5; // in s of wall time between file checks
+
+// File key of a parameter and where it is stored
+struct scenario_field_t
+{
+    const char *key;
+    size_t offset;
+    bool integer;
+};
+
+static const struct scenario_field_t SCENARIO_FIELDS[] = {
+    {"dry_mass", offsetof(struct scenario_t,vehicle.dry_mass), false},
+    {"wet_mass", offsetof(struct scenario_t,vehicle.wet_mass), false},
+    {"isp", offsetof(struct scenario_t,vehicle.isp), false},
+    {"nb_thrusters", offsetof(struct scenario_t,vehicle.nb_thrusters), true},
+    {"t_1", offsetof(struct scenario_t,vehicle.t_1), false},
+    {"t_2", offsetof(struct scenario_t,vehicle.t_2), false},
+    {"t_bar", offsetof(struct scenario_t,vehicle.t_bar), false},
+    {"phi", offsetof(struct scenario_t,vehicle.phi), false},
+    {"px", offsetof(struct scenario_t,initial_state[0]), false},
+    {"pz", offsetof(struct scenario_t,initial_state[1]), false},
+    {"vx", offsetof(struct scenario_t,initial_state[2]), false},
+    {"vz", offsetof(struct scenario_t,initial_state[3]), false},
+    {"m", offsetof(struct scenario_t,initial_state[4]), false},
+    {"scene_min_x", offsetof(struct scenario_t,scene_min_x), false},
+    {"scene_max_x", offsetof(struct scenario_t,scene_max_x), false},
+    {"scene_min_z", offsetof(struct scenario_t,scene_min_z), false},
+    {"scene_max_z", offsetof(struct scenario_t,scene_max_z), false},
+};
+
+const size_t SCENARIO_FIELD_COUNT = sizeof(SCENARIO_FIELDS)/sizeof(SCENARIO_FIELDS[0]);
+
+// Default vehicle, initial state and scene
+void init_scenario(struct scenario_t *scenario)
+{
+    memset(scenario,0,sizeof(struct scenario_t));
+
+    snprintf(scenario->name,sizeof(scenario->name),"default");
+    init_vehicle(&scenario->vehicle);
+    for (int i = 0; i < TRAJECTORY_DIM; i++) scenario->initial_state[i] = INITIAL_STATE[i];
+
+    scenario->scene_min_x = SCENE_MIN_X;
+    scenario->scene_max_x = SCENE_MAX_X;
+    scenario->scene_min_z = SCENE_MIN_Z;
+    scenario->scene_max_z = SCENE_MAX_Z;
+}
+
+static const struct scenario_field_t* find_field(const char *key, size_t length)
+{
+    for (size_t i = 0; i < SCENARIO_FIELD_COUNT; i++)
+    {
+        if (strlen(SCENARIO_FIELDS[i].key) == length && strncmp(SCENARIO_FIELDS[i].key,key,length) == 0)
+            return &SCENARIO_FIELDS[i];
+    }
+
+    return NULL;
+}
+
+static void set_field(struct scenario_t *scenario, const struct scenario_field_t *field, double value)
+{
+    char *base = (char*)scenario + field->offset;
+
+    if (field->integer)
+        *(int*)base = (int)value;
+    else
+        *(double*)base = value;
+}
+
+// Integers are whole numbers that fit an int, the cast of any other value is undefined
+static bool fits_field(const struct scenario_field_t *field, double value)
+{
+    if (!field->integer) return true;
+
+    return value == floor(value) && value >= (double)INT_MIN && value <= (double)INT_MAX;
+}
+
+// Set a parameter by its file key, false for an unknown key or a value the key cannot hold.
+// Derive the vehicle again after it.
+bool set_scenario_value(struct scenario_t *scenario, const char *key, double value)
+{
+    const struct scenario_field_t *field = find_field(key,strlen(key));
+    if (field == NULL || !fits_field(field,value)) return false;
+
+    set_field(scenario,field,value);
+
+    return true;
+}
+
+// Check physical consistency, error holds the reason when false
+bool validate_scenario(const struct scenario_t *scenario, char *error, size_t size)
+{
+    const struct vehicle_t *vehicle = &scenario->vehicle;
+    const double *state = scenario->initial_state;
+
+    for (size_t i = 0; i < SCENARIO_FIELD_COUNT; i++)
+    {
+        const struct scenario_field_t *field = &SCENARIO_FIELDS[i];
+        if (field->integer) continue;
+
+        if (!isfinite(*(const double*)((const char*)scenario + field->offset)))
+        {
+            snprintf(error,size,"%s is not a finite number",field->key);
+            return false;
+        }
+    }
+
+    const char *reason = NULL;
+
+    if (vehicle->dry_mass <= 0.0) reason = "dry_mass must be positive";
+    else if (vehicle->wet_mass <= vehicle->dry_mass) reason = "wet_mass must exceed dry_mass";
+    else if (vehicle->isp <= 0.0) reason = "isp must be positive";
+    else if (vehicle->nb_thrusters < 1) reason = "nb_thrusters must be at least 1";
+    else if (vehicle->t_1 <= 0.0 || vehicle->t_1 >= vehicle->t_2 || vehicle->t_2 > 1.0) reason = "throttle needs 0 < t_1 < t_2 <= 1";
+    else if (vehicle->t_bar <= 0.0) reason = "t_bar must be positive";
+    else if (vehicle->phi < 0.0 || vehicle->phi >= 90.0) reason = "phi must be in [0,90) deg";
+    else if (state[PZ] < 0.0) reason = "pz must not be below the ground";
+    else if (state[M] < vehicle->dry_mass || state[M] > vehicle->wet_mass) reason = "m must be between dry_mass and wet_mass";
+    else if (scenario->scene_min_x >= scenario->scene_max_x) reason = "scene_min_x must be below scene_max_x";
+    else if (scenario->scene_min_z >= 0.0 || scenario->scene_max_z <= 0.0) reason = "the scene must show the ground, scene_min_z < 0 < scene_max_z";
+
+    if (reason != NULL)
+    {
+        snprintf(error,size,"%s",reason);
+        return false;
+    }
+
+    return true;
+}
+
+static bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parse key = value lines over the defaults, then derive and validate. Missing m is the wet mass.
+bool parse_scenario(const char *text, size_t length, struct scenario_t *scenario, char *error, size_t size)
+{
+    struct scenario_t parsed;
+    init_scenario(&parsed);
+
+    const char *end = text + length;
+    bool has_mass = false;
+    int line = 0;
+
+    for (const char *p = text; p < end; )
+    {
+        line++;
+
+        const char *eol = memchr(p,'\n',end-p);
+        if (eol == NULL) eol = end;
+
+        // Comments run to the end of the line
+        const char *stop = memchr(p,'#',eol-p);
+        if (stop == NULL) stop = eol;
+
+        while (p < stop && is_blank(*p)) p++;
+        while (stop > p && is_blank(stop[-1])) stop--;
+
+        if (p == stop)
+        {
+            p = eol + 1;
+            continue;
+        }
+
+        const char *equal = memchr(p,'=',stop-p);
+        if (equal == NULL)
+        {
+            snprintf(error,size,"line %d: key = value expected",line);
+            return false;
+        }
+
+        const char *key_end = equal;
+        while (key_end > p && is_blank(key_end[-1])) key_end--;
+
+        const char *value = equal + 1;
+        while (value < stop && is_blank(*value)) value++;
+
+        size_t key_length = key_end - p;
+        size_t value_length = stop - value;
+
+        if (key_length == 4 && strncmp(p,"name",4) == 0)
+        {
+            if (value_length >= sizeof(parsed.name)) value_length = sizeof(parsed.name)-1;
+            memcpy(parsed.name,value,value_length);
+            parsed.name[value_length] = '\0';
+            p = eol + 1;
+            continue;
+        }
+
+        const struct scenario_field_t *field = find_field(p,key_length);
+        if (field == NULL)
+        {
+            snprintf(error,size,"line %d: unknown key %.*s",line,(int)key_length,p);
+            return false;
+        }
+
+        // Values are numbers only, copied out as the text is not terminated
+        char number[64];
+        char *number_end = NULL;
+
+        if (value_length == 0 || value_length >= sizeof(number))
+        {
+            snprintf(error,size,"line %d: bad value for %s",line,field->key);
+            return false;
+        }
+
+        memcpy(number,value,value_length);
+        number[value_length] = '\0';
+
+        double x = strtod(number,&number_end);
+        if (*number_end != '\0' || !fits_field(field,x))
+        {
+            snprintf(error,size,"line %d: bad value for %s",line,field->key);
+            return false;
+        }
+
+        set_field(&parsed,field,x);
+        if (field->offset == offsetof(struct scenario_t,initial_state[4])) has_mass = true;
+
+        p = eol + 1;
+    }
+
+    if (!has_mass) parsed.initial_state[M] = parsed.vehicle.wet_mass;
+
+    derive_vehicle(&parsed.vehicle);
+
+    if (!validate_scenario(&parsed,error,size)) return false;
+
+    *scenario = parsed;
+
+    return true;
+}
+
+// Load, derive and validate a scenario file, the scenario is unchanged on error
+bool load_scenario(const char *path, struct scenario_t *scenario, char *error, size_t size)
+{
+    FILE *file = fopen(path,"rb");
+    if (file == NULL)
+    {
+        snprintf(error,size,"cannot open %s",path);
+        return false;
+    }
+
+    char *text = NULL;
+    long length = -1;
+
+    if (fseek(file,0,SEEK_END) == 0) length = ftell(file);
+
+    if (length >= 0 && fseek(file,0,SEEK_SET) == 0) text = malloc(length + 1);
+
+    bool read = text != NULL && fread(text,1,length,file) == (size_t)length;
+    fclose(file);
+
+    if (!read)
+    {
+        free(text);
+        snprintf(error,size,"cannot read %s",path);
+        return false;
+    }
+
+    bool parsed = parse_scenario(text,length,scenario,error,size);
+    free(text);
+
+    return parsed;
+}
+
+static bool modified_time(const char *path, struct timespec *modified)
+{
+    struct stat info;
+    if (stat(path,&info) != 0) return false;
+
+    *modified = info.st_mtim;
+
+    return true;
+}
+
+// Start watching a loaded scenario file
+void watch_scenario(struct scenario_watch_t *watch, const char *path)
+{
+    watch->path = path;
+    watch->next_check = 0.0;
+
+    if (!modified_time(path,&watch->modified))
+    {
+        watch->modified.tv_sec = 0;
+        watch->modified.tv_nsec = 0;
+    }
+}
+
+// Reload the file when it changed since the last load, at most every SCENARIO_CHECK_PERIOD.
+// True when the scenario was replaced, an invalid file keeps the scenario and fills error.
+bool reload_scenario(struct scenario_watch_t *watch, double now, struct scenario_t *scenario,
+    char *error, size_t size)
+{
+    error[0] = '\0';
+
+    if (watch->path == NULL || now < watch->next_check) return false;
+    watch->next_check = now + SCENARIO_CHECK_PERIOD;
+
+    struct timespec modified;
+    if (!modified_time(watch->path,&modified)) return false;
+
+    if (modified.tv_sec == watch->modified.tv_sec && modified.tv_nsec == watch->modified.tv_nsec) return false;
+
+    // An invalid version is reported once, the next save is tried again
+    watch->modified = modified;
+
+    return load_scenario(watch->path,scenario,error,size);
+}
+
+void print_scenario(const struct scenario_t *scenario)
+{
+    const struct vehicle_t *vehicle = &scenario->vehicle;
+
+    printf("Scenario %s\n{\n",scenario->name);
+    printf("  dry %.1f kg, wet %.1f kg, isp %.1f s\n",vehicle->dry_mass,vehicle->wet_mass,vehicle->isp);
+    printf("  %d thrusters of %.1f N, throttle %.2f to %.2f, cant %.1f deg\n",vehicle->nb_thrusters,
+        vehicle->t_bar,vehicle->t_1,vehicle->t_2,vehicle->phi);
+    printf("  |T| from %.1f N to %.1f N\n",vehicle->rho_1,vehicle->rho_2);
+
+    for (int i = 0; i < STATE_DIM; i++)
+        printf("  %s = %.2f %s\n",STATE_NAMES[i],scenario->initial_state[i],STATE_UNITS[i]);
+
+    printf("}\n");
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 
 #include "marslanding/sdl_utils.h"
+#include "marslanding/render.h"
 
 // Main window 
 SDL_Window *window = NULL;
@@ -9,6 +10,7 @@ SDL_Window *window = NULL;
 SDL_Renderer *screen = NULL;
 const int SCREEN_WIDTH = 1200; // 1366  640;  
 const int SCREEN_HEIGHT = 650;// 650   480;
+const bool VSYNC = false; // present synchronized with the display refresh
 
 // Gamepad 
 SDL_Joystick* gamepad = NULL;
@@ -17,6 +19,72 @@ const bool JOY_MANDATORY = true;
 
 struct timer_t timer;
 
+// Cached layer of the SDL backend, window sized
+SDL_Texture *layer = NULL;
+
+static void sdl_set_color(void *context, int r, int g, int b, int a)
+{
+    SDL_SetRenderDrawColor(context, r, g, b, a);
+}
+
+static void sdl_clear(void *context)
+{
+    SDL_RenderClear(context);
+}
+
+// Render types have the layout of the SDL ones
+static void sdl_fill_rects(void *context, const struct render_rect_t *rects, int count)
+{
+    SDL_RenderFillRects(context,(const SDL_Rect*)rects,count);
+}
+
+static void sdl_draw_lines(void *context, const struct render_point_t *points, int count)
+{
+    SDL_RenderDrawLines(context,(const SDL_Point*)points,count);
+}
+
+static void sdl_draw_points(void *context, const struct render_point_t *points, int count)
+{
+    SDL_RenderDrawPoints(context,(const SDL_Point*)points,count);
+}
+
+static bool sdl_begin_layer(void *context)
+{
+    if (layer == NULL)
+    {
+        int width = 0, height = 0;
+        if (SDL_GetRendererOutputSize(context,&width,&height) != 0) return false;
+
+        layer = SDL_CreateTexture(context,SDL_PIXELFORMAT_RGBA8888,SDL_TEXTUREACCESS_TARGET,width,height);
+        if (layer == NULL) return false;
+
+        SDL_SetTextureBlendMode(layer,SDL_BLENDMODE_NONE);
+    }
+
+    return SDL_SetRenderTarget(context,layer) == 0;
+}
+
+static void sdl_end_layer(void *context)
+{
+    SDL_SetRenderTarget(context,NULL);
+}
+
+static bool sdl_draw_layer(void *context)
+{
+    return layer != NULL && SDL_RenderCopy(context,layer,NULL,NULL) == 0;
+}
+
+static void sdl_drop_layer(void *context)
+{
+    (void)context;
+
+    if (layer != NULL) SDL_DestroyTexture(layer);
+    layer = NULL;
+}
+
+struct render_backend_t sdl_backend = {"sdl", NULL, sdl_set_color, sdl_clear, sdl_fill_rects,
+    sdl_draw_lines, sdl_draw_points, sdl_begin_layer, sdl_end_layer, sdl_draw_layer, sdl_drop_layer};
+
 // Initialize SDL, the window and the screen
 bool init_sdl()
 {
@@ -40,8 +108,9 @@ bool init_sdl()
     }
 
     // Create screen renderer for window
-    screen = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    // screen = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+    Uint32 flags = SDL_RENDERER_ACCELERATED;
+    if (VSYNC) flags |= SDL_RENDERER_PRESENTVSYNC;
+    screen = SDL_CreateRenderer(window, -1, flags);
     if(screen == NULL)
     {
         printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
@@ -50,6 +119,9 @@ bool init_sdl()
 
     SDL_SetRenderDrawBlendMode(screen, SDL_BLENDMODE_BLEND);
 
+    sdl_backend.context = screen;
+    renderer = &sdl_backend;
+
     // Initial joystick if wanted
     if(JOY_MANDATORY)
     {
@@ -83,8 +155,22 @@ bool init_joystick()
 // Initialize timer
 void init_timer()
 {
-    timer.current_tick = SDL_GetTicks();
+    timer.current_tick = SDL_GetPerformanceCounter();
     timer.previous_tick = timer.current_tick;
+    timer.accumulator = 0.0;
+}
+
+// Seconds elapsed since previous update or initialization
+double update_timer()
+{
+    timer.current_tick = SDL_GetPerformanceCounter();
+
+    double elapsed = (double)(timer.current_tick-timer.previous_tick);
+    elapsed /= (double)SDL_GetPerformanceFrequency();
+
+    timer.previous_tick = timer.current_tick;
+
+    return elapsed;
 }
 
 // Destroy screen + window and quit SDL
@@ -94,6 +180,9 @@ void quit_sdl()
     SDL_JoystickClose(gamepad);
     gamepad = NULL;
     
+    sdl_drop_layer(screen);
+    renderer = NULL;
+
     // Destroy window	
 	SDL_DestroyRenderer(screen);
 	SDL_DestroyWindow(window);
@@ -0,0 +1,674 @@
+#include "marslanding/socp.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const int SOCP_MAX_ITERATIONS_COUNT = 40;
+const double SOCP_FEASIBILITY_TOLERANCE = 1e-7;
+const double SOCP_ABSOLUTE_TOLERANCE = 1e-7;
+const double SOCP_RELATIVE_TOLERANCE = 1e-6;
+
+const double SOCP_STEP_FRACTION = 0.99; // of the largest step to the cone boundary
+const double SOCP_REGULARIZATION = 1e-10; // added to the normal equations diagonal
+const double SOCP_DIVERGENCE = 1e12; // iterates larger than this are not converging
+
+// Scaling, factorization and step vectors, reused between iterations and solves
+struct socp_workspace_t
+{
+    double *w; // m, linear scalings then normalized cone scaling vectors
+    double *eta; // nb_cones
+    double *lambda; // m, scaled point W z = W^-1 s
+
+    double *Gs; // m x n, W^-1 G
+    double *H; // n x n, Cholesky factor of G'W^-2 G
+    double *HA; // n x p, H^-1 A'
+    double *S; // p x p, Cholesky factor of A H^-1 A'
+
+    double *rx, *ry, *rz; // residuals
+    double *dx, *dy, *dz, *ds; // search direction
+    double *target; // m, complementarity right hand side
+    double *rhs_x, *rhs_y, *rhs_z;
+    double *t1, *t2, *t3; // m
+    double *scaled, *product; // m, used by solve_kkt
+    double *tn; // n
+};
+
+static double dot(const double *a, const double *b, size_t n)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) sum += a[i]*b[i];
+    return sum;
+}
+
+static double norm(const double *a, size_t n)
+{
+    return sqrt(dot(a,a,n));
+}
+
+// Carve size doubles from a block
+static double* take(double **block, size_t size)
+{
+    double *array = *block;
+    *block += size;
+    return array;
+}
+
+// Allocate a zeroed problem, cone_dims holds nb_cones dimensions of at least 2
+struct socp_t* create_socp(size_t n, size_t p, size_t l, size_t nb_cones, const size_t *cone_dims)
+{
+    struct socp_t *socp = calloc(1,sizeof(struct socp_t));
+    if (socp == NULL) return NULL;
+
+    socp->n = n;
+    socp->p = p;
+    socp->l = l;
+    socp->nb_cones = nb_cones;
+    socp->m = l;
+
+    socp->max_iterations = SOCP_MAX_ITERATIONS_COUNT;
+    socp->deadline = INFINITY;
+
+    socp->cone_dims = malloc((nb_cones+1)*sizeof(size_t));
+    socp->work = calloc(1,sizeof(struct socp_workspace_t));
+    if (socp->cone_dims == NULL || socp->work == NULL) return free_socp(socp);
+
+    for (size_t k = 0; k < nb_cones; k++)
+    {
+        socp->cone_dims[k] = cone_dims[k];
+        socp->m += cone_dims[k];
+    }
+
+    size_t m = socp->m;
+
+    // Problem data, solution and workspace in a single block
+    size_t problem = n + p*n + p + m*n + m + n + p + 2*m;
+    size_t work = 2*m + nb_cones + m*n + n*n + n*p + p*p + (n+p+m) + (n+p+2*m) + m + (n+p+m)
+        + 3*m + 2*m + n;
+
+    double *block = calloc(problem + work,sizeof(double));
+    if (block == NULL) return free_socp(socp);
+
+    double *next = block;
+
+    socp->c = take(&next,n);
+    socp->A = take(&next,p*n);
+    socp->b = take(&next,p);
+    socp->G = take(&next,m*n);
+    socp->h = take(&next,m);
+    socp->x = take(&next,n);
+    socp->y = take(&next,p);
+    socp->z = take(&next,m);
+    socp->s = take(&next,m);
+
+    struct socp_workspace_t *ws = socp->work;
+    ws->w = take(&next,m);
+    ws->lambda = take(&next,m);
+    ws->eta = take(&next,nb_cones);
+    ws->Gs = take(&next,m*n);
+    ws->H = take(&next,n*n);
+    ws->HA = take(&next,n*p);
+    ws->S = take(&next,p*p);
+    ws->rx = take(&next,n);
+    ws->ry = take(&next,p);
+    ws->rz = take(&next,m);
+    ws->dx = take(&next,n);
+    ws->dy = take(&next,p);
+    ws->dz = take(&next,m);
+    ws->ds = take(&next,m);
+    ws->target = take(&next,m);
+    ws->rhs_x = take(&next,n);
+    ws->rhs_y = take(&next,p);
+    ws->rhs_z = take(&next,m);
+    ws->t1 = take(&next,m);
+    ws->t2 = take(&next,m);
+    ws->t3 = take(&next,m);
+    ws->scaled = take(&next,m);
+    ws->product = take(&next,m);
+    ws->tn = take(&next,n);
+
+    return socp;
+}
+
+// Free memory for a problem
+struct socp_t* free_socp(struct socp_t *socp)
+{
+    if (socp == NULL) return NULL;
+
+    free(socp->c);
+    free(socp->work);
+    free(socp->cone_dims);
+    free(socp);
+
+    return NULL;
+}
+
+// Zero the problem data before filling it again
+void clear_socp(struct socp_t *socp)
+{
+    memset(socp->c,0,socp->n*sizeof(double));
+    memset(socp->A,0,socp->p*socp->n*sizeof(double));
+    memset(socp->b,0,socp->p*sizeof(double));
+    memset(socp->G,0,socp->m*socp->n*sizeof(double));
+    memset(socp->h,0,socp->m*sizeof(double));
+}
+
+// y = W x, or W^-1 x, in place allowed
+static void scale(const struct socp_t *socp, const double *x, double *y, bool inverse)
+{
+    const struct socp_workspace_t *ws = socp->work;
+
+    for (size_t i = 0; i < socp->l; i++)
+        y[i] = inverse ? x[i]/ws->w[i] : x[i]*ws->w[i];
+
+    size_t offset = socp->l;
+
+    for (size_t k = 0; k < socp->nb_cones; k++)
+    {
+        size_t dim = socp->cone_dims[k];
+        const double *w = ws->w + offset;
+        const double *u = x + offset;
+        double *v = y + offset;
+
+        // W = eta*[w0 w1'; w1 I + w1w1'/(1+w0)], the inverse flips w1 and divides by eta
+        double sign = inverse ? -1.0 : 1.0;
+        double factor = inverse ? 1.0/ws->eta[k] : ws->eta[k];
+
+        double u0 = u[0];
+        double projection = dot(w+1,u+1,dim-1);
+        double coefficient = sign*u0 + projection/(1.0+w[0]);
+
+        v[0] = factor*(w[0]*u0 + sign*projection);
+        for (size_t j = 1; j < dim; j++) v[j] = factor*(u[j] + coefficient*w[j]);
+
+        offset += dim;
+    }
+}
+
+// Jordan product u o v
+static void cone_product(const struct socp_t *socp, const double *u, const double *v, double *out)
+{
+    for (size_t i = 0; i < socp->l; i++) out[i] = u[i]*v[i];
+
+    size_t offset = socp->l;
+
+    for (size_t k = 0; k < socp->nb_cones; k++)
+    {
+        size_t dim = socp->cone_dims[k];
+        const double *a = u + offset, *b = v + offset;
+        double *c = out + offset;
+
+        c[0] = dot(a,b,dim);
+        for (size_t j = 1; j < dim; j++) c[j] = a[0]*b[j] + b[0]*a[j];
+
+        offset += dim;
+    }
+}
+
+// Solve lambda o out = d
+static void cone_divide(const struct socp_t *socp, const double *lambda, const double *d, double *out)
+{
+    for (size_t i = 0; i < socp->l; i++) out[i] = d[i]/lambda[i];
+
+    size_t offset = socp->l;
+
+    for (size_t k = 0; k < socp->nb_cones; k++)
+    {
+        size_t dim = socp->cone_dims[k];
+        const double *a = lambda + offset, *b = d + offset;
+        double *c = out + offset;
+
+        double determinant = a[0]*a[0] - dot(a+1,a+1,dim-1);
+
+        c[0] = (a[0]*b[0] - dot(a+1,b+1,dim-1))/determinant;
+        for (size_t j = 1; j < dim; j++) c[j] = (b[j] - c[0]*a[j])/a[0];
+
+        offset += dim;
+    }
+}
+
+// Add alpha times the identity element of the cone
+static void add_identity(const struct socp_t *socp, double *u, double alpha)
+{
+    for (size_t i = 0; i < socp->l; i++) u[i] += alpha;
+
+    size_t offset = socp->l;
+
+    for (size_t k = 0; k < socp->nb_cones; k++)
+    {
+        u[offset] += alpha;
+        offset += socp->cone_dims[k];
+    }
+}
+
+// Smallest eigenvalue of a cone element, negative outside the cone
+static double min_eigenvalue(const struct socp_t *socp, const double *u)
+{
+    double eigenvalue = INFINITY;
+
+    for (size_t i = 0; i < socp->l; i++) eigenvalue = fmin(eigenvalue,u[i]);
+
+    size_t offset = socp->l;
+
+    for (size_t k = 0; k < socp->nb_cones; k++)
+    {
+        size_t dim = socp->cone_dims[k];
+        eigenvalue = fmin(eigenvalue,u[offset] - norm(u+offset+1,dim-1));
+        offset += dim;
+    }
+
+    return eigenvalue;
+}
+
+// Largest step along du keeping u in the cone, INFINITY when unbounded
+static double max_step(const struct socp_t *socp, const double *u, const double *du)
+{
+    double step = INFINITY;
+
+    for (size_t i = 0; i < socp->l; i++)
+    {
+        if (du[i] < 0.0) step = fmin(step,-u[i]/du[i]);
+    }
+
+    size_t offset = socp->l;
+
+    for (size_t k = 0; k < socp->nb_cones; k++)
+    {
+        size_t dim = socp->cone_dims[k];
+        const double *s = u + offset, *d = du + offset;
+
+        // First positive root of (s0+t*d0)^2 - |s1+t*d1|^2
+        double a = d[0]*d[0] - dot(d+1,d+1,dim-1);
+        double b = 2.0*(s[0]*d[0] - dot(s+1,d+1,dim-1));
+        double c = s[0]*s[0] - dot(s+1,s+1,dim-1);
+
+        if (a == 0.0)
+        {
+            if (b < 0.0) step = fmin(step,-c/b);
+        }
+        else
+        {
+            double discriminant = b*b - 4.0*a*c;
+
+            if (discriminant >= 0.0)
+            {
+                double q = -0.5*(b + copysign(sqrt(discriminant),b));
+                double roots[2] = {q/a, (q != 0.0) ? c/q : INFINITY};
+
+                for (int i = 0; i < 2; i++)
+                {
+                    if (roots[i] > 0.0) step = fmin(step,roots[i]);
+                }
+            }
+        }
+
+        offset += dim;
+    }
+
+    return step;
+}
+
+// Nesterov-Todd scaling of the current s and z, false when they left the cone
+static bool compute_scaling(struct socp_t *socp)
+{
+    struct socp_workspace_t *ws = socp->work;
+    const double *s = socp->s, *z = socp->z;
+
+    for (size_t i = 0; i < socp->l; i++)
+    {
+        if (!(s[i] > 0.0 && z[i] > 0.0)) return false;
+        ws->w[i] = sqrt(s[i]/z[i]);
+    }
+
+    size_t offset = socp->l;
+
+    for (size_t k = 0; k < socp->nb_cones; k++)
+    {
+        size_t dim = socp->cone_dims[k];
+        const double *sk = s + offset, *zk = z + offset;
+        double *w = ws->w + offset;
+
+        double s_norm = sk[0]*sk[0] - dot(sk+1,sk+1,dim-1);
+        double z_norm = zk[0]*zk[0] - dot(zk+1,zk+1,dim-1);
+        if (!(sk[0] > 0.0 && zk[0] > 0.0 && s_norm > 0.0 && z_norm > 0.0)) return false;
+
+        s_norm = sqrt(s_norm);
+        z_norm = sqrt(z_norm);
+
+        double gamma = sqrt(0.5*(1.0 + dot(sk,zk,dim)/(s_norm*z_norm)));
+
+        w[0] = (sk[0]/s_norm + zk[0]/z_norm)/(2.0*gamma);
+        for (size_t j = 1; j < dim; j++) w[j] = (sk[j]/s_norm - zk[j]/z_norm)/(2.0*gamma);
+
+        ws->eta[k] = sqrt(s_norm/z_norm);
+
+        offset += dim;
+    }
+
+    scale(socp,z,ws->lambda,false);
+
+    return true;
+}
+
+// Identity scaling, used for the starting point
+static void identity_scaling(struct socp_t *socp)
+{
+    struct socp_workspace_t *ws = socp->work;
+
+    memset(ws->w,0,socp->m*sizeof(double));
+    for (size_t i = 0; i < socp->l; i++) ws->w[i] = 1.0;
+
+    size_t offset = socp->l;
+
+    for (size_t k = 0; k < socp->nb_cones; k++)
+    {
+        ws->w[offset] = 1.0;
+        ws->eta[k] = 1.0;
+        offset += socp->cone_dims[k];
+    }
+}
+
+// In place Cholesky factor L of a symmetric positive definite matrix, lower part
+static bool cholesky(double *a, size_t n)
+{
+    for (size_t j = 0; j < n; j++)
+    {
+        double *row_j = a + j*n;
+
+        double diagonal = row_j[j] - dot(row_j,row_j,j);
+        if (!(diagonal > 0.0)) return false;
+
+        row_j[j] = sqrt(diagonal);
+
+        for (size_t i = j+1; i < n; i++)
+        {
+            double *row_i = a + i*n;
+            row_i[j] = (row_i[j] - dot(row_i,row_j,j))/row_j[j];
+        }
+    }
+
+    return true;
+}
+
+// Solve L L' x = b in place
+static void cholesky_solve(const double *L, size_t n, double *x)
+{
+    for (size_t i = 0; i < n; i++)
+        x[i] = (x[i] - dot(L+i*n,x,i))/L[i*n+i];
+
+    for (size_t i = n; i-- > 0; )
+    {
+        double sum = x[i];
+        for (size_t k = i+1; k < n; k++) sum -= L[k*n+i]*x[k];
+        x[i] = sum/L[i*n+i];
+    }
+}
+
+// Factor the reduced KKT system for the current scaling
+static bool factor_kkt(struct socp_t *socp)
+{
+    struct socp_workspace_t *ws = socp->work;
+    size_t n = socp->n, m = socp->m, p = socp->p;
+
+    // Gs = W^-1 G, column by column
+    for (size_t j = 0; j < n; j++)
+    {
+        for (size_t i = 0; i < m; i++) ws->t1[i] = socp->G[i*n+j];
+
+        scale(socp,ws->t1,ws->t1,true);
+
+        for (size_t i = 0; i < m; i++) ws->Gs[i*n+j] = ws->t1[i];
+    }
+
+    // H = Gs'Gs, lower part
+    memset(ws->H,0,n*n*sizeof(double));
+
+    for (size_t i = 0; i < m; i++)
+    {
+        const double *row = ws->Gs + i*n;
+
+        for (size_t j = 0; j < n; j++)
+        {
+            if (row[j] == 0.0) continue;
+
+            double *H_j = ws->H + j*n;
+            for (size_t k = 0; k <= j; k++) H_j[k] += row[j]*row[k];
+        }
+    }
+
+    for (size_t j = 0; j < n; j++) ws->H[j*n+j] += SOCP_REGULARIZATION;
+
+    if (!cholesky(ws->H,n)) return false;
+
+    if (p == 0) return true;
+
+    // Schur complement of the equality constraints
+    for (size_t i = 0; i < p; i++)
+    {
+        memcpy(ws->tn,socp->A+i*n,n*sizeof(double));
+        cholesky_solve(ws->H,n,ws->tn);
+
+        for (size_t j = 0; j < n; j++) ws->HA[j*p+i] = ws->tn[j];
+    }
+
+    for (size_t i = 0; i < p; i++)
+    {
+        for (size_t k = 0; k <= i; k++)
+        {
+            double sum = 0.0;
+            for (size_t j = 0; j < n; j++) sum += socp->A[i*n+j]*ws->HA[j*p+k];
+
+            ws->S[i*p+k] = sum;
+        }
+    }
+
+    return cholesky(ws->S,p);
+}
+
+// Solve [0 A' G'; A 0 0; G 0 -W'W][dx;dy;dz] = [rx;ry;rz] with the factored system
+static void solve_kkt(struct socp_t *socp, const double *rx, const double *ry, const double *rz,
+    double *dx, double *dy, double *dz)
+{
+    struct socp_workspace_t *ws = socp->work;
+    size_t n = socp->n, m = socp->m, p = socp->p;
+
+    // bx = rx + Gs'W^-1 rz
+    scale(socp,rz,ws->scaled,true);
+
+    for (size_t j = 0; j < n; j++) dx[j] = rx[j];
+
+    for (size_t i = 0; i < m; i++)
+    {
+        const double *row = ws->Gs + i*n;
+        double value = ws->scaled[i];
+
+        if (value == 0.0) continue;
+        for (size_t j = 0; j < n; j++) dx[j] += row[j]*value;
+    }
+
+    if (p > 0)
+    {
+        // dy = S^-1 (A H^-1 bx - ry), then dx = bx - A'dy
+        memcpy(ws->tn,dx,n*sizeof(double));
+        cholesky_solve(ws->H,n,ws->tn);
+
+        for (size_t i = 0; i < p; i++) dy[i] = dot(socp->A+i*n,ws->tn,n) - ry[i];
+        cholesky_solve(ws->S,p,dy);
+
+        for (size_t i = 0; i < p; i++)
+        {
+            for (size_t j = 0; j < n; j++) dx[j] -= socp->A[i*n+j]*dy[i];
+        }
+    }
+
+    cholesky_solve(ws->H,n,dx);
+
+    // W dz = Gs dx - W^-1 rz
+    for (size_t i = 0; i < m; i++)
+        ws->product[i] = dot(ws->Gs+i*n,dx,n) - ws->scaled[i];
+
+    scale(socp,ws->product,dz,true);
+}
+
+// Search direction for a complementarity target lambda o (W dz + W^-1 ds) = target
+static void newton_step(struct socp_t *socp)
+{
+    struct socp_workspace_t *ws = socp->work;
+    size_t n = socp->n, m = socp->m, p = socp->p;
+
+    // W^-1 ds = lambda \ target - W dz
+    cone_divide(socp,ws->lambda,ws->target,ws->t1);
+    scale(socp,ws->t1,ws->t2,false);
+
+    for (size_t j = 0; j < n; j++) ws->rhs_x[j] = -ws->rx[j];
+    for (size_t i = 0; i < p; i++) ws->rhs_y[i] = -ws->ry[i];
+    for (size_t i = 0; i < m; i++) ws->rhs_z[i] = -ws->rz[i] - ws->t2[i];
+
+    solve_kkt(socp,ws->rhs_x,ws->rhs_y,ws->rhs_z,ws->dx,ws->dy,ws->dz);
+
+    scale(socp,ws->dz,ws->t3,false);
+    for (size_t i = 0; i < m; i++) ws->t3[i] = ws->t1[i] - ws->t3[i];
+    scale(socp,ws->t3,ws->ds,false);
+}
+
+// Starting point from least squares problems, shifted into the cone
+static bool initialize(struct socp_t *socp)
+{
+    struct socp_workspace_t *ws = socp->work;
+    size_t n = socp->n, m = socp->m, p = socp->p;
+
+    identity_scaling(socp);
+    if (!factor_kkt(socp)) return false;
+
+    // Primal, minimize |Gx - h| subject to Ax = b
+    memset(ws->rhs_x,0,n*sizeof(double));
+    solve_kkt(socp,ws->rhs_x,socp->b,socp->h,socp->x,ws->dy,ws->dz);
+    for (size_t i = 0; i < m; i++) socp->s[i] = -ws->dz[i];
+
+    // Dual, minimize |z| subject to A'y + G'z + c = 0
+    for (size_t j = 0; j < n; j++) ws->rhs_x[j] = -socp->c[j];
+    memset(ws->rhs_y,0,p*sizeof(double));
+    memset(ws->rhs_z,0,m*sizeof(double));
+    solve_kkt(socp,ws->rhs_x,ws->rhs_y,ws->rhs_z,ws->dx,socp->y,socp->z);
+
+    double shift = -min_eigenvalue(socp,socp->s);
+    if (shift >= 0.0) add_identity(socp,socp->s,1.0+shift);
+
+    shift = -min_eigenvalue(socp,socp->z);
+    if (shift >= 0.0) add_identity(socp,socp->z,1.0+shift);
+
+    return true;
+}
+
+// Monotonic clock in s, for deadlines
+double socp_clock()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC,&now);
+
+    return (double)now.tv_sec + 1e-9*(double)now.tv_nsec;
+}
+
+// Primal-dual interior point with Nesterov-Todd scaling and Mehrotra correction
+enum socp_status_t solve_socp(struct socp_t *socp)
+{
+    struct socp_workspace_t *ws = socp->work;
+    size_t n = socp->n, m = socp->m, p = socp->p;
+    double degree = (double)(socp->l + socp->nb_cones);
+
+    socp->iterations = 0;
+    socp->gap = INFINITY;
+    socp->residual = INFINITY;
+
+    if (!initialize(socp)) return SOCP_NUMERICAL_ERROR;
+
+    double b_norm = fmax(1.0,norm(socp->b,p));
+    double h_norm = fmax(1.0,norm(socp->h,m));
+    double c_norm = fmax(1.0,norm(socp->c,n));
+
+    for (int iteration = 0; iteration <= socp->max_iterations; iteration++)
+    {
+        // rx = A'y + G'z + c, ry = Ax - b, rz = s + Gx - h
+        memcpy(ws->rx,socp->c,n*sizeof(double));
+        for (size_t i = 0; i < p; i++)
+        {
+            for (size_t j = 0; j < n; j++) ws->rx[j] += socp->A[i*n+j]*socp->y[i];
+            ws->ry[i] = dot(socp->A+i*n,socp->x,n) - socp->b[i];
+        }
+        for (size_t i = 0; i < m; i++)
+        {
+            for (size_t j = 0; j < n; j++) ws->rx[j] += socp->G[i*n+j]*socp->z[i];
+            ws->rz[i] = socp->s[i] + dot(socp->G+i*n,socp->x,n) - socp->h[i];
+        }
+
+        double gap = dot(socp->s,socp->z,m);
+        double primal_cost = dot(socp->c,socp->x,n);
+        double dual_cost = -dot(socp->b,socp->y,p) - dot(socp->h,socp->z,m);
+
+        double primal_residual = fmax(norm(ws->ry,p)/b_norm,norm(ws->rz,m)/h_norm);
+        double dual_residual = norm(ws->rx,n)/c_norm;
+
+        socp->iterations = iteration;
+        socp->gap = gap;
+        socp->residual = fmax(primal_residual,dual_residual);
+
+        bool converged_gap = (gap <= SOCP_ABSOLUTE_TOLERANCE)
+            || (primal_cost < 0.0 && gap <= -primal_cost*SOCP_RELATIVE_TOLERANCE)
+            || (dual_cost > 0.0 && gap <= dual_cost*SOCP_RELATIVE_TOLERANCE);
+
+        if (socp->residual <= SOCP_FEASIBILITY_TOLERANCE && converged_gap) return SOCP_OPTIMAL;
+
+        if (iteration == socp->max_iterations) break;
+
+        if (socp->deadline < INFINITY && socp_clock() >= socp->deadline) return SOCP_DEADLINE;
+
+        // Infeasible problems drive the iterates away
+        if (norm(socp->x,n) > SOCP_DIVERGENCE || norm(socp->z,m) > SOCP_DIVERGENCE) break;
+
+        if (!compute_scaling(socp) || !factor_kkt(socp)) return SOCP_NUMERICAL_ERROR;
+
+        double mu = gap/degree;
+
+        // Affine scaling direction, target -lambda o lambda
+        cone_product(socp,ws->lambda,ws->lambda,ws->target);
+        for (size_t i = 0; i < m; i++) ws->target[i] = -ws->target[i];
+
+        newton_step(socp);
+
+        double step = fmin(1.0,fmin(max_step(socp,socp->s,ws->ds),max_step(socp,socp->z,ws->dz)));
+
+        double affine_gap = 0.0;
+        for (size_t i = 0; i < m; i++)
+            affine_gap += (socp->s[i] + step*ws->ds[i])*(socp->z[i] + step*ws->dz[i]);
+
+        double sigma = fmin(1.0,fmax(0.0,affine_gap/gap));
+        sigma = sigma*sigma*sigma;
+
+        // Combined direction with the second order correction
+        scale(socp,ws->ds,ws->t1,true);
+        scale(socp,ws->dz,ws->t2,false);
+        cone_product(socp,ws->t1,ws->t2,ws->t3);
+        cone_product(socp,ws->lambda,ws->lambda,ws->target);
+
+        for (size_t i = 0; i < m; i++) ws->target[i] = -ws->target[i] - ws->t3[i];
+        add_identity(socp,ws->target,sigma*mu);
+
+        newton_step(socp);
+
+        step = fmin(max_step(socp,socp->s,ws->ds),max_step(socp,socp->z,ws->dz));
+        step = fmin(1.0,SOCP_STEP_FRACTION*step);
+
+        if (!(step > 1e-12)) return SOCP_NUMERICAL_ERROR;
+
+        for (size_t j = 0; j < n; j++) socp->x[j] += step*ws->dx[j];
+        for (size_t i = 0; i < p; i++) socp->y[i] += step*ws->dy[i];
+        for (size_t i = 0; i < m; i++)
+        {
+            socp->z[i] += step*ws->dz[i];
+            socp->s[i] += step*ws->ds[i];
+        }
+    }
+
+    return SOCP_MAX_ITERATIONS;
+}
@@ -0,0 +1,442 @@
+#include "marslanding/suggester.h"
+
+#include "marslanding/dynamics.h"
+#include "marslanding/planner.h"
+#include "marslanding/profiler.h"
+#include "marslanding/propagator.h"
+#include "marslanding/thread_pool.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+
+const double SUGGEST_PERIOD = 0.1; // in s of simulated time between requests
+const double SUGGEST_BUDGET = 0.008; // in s of wall time per search, within a frame
+const double SUGGEST_SPEED_WEIGHT = 10.0; // in m of miss per m/s of touchdown speed
+const int SUGGEST_ANGLES = 32; // directions of constant commands, half as many after a switch
+const int SUGGEST_MAGNITUDES = 9; // magnitudes of constant commands, half as many after a switch
+const int SUGGEST_SEEDS = 8; // best constant commands tried with a switch
+const double SUGGEST_SWITCH_FRACTIONS[] = {0.2, 0.4, 0.6, 0.8}; // of the seed descent duration
+const int SUGGEST_SWITCHES = 4;
+const int SUGGEST_REFINEMENTS = 6; // pattern search iterations around the best candidate
+const size_t SUGGEST_CHUNK = 8; // candidates per parallel task
+
+// Three values per parameter of a candidate
+enum { SUGGEST_PARAMETERS = 5, SUGGEST_PATTERN = 243 };
+
+static void direction_command(double angle, double magnitude, struct suggest_command_t *command)
+{
+    if(isnan(angle))
+    {
+        command->joy_x = 0.0;
+        command->joy_z = 0.0;
+    }
+    else
+    {
+        command->joy_x = sin(angle);
+        command->joy_z = cos(angle);
+    }
+
+    command->joy_n = magnitude;
+}
+
+// Joystick command of a candidate at a lander time
+void candidate_command(const struct suggest_candidate_t *candidate, double time,
+    struct suggest_command_t *command)
+{
+    int k = (time < candidate->switch_time) ? 0 : 1;
+
+    direction_command(candidate->angle[k],candidate->magnitude[k],command);
+}
+
+// Touchdown cost of a candidate from a state, INFINITY when it never lands.
+// Idle thrust is held at its value of the start of each command.
+double fly_candidate(const struct lander_t *lander, const struct suggest_candidate_t *candidate,
+    double *miss, double *speed, double *touchdown_time)
+{
+    const struct vehicle_t *vehicle = &lander->vehicle;
+
+    struct suggest_command_t command;
+    struct thrust_t thrust;
+    struct arc_t arc;
+    double state[TRAJECTORY_DIM];
+
+    candidate_command(candidate,lander->time,&command);
+    thrust_command(vehicle,command.joy_x,command.joy_z,command.joy_n,lander->state[M],&thrust);
+    init_arc(&arc,vehicle,&thrust,lander->time,lander->state);
+
+    double touchdown = arc_touchdown_time(&arc);
+
+    if(touchdown > candidate->switch_time)
+    {
+        arc_state(&arc,candidate->switch_time,state);
+
+        candidate_command(candidate,candidate->switch_time,&command);
+        thrust_command(vehicle,command.joy_x,command.joy_z,command.joy_n,state[M],&thrust);
+        init_arc(&arc,vehicle,&thrust,candidate->switch_time,state);
+
+        touchdown = arc_touchdown_time(&arc);
+    }
+
+    *touchdown_time = touchdown;
+
+    if(!isfinite(touchdown)) return INFINITY;
+
+    arc_state(&arc,touchdown,state);
+
+    // The objective is on the ground at the origin
+    *miss = fabs(state[PX]);
+    *speed = sqrt(state[VX]*state[VX] + state[VZ]*state[VZ]);
+
+    return *miss + SUGGEST_SPEED_WEIGHT*(*speed);
+}
+
+struct search_task_t
+{
+    struct suggester_t *suggester;
+    const struct lander_t *lander;
+    uint64_t deadline; // in ns, candidates after it are skipped
+    atomic_size_t flown;
+};
+
+static void fly_candidates(void *context, size_t begin, size_t end, int worker)
+{
+    (void)worker;
+
+    struct search_task_t *task = context;
+    struct suggester_t *suggester = task->suggester;
+
+    bool late = profile_clock() > task->deadline;
+
+    for(size_t i = begin; i < end; i++)
+    {
+        double miss, speed;
+
+        suggester->costs[i] = INFINITY;
+        suggester->touchdown_times[i] = INFINITY;
+
+        if(late) continue;
+
+        suggester->costs[i] = fly_candidate(task->lander,&suggester->candidates[i],&miss,&speed,
+            &suggester->touchdown_times[i]);
+    }
+
+    if(!late) atomic_fetch_add(&task->flown,end-begin);
+}
+
+// Fly a batch of candidates and keep the best one
+static void fly_batch(struct search_task_t *task, size_t count, struct suggest_candidate_t *best,
+    double *best_cost)
+{
+    struct suggester_t *suggester = task->suggester;
+
+    parallel_for(suggester->pool,count,SUGGEST_CHUNK,fly_candidates,task);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(suggester->costs[i] < *best_cost)
+        {
+            *best_cost = suggester->costs[i];
+            *best = suggester->candidates[i];
+        }
+    }
+}
+
+// Indices of the lowest finite costs sorted by cost, by insertion as there are few seeds
+static int best_indices(const double *costs, size_t count, size_t *indices, int wanted)
+{
+    int found = 0;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        if(!isfinite(costs[i])) continue;
+        if(found == wanted && costs[i] >= costs[indices[found-1]]) continue;
+
+        int k = (found < wanted) ? found++ : found-1;
+
+        while(k > 0 && costs[indices[k-1]] > costs[i])
+        {
+            indices[k] = indices[k-1];
+            k--;
+        }
+
+        indices[k] = i;
+    }
+
+    return found;
+}
+
+static double clamp(double x, double min, double max)
+{
+    return (x < min) ? min : (x > max) ? max : x;
+}
+
+// Search the best command within a wall time budget in s, on the calling thread.
+// Constant commands on a grid first, then the best of them switching to a coarser grid, then
+// a pattern search around the best candidate with steps halved every iteration.
+void search_suggestion(struct suggester_t *suggester, const struct lander_t *lander, double budget,
+    struct suggestion_t *suggestion)
+{
+    uint64_t start = profile_clock();
+
+    struct search_task_t task;
+    task.suggester = suggester;
+    task.lander = lander;
+    task.deadline = isfinite(budget) ? start + (uint64_t)(1e9*budget) : UINT64_MAX;
+    atomic_init(&task.flown,0);
+
+    struct suggest_candidate_t *candidates = suggester->candidates;
+    struct suggest_candidate_t best = {{NAN, NAN}, {0.0, 0.0}, INFINITY};
+    double best_cost = INFINITY;
+    size_t count = 0;
+
+    // Constant commands, idle included
+    candidates[count++] = best;
+
+    for(int a = 0; a < SUGGEST_ANGLES; a++)
+    {
+        for(int n = 0; n < SUGGEST_MAGNITUDES; n++)
+        {
+            double angle = 2.0*M_PI*a/SUGGEST_ANGLES;
+            double magnitude = (double)n/(SUGGEST_MAGNITUDES-1);
+            struct suggest_candidate_t candidate = {{angle, angle}, {magnitude, magnitude}, INFINITY};
+
+            candidates[count++] = candidate;
+        }
+    }
+
+    fly_batch(&task,count,&best,&best_cost);
+
+    // Best constant commands switching to a coarser grid part way down
+    size_t seeds[SUGGEST_SEEDS];
+    struct suggest_candidate_t seed_candidates[SUGGEST_SEEDS];
+    double seed_durations[SUGGEST_SEEDS];
+
+    int seed_count = best_indices(suggester->costs,count,seeds,SUGGEST_SEEDS);
+
+    for(int s = 0; s < seed_count; s++)
+    {
+        seed_candidates[s] = candidates[seeds[s]];
+        seed_durations[s] = suggester->touchdown_times[seeds[s]] - lander->time;
+    }
+
+    count = 0;
+
+    for(int s = 0; s < seed_count; s++)
+    {
+        for(int w = 0; w < SUGGEST_SWITCHES; w++)
+        {
+            struct suggest_candidate_t candidate = seed_candidates[s];
+            candidate.switch_time = lander->time + SUGGEST_SWITCH_FRACTIONS[w]*seed_durations[s];
+
+            candidate.angle[1] = NAN;
+            candidate.magnitude[1] = 0.0;
+            candidates[count++] = candidate;
+
+            for(int a = 0; a < SUGGEST_ANGLES/2; a++)
+            {
+                for(int n = 0; n < (SUGGEST_MAGNITUDES+1)/2; n++)
+                {
+                    candidate.angle[1] = 4.0*M_PI*a/SUGGEST_ANGLES;
+                    candidate.magnitude[1] = (double)n/((SUGGEST_MAGNITUDES+1)/2 - 1);
+                    candidates[count++] = candidate;
+                }
+            }
+        }
+    }
+
+    if(profile_clock() < task.deadline) fly_batch(&task,count,&best,&best_cost);
+
+    // Pattern search over both directions, both magnitudes and the switch time
+    double steps[SUGGEST_PARAMETERS] = {2.0*M_PI/SUGGEST_ANGLES, 1.0/(SUGGEST_MAGNITUDES-1), 0.0,
+        4.0*M_PI/SUGGEST_ANGLES, 2.0/(SUGGEST_MAGNITUDES-1)};
+
+    for(int r = 0; r < SUGGEST_REFINEMENTS && isfinite(best_cost) && profile_clock() < task.deadline; r++)
+    {
+        // Switch time steps relative to the time left before the switch
+        steps[2] = isfinite(best.switch_time) ? 0.1*(best.switch_time - lander->time)/(1 << r) : 0.0;
+
+        // Only the parameters of the best candidate that change its command, an idle command has no
+        // direction nor magnitude and a constant command no switch
+        int active[SUGGEST_PARAMETERS], active_count = 0;
+
+        if(isfinite(best.angle[0]))
+        {
+            active[active_count++] = 0;
+            active[active_count++] = 1;
+        }
+
+        if(isfinite(best.switch_time))
+        {
+            active[active_count++] = 2;
+
+            if(isfinite(best.angle[1]))
+            {
+                active[active_count++] = 3;
+                active[active_count++] = 4;
+            }
+        }
+
+        size_t pattern = 1;
+        for(int q = 0; q < active_count; q++) pattern *= 3;
+
+        if(pattern == 1) break;
+
+        for(size_t i = 0; i < pattern; i++)
+        {
+            int offset[SUGGEST_PARAMETERS] = {0};
+            for(int q = 0, k = (int)i; q < active_count; q++, k /= 3) offset[active[q]] = k % 3 - 1;
+
+            struct suggest_candidate_t candidate = best;
+            candidate.angle[0] += offset[0]*steps[0];
+            candidate.magnitude[0] = clamp(best.magnitude[0] + offset[1]*steps[1],0.0,1.0);
+            candidate.switch_time = fmax(lander->time,best.switch_time + offset[2]*steps[2]);
+            candidate.angle[1] += offset[3]*steps[3];
+            candidate.magnitude[1] = clamp(best.magnitude[1] + offset[4]*steps[4],0.0,1.0);
+
+            // A constant command keeps both commands equal
+            if(!isfinite(best.switch_time))
+            {
+                candidate.angle[1] = candidate.angle[0];
+                candidate.magnitude[1] = candidate.magnitude[0];
+            }
+
+            candidates[i] = candidate;
+        }
+
+        fly_batch(&task,pattern,&best,&best_cost);
+
+        for(int p = 0; p < SUGGEST_PARAMETERS; p++) steps[p] /= 2.0;
+    }
+
+    suggestion->valid = isfinite(best_cost);
+    suggestion->time = lander->time;
+    suggestion->candidate = best;
+    suggestion->cost = best_cost;
+    suggestion->miss = NAN;
+    suggestion->speed = NAN;
+
+    if(suggestion->valid)
+    {
+        double touchdown;
+        fly_candidate(lander,&best,&suggestion->miss,&suggestion->speed,&touchdown);
+    }
+
+    suggestion->candidates = atomic_load(&task.flown);
+    suggestion->solve_time = 1e-9*(double)(profile_clock() - start);
+}
+
+static void* suggester_main(void *arg)
+{
+    struct suggester_t *suggester = arg;
+
+    while(true)
+    {
+        while(sem_wait(&suggester->wake) != 0 && errno == EINTR);
+
+        if(atomic_load(&suggester->quit)) break;
+
+        // Only the latest of the requests posted during the last search is searched
+        if(!acquire_front(&suggester->requests)) continue;
+
+        search_suggestion(suggester,&suggester->request[suggester->requests.front],SUGGEST_BUDGET,
+            &suggester->result[suggester->results.back]);
+
+        publish_back(&suggester->results);
+    }
+
+    return NULL;
+}
+
+// Candidates of the largest batch: seeds with a switch to the coarser grid or idle
+static size_t suggest_capacity()
+{
+    size_t constants = 1 + (size_t)SUGGEST_ANGLES*SUGGEST_MAGNITUDES;
+    size_t switches = (size_t)SUGGEST_SEEDS*SUGGEST_SWITCHES*(1 + (SUGGEST_ANGLES/2)*((SUGGEST_MAGNITUDES+1)/2));
+
+    size_t capacity = (constants > switches) ? constants : switches;
+
+    return (capacity > SUGGEST_PATTERN) ? capacity : SUGGEST_PATTERN;
+}
+
+static void release_suggester(struct suggester_t *suggester)
+{
+    free(suggester->touchdown_times);
+    free(suggester->costs);
+    free(suggester->candidates);
+    free_thread_pool(suggester->pool);
+    free(suggester);
+}
+
+// Start the suggestion thread with a pool of threads workers, 0 to leave one processor to the game
+struct suggester_t* create_suggester(int threads)
+{
+    struct suggester_t *suggester = calloc(1,sizeof(struct suggester_t));
+    if(suggester == NULL) return NULL;
+
+    if(threads <= 0) threads = (processor_count() > 1) ? processor_count()-1 : 1;
+
+    suggester->capacity = suggest_capacity();
+    suggester->pool = create_thread_pool(threads);
+    suggester->candidates = malloc(suggester->capacity*sizeof(struct suggest_candidate_t));
+    suggester->costs = malloc(suggester->capacity*sizeof(double));
+    suggester->touchdown_times = malloc(suggester->capacity*sizeof(double));
+
+    if(suggester->pool == NULL || suggester->candidates == NULL || suggester->costs == NULL ||
+        suggester->touchdown_times == NULL || sem_init(&suggester->wake,0,0) != 0)
+    {
+        release_suggester(suggester);
+        return NULL;
+    }
+
+    atomic_init(&suggester->quit,false);
+    init_triple_buffer(&suggester->requests);
+    init_triple_buffer(&suggester->results);
+
+    if(pthread_create(&suggester->thread,NULL,suggester_main,suggester) != 0)
+    {
+        sem_destroy(&suggester->wake);
+        release_suggester(suggester);
+        return NULL;
+    }
+
+    return suggester;
+}
+
+// Stop the suggestion thread and free memory for a suggester
+struct suggester_t* free_suggester(struct suggester_t *suggester)
+{
+    if(suggester == NULL) return NULL;
+
+    atomic_store(&suggester->quit,true);
+    sem_post(&suggester->wake);
+    pthread_join(suggester->thread,NULL);
+
+    sem_destroy(&suggester->wake);
+    release_suggester(suggester);
+
+    return NULL;
+}
+
+// Search a command from the lander state, replacing any request not started yet
+void request_suggestion(struct suggester_t *suggester, const struct lander_t *lander)
+{
+    struct lander_t *snapshot = &suggester->request[suggester->requests.back];
+
+    snapshot->vehicle = lander->vehicle;
+    snapshot->time = lander->time;
+    for(int i = 0; i < TRAJECTORY_DIM; i++) snapshot->state[i] = lander->state[i];
+
+    publish_back(&suggester->requests);
+    sem_post(&suggester->wake);
+}
+
+// Most recent suggestion, NULL before the first one
+const struct suggestion_t* latest_suggestion(struct suggester_t *suggester)
+{
+    if(acquire_front(&suggester->results)) suggester->published = true;
+
+    if(!suggester->published) return NULL;
+
+    return &suggester->result[suggester->results.front];
+}
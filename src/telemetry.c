@@ -0,0 +1,203 @@
+#include "marslanding/telemetry.h"
+
+#include "marslanding/dynamics.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const size_t TELEMETRY_CAPACITY = 256; // power of two
+const double TELEMETRY_DEFAULT_RATE = 10.0; // in samples per simulated second
+
+static const char *TELEMETRY_FORMATS[] = {"human", "csv", "json"};
+
+// Format by name, human, csv or json, false if unknown
+bool find_telemetry_format(const char *name, enum telemetry_format_t *format)
+{
+    for(int i = 0; i < 3; i++)
+    {
+        if(strcmp(name,TELEMETRY_FORMATS[i]) == 0)
+        {
+            *format = (enum telemetry_format_t)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// One line per sample, written at once so it does not interleave with other output
+static void write_sample(struct telemetry_t *telemetry, const struct telemetry_sample_t *sample)
+{
+    char line[512];
+    const double *s = sample->state;
+    const struct thrust_t *t = &sample->thrust;
+
+    switch(telemetry->format)
+    {
+        case TELEMETRY_HUMAN:
+            snprintf(line,sizeof(line),
+                "t = %8.2f s  X = %9.2f m  Z = %8.2f m  VX = %7.2f m/s  VZ = %7.2f m/s  M = %7.2f kg  |T| = %8.2f N%s\n",
+                sample->time,s[PX],s[PZ],s[VX],s[VZ],s[M],t->norm,sample->is_grounded ? "  GROUNDED" : "");
+            break;
+
+        case TELEMETRY_CSV:
+            snprintf(line,sizeof(line),"%" PRIu64 ",%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%d\n",
+                sample->tick,sample->time,s[PX],s[PZ],s[VX],s[VZ],s[M],t->x,t->z,t->norm,sample->is_grounded);
+            break;
+
+        case TELEMETRY_JSON:
+            snprintf(line,sizeof(line),
+                "{\"tick\":%" PRIu64 ",\"time\":%.9g,\"px\":%.9g,\"pz\":%.9g,\"vx\":%.9g,\"vz\":%.9g,\"m\":%.9g,"
+                "\"thrust_x\":%.9g,\"thrust_z\":%.9g,\"thrust_norm\":%.9g,\"grounded\":%s}\n",
+                sample->tick,sample->time,s[PX],s[PZ],s[VX],s[VZ],s[M],t->x,t->z,t->norm,
+                sample->is_grounded ? "true" : "false");
+            break;
+    }
+
+    fputs(line,telemetry->file);
+}
+
+// Format every queued sample, flushing once the queue is empty
+static void drain_telemetry(struct telemetry_t *telemetry)
+{
+    size_t tail = atomic_load_explicit(&telemetry->tail,memory_order_relaxed);
+    size_t head = atomic_load_explicit(&telemetry->head,memory_order_acquire);
+
+    if(tail == head) return;
+
+    while(tail != head)
+    {
+        write_sample(telemetry,&telemetry->samples[tail & (TELEMETRY_CAPACITY-1)]);
+
+        // Release the slot to the producer as soon as it is formatted
+        atomic_store_explicit(&telemetry->tail,++tail,memory_order_release);
+
+        if(tail == head) head = atomic_load_explicit(&telemetry->head,memory_order_acquire);
+    }
+
+    fflush(telemetry->file);
+}
+
+static void* telemetry_main(void *arg)
+{
+    struct telemetry_t *telemetry = arg;
+
+    while(true)
+    {
+        while(sem_wait(&telemetry->wake) != 0 && errno == EINTR);
+
+        drain_telemetry(telemetry);
+
+        if(atomic_load(&telemetry->quit)) break;
+    }
+
+    return NULL;
+}
+
+// Start the writing thread for a number of samples per simulated second
+struct telemetry_t* create_telemetry(FILE *file, enum telemetry_format_t format, double rate)
+{
+    if(file == NULL || rate <= 0.0) return NULL;
+
+    struct telemetry_t *telemetry = calloc(1,sizeof(struct telemetry_t));
+    if(telemetry == NULL) return NULL;
+
+    telemetry->samples = calloc(TELEMETRY_CAPACITY,sizeof(struct telemetry_sample_t));
+
+    if(telemetry->samples == NULL || sem_init(&telemetry->wake,0,0) != 0)
+    {
+        free(telemetry->samples);
+        free(telemetry);
+        return NULL;
+    }
+
+    telemetry->file = file;
+    telemetry->format = format;
+    telemetry->period = 1.0/rate;
+    telemetry->last_time = -1.0;
+
+    atomic_init(&telemetry->quit,false);
+    atomic_init(&telemetry->head,0);
+    atomic_init(&telemetry->tail,0);
+
+    if(format == TELEMETRY_CSV)
+        fprintf(file,"tick,time,px,pz,vx,vz,m,thrust_x,thrust_z,thrust_norm,grounded\n");
+
+    if(pthread_create(&telemetry->thread,NULL,telemetry_main,telemetry) != 0)
+    {
+        sem_destroy(&telemetry->wake);
+        free(telemetry->samples);
+        free(telemetry);
+        return NULL;
+    }
+
+    return telemetry;
+}
+
+// Write the queued samples, stop the writing thread and free memory for telemetry
+struct telemetry_t* free_telemetry(struct telemetry_t *telemetry)
+{
+    if(telemetry == NULL) return NULL;
+
+    atomic_store(&telemetry->quit,true);
+    sem_post(&telemetry->wake);
+    pthread_join(telemetry->thread,NULL);
+
+    sem_destroy(&telemetry->wake);
+
+    free(telemetry->samples);
+    free(telemetry);
+
+    return NULL;
+}
+
+// Queue the lander state when a sample is due, at touchdown or after a reset. Drops it when full.
+void push_telemetry(struct telemetry_t *telemetry, const struct lander_t *lander, uint64_t tick)
+{
+    if(telemetry == NULL) return;
+
+    // Half a tick of slack, tick times are not exact multiples of the period
+    double time = lander->time + 0.5*FORWARD_TIME_STEP;
+
+    bool due = time >= telemetry->next_time
+        || lander->time < telemetry->last_time // reset
+        || lander->is_grounded;
+
+    if(!due) return;
+
+    telemetry->last_time = lander->time;
+    telemetry->next_time = telemetry->period*(floor(time/telemetry->period)+1.0);
+
+    size_t head = atomic_load_explicit(&telemetry->head,memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&telemetry->tail,memory_order_acquire);
+
+    if(head - tail == TELEMETRY_CAPACITY)
+    {
+        telemetry->dropped++;
+        return;
+    }
+
+    struct telemetry_sample_t *sample = &telemetry->samples[head & (TELEMETRY_CAPACITY-1)];
+
+    sample->tick = tick;
+    sample->time = lander->time;
+    for(int i = 0; i < TRAJECTORY_DIM; i++) sample->state[i] = lander->state[i];
+    sample->thrust = lander->thrust;
+    sample->is_grounded = lander->is_grounded;
+
+    atomic_store_explicit(&telemetry->head,head+1,memory_order_release);
+    telemetry->pushed++;
+
+    sem_post(&telemetry->wake);
+}
+
+void print_telemetry_stats(const struct telemetry_t *telemetry)
+{
+    if(telemetry == NULL) return;
+
+    printf("Telemetry : %zu samples queued, %zu dropped with the writer behind\n",
+        telemetry->pushed,telemetry->dropped);
+}
@@ -0,0 +1,206 @@
+#include "marslanding/thread_pool.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+// Number of online processors
+int processor_count()
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (count < 1) ? 1 : (int)count;
+}
+
+static uint64_t pack_range(size_t begin, size_t end)
+{
+    return ((uint64_t)begin << 32) | (uint64_t)end;
+}
+
+// Take a chunk from the front of a worker range, false when it is empty
+static bool pop_chunk(struct pool_worker_t *worker, size_t chunk, size_t *begin, size_t *end)
+{
+    uint64_t range = atomic_load(&worker->range);
+
+    while(true)
+    {
+        size_t first = (size_t)(range >> 32), last = (size_t)(range & 0xFFFFFFFFu);
+        if(first >= last) return false;
+
+        size_t next = (last - first > chunk) ? first + chunk : last;
+
+        if(atomic_compare_exchange_weak(&worker->range,&range,pack_range(next,last)))
+        {
+            *begin = first;
+            *end = next;
+            return true;
+        }
+    }
+}
+
+// Move the back half of another worker range to an idle worker, false when all are empty
+static bool steal_range(struct thread_pool_t* pool, int thief)
+{
+    for(int k = 1; k < pool->size; k++)
+    {
+        struct pool_worker_t *victim = &pool->workers[(thief + k) % pool->size];
+        uint64_t range = atomic_load(&victim->range);
+
+        while(true)
+        {
+            size_t first = (size_t)(range >> 32), last = (size_t)(range & 0xFFFFFFFFu);
+            if(first >= last) break;
+
+            size_t middle = first + (last - first)/2;
+
+            if(atomic_compare_exchange_weak(&victim->range,&range,pack_range(first,middle)))
+            {
+                atomic_store(&pool->workers[thief].range,pack_range(middle,last));
+                atomic_fetch_add(&pool->steals,1);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Run chunks of the current loop, own ones first then stolen ones, until none is left
+static void run_chunks(struct thread_pool_t* pool, int worker)
+{
+    size_t begin, end;
+
+    do
+    {
+        while(pop_chunk(&pool->workers[worker],pool->chunk,&begin,&end))
+            pool->task(pool->context,begin,end,worker);
+    }
+    while(steal_range(pool,worker));
+}
+
+static void* worker_main(void *arg)
+{
+    struct pool_worker_t* worker = arg;
+    struct thread_pool_t* pool = worker->pool;
+
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    while(true)
+    {
+        // Wait for a new loop
+        while(!pool->quit && pool->generation == generation)
+            pthread_cond_wait(&pool->wake,&pool->mutex);
+
+        if(pool->quit) break;
+
+        generation = pool->generation;
+
+        pthread_mutex_unlock(&pool->mutex);
+
+        run_chunks(pool,worker->id);
+
+        pthread_mutex_lock(&pool->mutex);
+
+        if(--pool->running == 0) pthread_cond_signal(&pool->done);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+// Start a pool of size workers, 0 for one per processor
+struct thread_pool_t* create_thread_pool(int size)
+{
+    if(size <= 0) size = processor_count();
+
+    struct thread_pool_t* pool = calloc(1,sizeof(struct thread_pool_t));
+    if(pool == NULL) return NULL;
+
+    pool->workers = calloc(size,sizeof(struct pool_worker_t));
+    if(pool->workers == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex,NULL);
+    pthread_cond_init(&pool->wake,NULL);
+    pthread_cond_init(&pool->done,NULL);
+    atomic_init(&pool->steals,0);
+
+    // Worker 0 is the thread calling parallel_for
+    pool->size = 1;
+    pool->workers[0].pool = pool;
+    atomic_init(&pool->workers[0].range,0);
+
+    for(int i = 1; i < size; i++)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        atomic_init(&pool->workers[i].range,0);
+
+        if(pthread_create(&pool->workers[i].thread,NULL,worker_main,&pool->workers[i]) != 0) break;
+
+        pool->size++;
+    }
+
+    return pool;
+}
+
+// Stop the workers and free memory for a pool
+struct thread_pool_t* free_thread_pool(struct thread_pool_t* pool)
+{
+    if(pool == NULL) return NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for(int i = 1; i < pool->size; i++)
+        pthread_join(pool->workers[i].thread,NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->mutex);
+
+    free(pool->workers);
+    free(pool);
+
+    return NULL;
+}
+
+// Run task over [0,count) in chunks, returns once all chunks are done
+void parallel_for(struct thread_pool_t* pool, size_t count, size_t chunk, pool_task_t task, void *context)
+{
+    if(pool == NULL || count == 0) return;
+    if(chunk == 0) chunk = 1;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    pool->chunk = chunk;
+
+    // Equal shares, published to the workers by the mutex
+    for(int i = 0; i < pool->size; i++)
+        atomic_store(&pool->workers[i].range,pack_range(count*i/pool->size,count*(i+1)/pool->size));
+
+    pool->running = pool->size-1;
+    pool->generation++;
+
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    run_chunks(pool,0);
+
+    pthread_mutex_lock(&pool->mutex);
+
+    while(pool->running > 0)
+        pthread_cond_wait(&pool->done,&pool->mutex);
+
+    pthread_mutex_unlock(&pool->mutex);
+}
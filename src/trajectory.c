@@ -0,0 +1,172 @@
+#include "marslanding/trajectory.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+// Allocate a trajectory holding at least capacity samples
+struct trajectory_t* create_trajectory(size_t capacity)
+{
+    if(capacity == 0) return NULL;
+
+    // Round up to a power of two so that indices wrap with a mask
+    size_t rounded = 1;
+    while(rounded < capacity) rounded <<= 1;
+
+    struct trajectory_t* traj = malloc(sizeof(struct trajectory_t));
+    if(traj == NULL) return NULL;
+
+    // Single block for all columns
+    traj->time = malloc((TRAJECTORY_DIM+1)*rounded*sizeof(double));
+    if(traj->time == NULL)
+    {
+        free(traj);
+        return NULL;
+    }
+
+    for(int i = 0; i < TRAJECTORY_DIM; i++)
+        traj->state[i] = traj->time + (i+1)*rounded;
+
+    traj->capacity = rounded;
+    traj->first = 0;
+    traj->length = 0;
+
+    return traj;
+}
+
+// Free memory for a trajectory
+struct trajectory_t* free_trajectory(struct trajectory_t* traj)
+{
+    if(traj == NULL) return NULL;
+
+    free(traj->time);
+    free(traj);
+
+    return NULL;
+}
+
+// Remove all samples, keep storage
+void clear_trajectory(struct trajectory_t* traj)
+{
+    if(traj == NULL) return;
+
+    traj->first = 0;
+    traj->length = 0;
+}
+
+// Append a sample, evicting the oldest one when full
+bool append_state(struct trajectory_t* traj, double time, const double* state)
+{
+    if(traj == NULL || state == NULL) return false;
+
+    if(traj->length == traj->capacity) evict_states(traj,1);
+
+    size_t k = sample_index(traj,traj->length);
+
+    traj->time[k] = time;
+    for(int i = 0; i < TRAJECTORY_DIM; i++)
+        traj->state[i][k] = state[i];
+
+    traj->length++;
+
+    return true;
+}
+
+// Copy the i-th oldest sample
+bool get_state(const struct trajectory_t* traj, size_t i, double* time, double* state)
+{
+    if(traj == NULL || i >= traj->length) return false;
+
+    size_t k = sample_index(traj,i);
+
+    if(time != NULL) *time = traj->time[k];
+
+    if(state != NULL)
+    {
+        for(int j = 0; j < TRAJECTORY_DIM; j++)
+            state[j] = traj->state[j][k];
+    }
+
+    return true;
+}
+
+// Copy the most recent sample
+bool last_state(const struct trajectory_t* traj, double* time, double* state)
+{
+    if(traj == NULL || traj->length == 0) return false;
+
+    return get_state(traj,traj->length-1,time,state);
+}
+
+// Number of samples before a certain time
+static size_t count_before(const struct trajectory_t* traj, double time)
+{
+    // Samples are appended in time order, binary search the first one not before time
+    size_t low = 0, high = traj->length;
+
+    while(low < high)
+    {
+        size_t mid = low + (high-low)/2;
+
+        if(traj->time[sample_index(traj,mid)] < time)
+            low = mid+1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+// Linear interpolation of the state at a time within the samples
+bool interpolate_state(const struct trajectory_t* traj, double time, double* state)
+{
+    if(traj == NULL || state == NULL || traj->length == 0) return false;
+
+    size_t i = count_before(traj,time);
+    if(i == traj->length) return false; // after last sample
+
+    size_t k1 = sample_index(traj,i);
+    if(i == 0)
+    {
+        if(traj->time[k1] != time) return false; // before first sample
+        return get_state(traj,0,NULL,state);
+    }
+
+    size_t k0 = sample_index(traj,i-1);
+    double ratio = (time - traj->time[k0])/(traj->time[k1] - traj->time[k0]);
+
+    for(int j = 0; j < TRAJECTORY_DIM; j++)
+        state[j] = traj->state[j][k0] + ratio*(traj->state[j][k1] - traj->state[j][k0]);
+
+    return true;
+}
+
+// Drop the count oldest samples, returns the number of dropped samples
+size_t evict_states(struct trajectory_t* traj, size_t count)
+{
+    if(traj == NULL) return 0;
+
+    if(count > traj->length) count = traj->length;
+
+    traj->first = (traj->first + count) & (traj->capacity - 1);
+    traj->length -= count;
+
+    return count;
+}
+
+// Drop all samples before a certain time
+size_t evict_states_before(struct trajectory_t* traj, double min_time)
+{
+    if(traj == NULL) return 0;
+
+    return evict_states(traj,count_before(traj,min_time));
+}
+
+// Drop the samples before a certain time but the last one, so that the time can still be interpolated
+size_t evict_states_until(struct trajectory_t* traj, double time)
+{
+    if(traj == NULL) return 0;
+
+    size_t count = count_before(traj,time);
+
+    return evict_states(traj,(count > 0) ? count-1 : 0);
+}
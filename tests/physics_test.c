@@ -0,0 +1,595 @@
+#include "marslanding/decimation.h"
+#include "marslanding/descent.h"
+#include "marslanding/draw.h"
+#include "marslanding/dynamics.h"
+#include "marslanding/guidance.h"
+#include "marslanding/integrator.h"
+#include "marslanding/socp.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Regression test of the dynamics: scripted descents against golden trajectories, invariants on
+// every tick, the explicit Euler path against the original implementation and the descent kernel, the
+// interior point solver on small problems, a guided descent and the history summary on paths doubling back.
+// Usage: marslanding_tests GOLDEN, or marslanding_tests -u GOLDEN to write the golden file again.
+
+const double MAX_TIME = 600.0; // in s per descent
+const int SAMPLE_TICKS = 100; // golden samples every second, and at touchdown
+const double GOLDEN_TOLERANCE = 1e-6; // relative, with an absolute floor of the same size
+
+int failures = 0;
+
+#define CHECK(condition, ...) \
+    do { if (!(condition)) { failures++; printf("FAIL %s:%d ",__FILE__,__LINE__); printf(__VA_ARGS__); printf("\n"); } } while (0)
+
+// Command held from a time, as the joystick axes
+struct command_t
+{
+    double time, joy_x, joy_z, joy_n;
+};
+
+struct profile_t
+{
+    const char *name;
+    int length;
+    struct command_t commands[4];
+};
+
+static const struct profile_t PROFILES[] = {
+    {"idle", 1, {{0.0, 0.0, 0.0, 0.0}}},
+    {"brake", 3, {{0.0, 0.0, 1.0, 1.0}, {10.0, 0.0, 1.0, 0.3}, {20.0, 0.0, 1.0, 0.0}}},
+    {"tilted", 2, {{0.0, -0.5, 0.8660254037844386, 0.8}, {8.0, 0.6, 0.8, 0.2}}},
+    {"burn_dry", 1, {{0.0, 0.2, 0.9797958971132712, 1.0}}},
+};
+
+// Integrator and event location of a golden case
+struct setup_t
+{
+    const struct integrator_t *integrator;
+    bool locate_events;
+};
+
+static const struct setup_t SETUPS[] = {
+    {&EULER_INTEGRATOR, false},
+    {&EULER_INTEGRATOR, true},
+    {&RK4_INTEGRATOR, true},
+    {&RK45_INTEGRATOR, true},
+    {&ANALYTIC_INTEGRATOR, true},
+};
+
+static void profile_command(const struct profile_t *profile, double time, double *joy)
+{
+    int k = 0;
+    while (k+1 < profile->length && profile->commands[k+1].time <= time) k++;
+
+    joy[0] = profile->commands[k].joy_x;
+    joy[1] = profile->commands[k].joy_z;
+    joy[2] = profile->commands[k].joy_n;
+}
+
+// Golden samples of all cases, one row per sample
+struct golden_t
+{
+    size_t length, capacity;
+    char (*names)[64];
+    double (*rows)[TRAJECTORY_DIM+1]; // time then state
+};
+
+static void add_row(struct golden_t *golden, const char *name, double time, const double *state)
+{
+    if (golden->length == golden->capacity)
+    {
+        golden->capacity = (golden->capacity == 0) ? 1024 : 2*golden->capacity;
+        golden->names = realloc(golden->names,golden->capacity*sizeof(*golden->names));
+        golden->rows = realloc(golden->rows,golden->capacity*sizeof(*golden->rows));
+
+        if (golden->names == NULL || golden->rows == NULL)
+        {
+            printf("Out of memory\n");
+            exit(-1);
+        }
+    }
+
+    snprintf(golden->names[golden->length],sizeof(golden->names[0]),"%s",name);
+    golden->rows[golden->length][0] = time;
+    memcpy(golden->rows[golden->length]+1,state,TRAJECTORY_DIM*sizeof(double));
+    golden->length++;
+}
+
+static bool load_golden(const char *path, struct golden_t *golden)
+{
+    FILE *file = fopen(path,"r");
+    if (file == NULL) return false;
+
+    char line[512], name[64];
+    double r[TRAJECTORY_DIM+1];
+
+    while (fgets(line,sizeof(line),file) != NULL)
+    {
+        // Skip the header
+        if (sscanf(line,"%63[^,],%lf,%lf,%lf,%lf,%lf,%lf",name,&r[0],&r[1],&r[2],&r[3],&r[4],&r[5]) != 7) continue;
+
+        add_row(golden,name,r[0],r+1);
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+static bool write_golden(const char *path, const struct golden_t *golden)
+{
+    FILE *file = fopen(path,"w");
+    if (file == NULL) return false;
+
+    fprintf(file,"case,time,px,pz,vx,vz,m\n");
+
+    for (size_t i = 0; i < golden->length; i++)
+    {
+        fprintf(file,"%s",golden->names[i]);
+        for (int k = 0; k < TRAJECTORY_DIM+1; k++) fprintf(file,",%.17g",golden->rows[i][k]);
+        fprintf(file,"\n");
+    }
+
+    return fclose(file) == 0;
+}
+
+// Fly a profile to touchdown, checking invariants on every tick and sampling the trajectory
+static void fly_case(const struct profile_t *profile, const struct setup_t *setup, struct golden_t *samples)
+{
+    char name[64];
+    snprintf(name,sizeof(name),"%s/%s%s",profile->name,setup->integrator->name,
+        setup->locate_events ? "/events" : "");
+
+    struct lander_t *lander = create_lander(0);
+    lander->integrator = setup->integrator;
+    lander->locate_events = setup->locate_events;
+
+    add_row(samples,name,lander->time,lander->state);
+
+    double previous_mass = lander->state[M];
+    bool was_dry = false;
+    int ticks = 0;
+
+    while (!lander->is_grounded && lander->time < MAX_TIME)
+    {
+        double joy[3];
+        profile_command(profile,lander->time,joy);
+        compute_thrust(lander,joy[0],joy[1],joy[2]);
+
+        // No thrust acts on a dry lander
+        if (lander->is_dry)
+        {
+            double dynamics[TRAJECTORY_DIM];
+            system_dynamics(lander,lander->state,dynamics);
+            CHECK(dynamics[VX] == 0.0 && dynamics[M] == 0.0 && dynamics[VZ] == -MARS_GRAVITY,
+                "%s: thrust acts on a dry lander at t = %.2f s",name,lander->time);
+        }
+
+        forward_tick(lander);
+        ticks++;
+
+        CHECK(lander->state[M] <= previous_mass,"%s: mass increases at t = %.2f s",name,lander->time);
+        CHECK(!was_dry || lander->is_dry,"%s: lander no longer dry at t = %.2f s",name,lander->time);
+        CHECK(lander->is_dry == (lander->state[M] <= lander->vehicle.dry_mass) || setup->locate_events,
+            "%s: dry flag does not match the mass at t = %.2f s",name,lander->time);
+
+        previous_mass = lander->state[M];
+        was_dry = lander->is_dry;
+
+        if (ticks % SAMPLE_TICKS == 0 || lander->is_grounded) add_row(samples,name,lander->time,lander->state);
+    }
+
+    CHECK(lander->is_grounded,"%s: no touchdown within %.0f s",name,MAX_TIME);
+    CHECK(lander->state[PZ] <= 0.0 || (setup->locate_events && lander->state[PZ] < EVENT_TOLERANCE),
+        "%s: grounded above the ground, PZ = %g m",name,lander->state[PZ]);
+
+    // Located touchdown stops on the ground, not one tick below it
+    if (setup->locate_events)
+        CHECK(fabs(lander->state[PZ]) < 1e-6,"%s: touchdown not located, PZ = %g m",name,lander->state[PZ]);
+
+    free_lander(lander);
+}
+
+// Original explicit Euler: dynamics of the first version, fixed steps with a shorter last one
+static void original_euler(const struct lander_t *lander, double *state, double duration)
+{
+    const struct vehicle_t *vehicle = &lander->vehicle;
+    const struct thrust_t *thrust = &lander->thrust;
+
+    while (duration > 0.0)
+    {
+        double step = (duration > FORWARD_TIME_STEP) ? FORWARD_TIME_STEP : duration;
+        double dynamics[TRAJECTORY_DIM];
+
+        dynamics[PX] = state[VX];
+        dynamics[PZ] = state[VZ];
+
+        if (state[M] > vehicle->dry_mass && state[PZ] > 0.0)
+        {
+            dynamics[VX] = thrust->x/state[M];
+            dynamics[VZ] = -MARS_GRAVITY + thrust->z/state[M];
+            dynamics[M] = -vehicle->alpha*thrust->norm;
+        }
+        else if (state[M] <= vehicle->dry_mass && state[PZ] > 0.0)
+        {
+            dynamics[VX] = 0.0;
+            dynamics[VZ] = -MARS_GRAVITY;
+            dynamics[M] = 0.0;
+        }
+        else
+        {
+            dynamics[VX] = 0.0;
+            dynamics[VZ] = 0.0;
+            dynamics[M] = 0.0;
+        }
+
+        for (int i = 0; i < STATE_DIM; i++)
+        {
+            dynamics[i] *= step;
+            state[i] += dynamics[i];
+        }
+
+        duration -= step;
+    }
+}
+
+// The default first order path is bit for bit the original one, ticks and long durations alike
+static void check_original_euler()
+{
+    const double durations[] = {FORWARD_TIME_STEP, 0.25, 1.0, 7.333};
+
+    for (int p = 0; p < (int)(sizeof(PROFILES)/sizeof(PROFILES[0])); p++)
+    {
+        for (int d = 0; d < 4; d++)
+        {
+            struct lander_t *lander = create_lander(0);
+
+            double state[TRAJECTORY_DIM];
+            memcpy(state,lander->state,sizeof(state));
+
+            bool same = true;
+
+            while (!lander->is_grounded && lander->time < MAX_TIME && same)
+            {
+                double joy[3];
+                profile_command(&PROFILES[p],lander->time,joy);
+                compute_thrust(lander,joy[0],joy[1],joy[2]);
+
+                original_euler(lander,state,durations[d]);
+                forward_duration(lander,durations[d]);
+
+                same = memcmp(state,lander->state,sizeof(state)) == 0;
+            }
+
+            CHECK(same,"%s: euler by %g s differs from the original at t = %.2f s",
+                PROFILES[p].name,durations[d],lander->time);
+
+            free_lander(lander);
+        }
+    }
+}
+
+// A steady prediction is shifted from tick to tick instead of flown again, whatever its sampling
+static void check_prediction_reuse()
+{
+    const struct integrator_t *integrators[] = {&RK4_INTEGRATOR, &RK45_INTEGRATOR, &ANALYTIC_INTEGRATOR};
+
+    for (int k = 0; k < 3; k++)
+    {
+        struct lander_t *lander = create_lander(0);
+        lander->integrator = integrators[k];
+
+        compute_thrust(lander,0.0,1.0,0.5);
+
+        double first_time, first_end[TRAJECTORY_DIM];
+        last_state(predict(lander),&first_time,first_end);
+
+        int reused = 0;
+
+        for (int tick = 0; tick < 20; tick++)
+        {
+            compute_thrust(lander,0.0,1.0,0.5);
+            forward_tick(lander);
+
+            double time, end[TRAJECTORY_DIM];
+            last_state(predict(lander),&time,end);
+
+            // Flown again, the prediction would end on another sample
+            if (time == first_time && memcmp(end,first_end,sizeof(end)) == 0) reused++;
+        }
+
+        CHECK(reused == 20,"%s: prediction reused on %d of 20 steady ticks",integrators[k]->name,reused);
+
+        free_lander(lander);
+    }
+}
+
+// The descent kernel flies the same ticks as forward_tick, command rows at a time
+static void check_descent_kernel()
+{
+    const struct integrator_t *integrators[] = {&EULER_INTEGRATOR, &RK4_INTEGRATOR};
+    const enum descent_scheme_t schemes[] = {DESCENT_EULER, DESCENT_RK4};
+
+    for (int j = 0; j < 2; j++)
+    {
+        for (int p = 0; p < (int)(sizeof(PROFILES)/sizeof(PROFILES[0])); p++)
+        {
+            const struct profile_t *profile = &PROFILES[p];
+            struct lander_t *lander = create_lander(0);
+            lander->integrator = integrators[j];
+
+            double state[TRAJECTORY_DIM];
+            memcpy(state,lander->state,sizeof(state));
+            double time = 0.0;
+
+            bool flying = true;
+
+            for (int k = 0; k < profile->length && flying; k++)
+            {
+                const struct command_t *command = &profile->commands[k];
+                double end_time = (k+1 < profile->length) ? profile->commands[k+1].time : MAX_TIME;
+
+                flying = descent_fly(&lander->vehicle,schemes[j],command->joy_x,command->joy_z,command->joy_n,
+                    FORWARD_TIME_STEP,end_time,state,&time);
+            }
+
+            while (!lander->is_grounded && lander->time < MAX_TIME)
+            {
+                double joy[3];
+                profile_command(profile,lander->time,joy);
+                compute_thrust(lander,joy[0],joy[1],joy[2]);
+                forward_tick(lander);
+            }
+
+            CHECK(memcmp(state,lander->state,sizeof(state)) == 0 && time == lander->time,
+                "%s, %s: descent kernel differs from the ticks, t = %.2f s, %.2f s expected",integrators[j]->name,
+                profile->name,time,lander->time);
+
+            free_lander(lander);
+        }
+    }
+}
+
+// minimize t subject to |(x,y)| <= t, x >= lower, x <= upper, y = 4, optimum t = 5 for lower = 3
+static enum socp_status_t solve_small_socp(double lower, double upper, double *x)
+{
+    const size_t cone_dims[] = {3};
+    struct socp_t *socp = create_socp(3,1,2,1,cone_dims);
+    if (socp == NULL) return SOCP_NUMERICAL_ERROR;
+
+    socp->c[0] = 1.0;
+
+    socp->A[2] = 1.0;
+    socp->b[0] = 4.0;
+
+    // -x + s = -lower, x + s = upper
+    socp->G[0*3+1] = -1.0;
+    socp->h[0] = -lower;
+    socp->G[1*3+1] = 1.0;
+    socp->h[1] = upper;
+
+    // (t,x,y) in the cone
+    for (int i = 0; i < 3; i++) socp->G[(2+i)*3+i] = -1.0;
+
+    enum socp_status_t status = solve_socp(socp);
+    for (int i = 0; i < 3; i++) x[i] = socp->x[i];
+
+    free_socp(socp);
+
+    return status;
+}
+
+static void check_socp()
+{
+    double x[3];
+
+    enum socp_status_t status = solve_small_socp(3.0,10.0,x);
+    CHECK(status == SOCP_OPTIMAL,"small SOCP not solved, status %d",status);
+    CHECK(fabs(x[0]-5.0) < 1e-5 && fabs(x[1]-3.0) < 1e-5 && fabs(x[2]-4.0) < 1e-5,
+        "small SOCP solution (%g, %g, %g), (5, 3, 4) expected",x[0],x[1],x[2]);
+
+    status = solve_small_socp(3.0,2.0,x);
+    CHECK(status != SOCP_OPTIMAL,"infeasible SOCP reported optimal at (%g, %g, %g)",x[0],x[1],x[2]);
+}
+
+// Distance in px from a point to the drawn polyline of a summary at 1 px per m
+static double summary_distance(const struct decimation_t *summary, double x, double z)
+{
+    double distance = INFINITY;
+    double ax, az, bx, bz;
+    get_point(summary,0,&ax,&az);
+
+    for (size_t i = 0; i < decimation_length(summary); i++)
+    {
+        get_point(summary,i,&bx,&bz);
+
+        double dx = bx-ax, dz = bz-az;
+        double length = dx*dx + dz*dz;
+        double u = (length > 0.0) ? fmin(1.0,fmax(0.0,((x-ax)*dx + (z-az)*dz)/length)) : 0.0;
+
+        distance = fmin(distance,hypot(x-ax-u*dx,z-az-u*dz));
+
+        ax = bx;
+        az = bz;
+    }
+
+    return distance;
+}
+
+// Every point of paths turning back on themselves stays within tolerance of the history summary
+static void check_history_summary()
+{
+    // Out to x = 100 and back to 50 on a line, then up to z = 50 and down again
+    const char *names[] = {"doubling back", "up and down"};
+    const double ends[2][3][2] = {{{0.0, 0.0}, {100.0, 0.0}, {50.0, 0.0}}, {{0.0, 0.0}, {0.0, 50.0}, {0.0, 0.0}}};
+    enum { STEPS = 200 }; // per leg
+
+    struct decimation_t *summary = create_decimation(1.0,1.0,HISTORY_TOLERANCE);
+
+    for (int p = 0; p < 2; p++)
+    {
+        double path[2*STEPS+1][2];
+        int length = 0;
+
+        for (int leg = 0; leg < 2; leg++)
+        {
+            const double *from = ends[p][leg], *to = ends[p][leg+1];
+
+            for (int k = (leg == 0) ? 0 : 1; k <= STEPS; k++)
+            {
+                path[length][0] = from[0] + (to[0]-from[0])*k/STEPS;
+                path[length][1] = from[1] + (to[1]-from[1])*k/STEPS;
+                length++;
+            }
+        }
+
+        clear_decimation(summary);
+        for (int k = 0; k < length; k++) add_point(summary,path[k][0],path[k][1]);
+
+        double worst = 0.0;
+        for (int k = 0; k < length; k++) worst = fmax(worst,summary_distance(summary,path[k][0],path[k][1]));
+
+        CHECK(worst <= HISTORY_TOLERANCE + 1e-9,"%s: history summary %.2f px from the path, %.2f px allowed",
+            names[p],worst,HISTORY_TOLERANCE);
+    }
+
+    free_decimation(summary);
+}
+
+// The autopilot lands softly from a reachable state with the fuel reserve left
+static void check_guided_descent()
+{
+    const double state[TRAJECTORY_DIM] = {300.0, 600.0, -10.0, -30.0, 1905.0};
+    const double period = 1.0; // in s, plans are longer than the game ones to keep the test short
+
+    struct lander_t *lander = create_lander(0);
+    struct guidance_t *guidance = create_guidance(GUIDANCE_STEPS);
+
+    reset_lander(lander,state);
+
+    double next_plan_time = 0.0;
+
+    while (!lander->is_grounded && lander->time < MAX_TIME)
+    {
+        if (lander->time >= next_plan_time)
+        {
+            plan_descent(guidance,lander);
+            next_plan_time = lander->time + period;
+        }
+
+        double joy_x = 0.0, joy_z = 0.0, joy_n = 0.0;
+        guidance_command(guidance,lander,&joy_x,&joy_z,&joy_n);
+        compute_thrust(lander,joy_x,joy_z,joy_n);
+        forward_tick(lander);
+    }
+
+    double velocity = sqrt(lander->state[VX]*lander->state[VX] + lander->state[VZ]*lander->state[VZ]);
+    double fuel = lander->state[M] - lander->vehicle.dry_mass;
+
+    CHECK(lander->is_grounded,"guided descent did not land within %.0f s",MAX_TIME);
+    CHECK(velocity < 3.0,"guided touchdown at %.2f m/s",velocity);
+    CHECK(fabs(lander->state[PX]) < 10.0,"guided touchdown %.1f m from the objective",lander->state[PX]);
+    CHECK(fuel > 0.5*GUIDANCE_FUEL_RESERVE,"guided descent left %.1f kg of fuel",fuel);
+
+    printf("Guided descent : %.2f m/s at %.1f m from the objective, %.1f kg left, %.1f s\n",
+        velocity,lander->state[PX],fuel,lander->time);
+
+    free_guidance(guidance);
+    free_lander(lander);
+}
+
+static double compare_golden(const struct golden_t *golden, const struct golden_t *samples)
+{
+    double worst = 0.0;
+
+    CHECK(golden->length == samples->length,"%zu golden samples, %zu flown",golden->length,samples->length);
+
+    size_t length = (golden->length < samples->length) ? golden->length : samples->length;
+    size_t reported = 0;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        CHECK(strcmp(golden->names[i],samples->names[i]) == 0,"sample %zu is %s, %s expected",
+            i,samples->names[i],golden->names[i]);
+
+        for (int k = 0; k < TRAJECTORY_DIM+1; k++)
+        {
+            double expected = golden->rows[i][k];
+            double error = fabs(samples->rows[i][k] - expected)/(1.0 + fabs(expected));
+            if (error > worst) worst = error;
+
+            if (error > GOLDEN_TOLERANCE && reported++ < 10)
+            {
+                failures++;
+                printf("FAIL %s at t = %.2f s: column %d is %.17g, %.17g expected\n",
+                    samples->names[i],samples->rows[i][0],k,samples->rows[i][k],expected);
+            }
+        }
+    }
+
+    return worst;
+}
+
+int main(int argc, char** argv)
+{
+    bool update = argc == 3 && strcmp(argv[1],"-u") == 0;
+
+    if (argc != 2 && !update)
+    {
+        printf("Usage: marslanding_tests [-u] GOLDEN\n");
+        return -1;
+    }
+
+    const char *path = argv[argc-1];
+
+    check_original_euler();
+    check_descent_kernel();
+    check_prediction_reuse();
+    check_socp();
+    check_guided_descent();
+    check_history_summary();
+
+    struct golden_t samples = {0};
+
+    for (int p = 0; p < (int)(sizeof(PROFILES)/sizeof(PROFILES[0])); p++)
+        for (int s = 0; s < (int)(sizeof(SETUPS)/sizeof(SETUPS[0])); s++)
+            fly_case(&PROFILES[p],&SETUPS[s],&samples);
+
+    if (update)
+    {
+        if (!write_golden(path,&samples))
+        {
+            printf("Failed to write %s\n",path);
+            return -1;
+        }
+
+        printf("%zu golden samples written to %s\n",samples.length,path);
+    }
+    else
+    {
+        struct golden_t golden = {0};
+
+        if (!load_golden(path,&golden))
+        {
+            printf("Failed to read %s\n",path);
+            return -1;
+        }
+
+        double worst = compare_golden(&golden,&samples);
+        printf("%zu samples, worst relative deviation from golden %g\n",samples.length,worst);
+
+        free(golden.names);
+        free(golden.rows);
+    }
+
+    free(samples.names);
+    free(samples.rows);
+
+    printf("%s, %d failures\n",(failures == 0) ? "PASS" : "FAIL",failures);
+
+    return (failures == 0) ? 0 : 1;
+}